@@ -0,0 +1,69 @@
+#include "bitpack.h"
+#include <string.h>
+
+static const int signedBits[4] = { 5, 10, 16, 32 };
+
+void BitWriterInit(BitWriter* w, unsigned char* data, int capacity) {
+    w->data = data;
+    w->capacity = capacity;
+    w->bits = 0;
+    w->overflow = false;
+    memset(data, 0, (size_t)capacity);
+}
+
+void BitWrite(BitWriter* w, unsigned int value, int count) {
+    if (w->bits + count > w->capacity * 8) {
+        w->overflow = true;
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        if ((value >> i) & 1u) w->data[w->bits >> 3] |= (unsigned char)(1u << (w->bits & 7));
+        w->bits++;
+    }
+}
+
+void BitWriteBool(BitWriter* w, bool value) {
+    BitWrite(w, value ? 1u : 0u, 1);
+}
+
+void BitWriteSigned(BitWriter* w, int value) {
+    unsigned int zigzag = ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+    int size = 0;
+    while (size < 3 && (zigzag >> signedBits[size]) != 0) size++;
+    BitWrite(w, (unsigned int)size, 2);
+    BitWrite(w, zigzag, signedBits[size]);
+}
+
+int BitWriterBytes(const BitWriter* w) {
+    return (w->bits + 7) / 8;
+}
+
+void BitReaderInit(BitReader* r, const unsigned char* data, int size) {
+    r->data = data;
+    r->size = size;
+    r->bits = 0;
+    r->overflow = false;
+}
+
+unsigned int BitRead(BitReader* r, int count) {
+    if (r->bits + count > r->size * 8) {
+        r->overflow = true;
+        return 0;
+    }
+    unsigned int value = 0;
+    for (int i = 0; i < count; i++) {
+        if ((r->data[r->bits >> 3] >> (r->bits & 7)) & 1u) value |= 1u << i;
+        r->bits++;
+    }
+    return value;
+}
+
+bool BitReadBool(BitReader* r) {
+    return BitRead(r, 1) != 0;
+}
+
+int BitReadSigned(BitReader* r) {
+    int size = (int)BitRead(r, 2);
+    unsigned int zigzag = BitRead(r, signedBits[size]);
+    return (int)(zigzag >> 1) ^ -(int)(zigzag & 1u);
+}
@@ -0,0 +1,37 @@
+#ifndef BITPACK_H
+#define BITPACK_H
+
+#include <stdbool.h>
+
+// Bit-level writer and reader over a byte buffer, least significant bit
+// first. Running past the end of the buffer sets overflow instead of
+// writing or reading out of bounds, so a packet is checked once at the end.
+
+typedef struct {
+    unsigned char* data;
+    int capacity;
+    int bits;
+    bool overflow;
+} BitWriter;
+
+typedef struct {
+    const unsigned char* data;
+    int size;
+    int bits;
+    bool overflow;
+} BitReader;
+
+void BitWriterInit(BitWriter* w, unsigned char* data, int capacity);
+void BitWrite(BitWriter* w, unsigned int value, int count);
+void BitWriteBool(BitWriter* w, bool value);
+// Signed value with a 2 bit size class: 5, 10, 16 or 32 bits follow.
+void BitWriteSigned(BitWriter* w, int value);
+// Bytes used so far, the last one partly filled.
+int BitWriterBytes(const BitWriter* w);
+
+void BitReaderInit(BitReader* r, const unsigned char* data, int size);
+unsigned int BitRead(BitReader* r, int count);
+bool BitReadBool(BitReader* r);
+int BitReadSigned(BitReader* r);
+
+#endif
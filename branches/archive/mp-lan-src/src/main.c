@@ -1,67 +1,43 @@
-#define WIN32_LEAN_AND_MEAN
-#define NOGDI
-#define NOUSER
-
-#include <winsock2.h>
-#include <ws2tcpip.h>
-
-#undef DrawText
-
 #include "raylib.h"
 #include "raymath.h"
+#include "net.h"
+#include "protocol.h"
+#include "world.h"
+#include "snapshot.h"
+#include "server.h"
+#include "reliable.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
-#pragma comment(lib, "ws2_32.lib")
-
-#define NET_PORT 25565
-#define PACKET_POS 1
-#define PACKET_BLOCK_ADD 2
-#define PACKET_BLOCK_REM 3
-#define PACKET_ENV_UPDATE 4
-#define PACKET_HELLO 5
-
-#define MAX_BLOCKS 2000
 #define MAX_PARTICLES 500
 #define PLAYER_SPEED 300.0f
 #define PLAYER_RUN_SPEED 500.0f
 #define JUMP_FORCE 550.0f
 #define GRAVITY 1000.0f
 #define MAX_FALL_SPEED 800.0f
-#define BLOCK_SIZE 40
-#define MAX_PLAYERS 4
 
 #define RL_STANDALONE
 
-typedef struct {
-    unsigned char type;
-    int playerId;
-    float x;
-    float y;
-    int data1;
-    int data2;
-} NetPacket;
-
-SOCKET sock;
-struct sockaddr_in serverAddr;
-struct sockaddr_in clients[MAX_PLAYERS];
-bool clientConnected[MAX_PLAYERS];
+NetSocket net;
+NetAddress serverAddr;
+ReliableChannel channel;
+Server server;
 bool isServer = false;
 bool isConnected = false;
 char targetIP[32] = "127.0.0.1";
 
-typedef enum { SHAPE_SQUARE, SHAPE_RECT, SHAPE_TRIANGLE, SHAPE_CIRCLE, SHAPE_RHOMBUS } BlockShape;
+// Snapshots decoded so far, kept so the next delta can be applied to
+// whichever one the server took it against.
+SnapshotHistory snapshots;
+unsigned int lastSnapshot = 0;
+float netRate = NET_RATE_DEFAULT;
+double nextStateSend = 0.0;
+
 typedef enum { WEATHER_NONE, WEATHER_RAIN, WEATHER_SNOW } WeatherType;
 typedef enum { STATE_MENU, STATE_GAME } GameState;
 
-typedef struct {
-    Rectangle rect;
-    int active;
-    Color color;
-    BlockShape shape;
-} Block;
-
 typedef struct {
     Vector2 position;
     float speed;
@@ -74,72 +50,119 @@ typedef struct {
     bool grounded;
     int colorIndex;
     bool active;
+    // Other players move from `from` to `to` over one snapshot interval.
+    Vector2 from;
+    Vector2 to;
+    float lerp;
 } Player;
 
-Block blocks[MAX_BLOCKS];
+World world;
 Particle particles[MAX_PARTICLES];
 Color blockColors[5]; 
 Color playerColors[6]; 
 Player players[MAX_PLAYERS]; 
+// Until the server's welcome arrives the local player sits in slot 0 and
+// sends nothing but its hello.
 int myId = 0;
+bool joined = false;
 
 const char* shapeNames[] = { "CUADRADO", "RECTANGULO", "TRIANGULO", "CIRCULO", "ROMBO" };
 
-void InitNetwork(bool server, const char* ip) {
-    WSADATA wsaData;
-    WSAStartup(MAKEWORD(2, 2), &wsaData);
-    sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    u_long mode = 1;
-    ioctlsocket(sock, FIONBIO, &mode);
-    for(int i=0; i<MAX_PLAYERS; i++) clientConnected[i] = false;
-    if (server) {
-        serverAddr.sin_family = AF_INET;
-        serverAddr.sin_port = htons(NET_PORT);
-        serverAddr.sin_addr.s_addr = INADDR_ANY;
-        bind(sock, (struct sockaddr*)&serverAddr, sizeof(serverAddr));
-        isServer = true;
-        isConnected = true;
-    } else {
-        serverAddr.sin_family = AF_INET;
-        serverAddr.sin_port = htons(NET_PORT);
-        inet_pton(AF_INET, ip, &serverAddr.sin_addr);
-        isServer = false;
-        isConnected = true;
+// Hosting starts the server on NET_PORT and then joins it over the loopback
+// like any other client.
+bool InitNetwork(bool host, const char* ip) {
+    isServer = host;
+    isConnected = false;
+    myId = 0;
+    joined = false;
+    ReliableInit(&channel);
+    SnapshotHistoryClear(&snapshots);
+    lastSnapshot = 0;
+    nextStateSend = 0.0;
+    ServerSetLog(TraceLog);
+    if (host && !ServerStart(&server, NET_PORT, netRate, true)) {
+        TraceLog(LOG_WARNING, "NET: could not open UDP port %d", NET_PORT);
+        return false;
     }
+    if (!NetOpen(&net, 0)) {
+        TraceLog(LOG_WARNING, "NET: could not open a UDP port");
+        if (host) ServerStop(&server);
+        return false;
+    }
+    if (!NetResolve(&serverAddr, host ? "127.0.0.1" : ip, NET_PORT)) {
+        TraceLog(LOG_WARNING, "NET: cannot resolve %s", ip);
+        NetClose(&net);
+        if (host) ServerStop(&server);
+        return false;
+    }
+    isConnected = true;
+    return true;
 }
 
 void SendPacket(NetPacket p) {
-    if (isServer) {
-        for(int i=0; i<MAX_PLAYERS; i++) {
-            if (clientConnected[i] && i != myId) {
-                sendto(sock, (char*)&p, sizeof(p), 0, (struct sockaddr*)&clients[i], sizeof(clients[i]));
-            }
-        }
-    } else {
-        sendto(sock, (char*)&p, sizeof(p), 0, (struct sockaddr*)&serverAddr, sizeof(serverAddr));
+    if (!ReliableSend(&channel, &p, sizeof(p))) TraceLog(LOG_WARNING, "NET: reliable window full, packet dropped");
+}
+
+void FlushReliable(void) {
+    unsigned char buffer[NET_MAX_DATAGRAM];
+    int size;
+    while ((size = ReliableWritePacket(&channel, NetTime(), buffer, sizeof(buffer))) > 0) NetSend(&net, &serverAddr, buffer, size);
+}
+
+void SendState(Player *me) {
+    ClientState state = { lastSnapshot, { me->active, QuantisePosition(me->position.x), QuantisePosition(me->position.y), me->colorIndex } };
+    unsigned char buffer[32];
+    int size = ClientStateWrite(buffer, sizeof(buffer), &state);
+    if (size > 0) NetSend(&net, &serverAddr, buffer, size);
+}
+
+void ApplySnapshot(const Snapshot *snapshot) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (i == myId) continue;
+        const PlayerState *s = &snapshot->players[i];
+        Player *p = &players[i];
+        Vector2 target = { DequantisePosition(s->x), DequantisePosition(s->y) };
+        if (s->active && !p->active) p->position = target;
+        p->active = s->active;
+        if (!s->active) continue;
+        p->from = p->position;
+        p->to = target;
+        p->lerp = 0.0f;
+        p->colorIndex = s->colorIndex % 6;
     }
 }
 
-void SendPacketTo(NetPacket p, struct sockaddr_in target) {
-    sendto(sock, (char*)&p, sizeof(p), 0, (struct sockaddr*)&target, sizeof(target));
+void OnWelcome(int id) {
+    if (id < 0 || id >= MAX_PLAYERS) return;
+    Player me = players[myId];
+    players[myId].active = false;
+    myId = id;
+    players[myId] = me;
+    joined = true;
+    TraceLog(LOG_INFO, "NET: joined as player %d", id);
+}
+
+void InterpolatePlayers(float dt) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        Player *p = &players[i];
+        if (i == myId || !p->active) continue;
+        p->lerp = fminf(p->lerp + dt * netRate, 1.0f);
+        p->position = Vector2Lerp(p->from, p->to, p->lerp);
+    }
 }
 
 void ResetPlayer(Player *p, Block startPlatform) {
-    p->position = (Vector2){ startPlatform.rect.x + 50 + (myId * 45), startPlatform.rect.y - 100 };
+    p->position = (Vector2){ startPlatform.rect.x + 50 + ((myId % 8) * 45), startPlatform.rect.y - 100 };
     p->velocity = (Vector2){ 0, 0 };
     p->active = true;
 }
 
 void InitGame() {
-    for (int i = 1; i < MAX_BLOCKS; i++) blocks[i].active = 0;
-    blocks[0].active = 1;
-    blocks[0].rect = (Rectangle){ -200, 300, 800, 40 };
-    blocks[0].color = GRAY;
-    blocks[0].shape = SHAPE_RECT;
+    WorldReset(&world);
     for(int i=0; i<MAX_PLAYERS; i++) {
+        ResetPlayer(&players[i], world.blocks[0]);
         players[i].active = (i == myId);
-        players[i].colorIndex = i;
-        ResetPlayer(&players[i], blocks[0]);
+        players[i].colorIndex = i % 6;
     }
 }
 
@@ -174,15 +197,16 @@ void DrawWeather(WeatherType weather) {
 }
 
 void DrawBlockShape(Block b) {
+    Color color = (b.colorIndex < 0) ? GRAY : blockColors[b.colorIndex];
     switch (b.shape) {
-        case SHAPE_SQUARE: case SHAPE_RECT: DrawRectangleRec(b.rect, b.color); break;
+        case SHAPE_SQUARE: case SHAPE_RECT: DrawRectangleRec(b.rect, color); break;
         case SHAPE_TRIANGLE: 
-            DrawTriangle((Vector2){b.rect.x + b.rect.width/2, b.rect.y}, (Vector2){b.rect.x, b.rect.y + b.rect.height}, (Vector2){b.rect.x + b.rect.width, b.rect.y + b.rect.height}, b.color);
+            DrawTriangle((Vector2){b.rect.x + b.rect.width/2, b.rect.y}, (Vector2){b.rect.x, b.rect.y + b.rect.height}, (Vector2){b.rect.x + b.rect.width, b.rect.y + b.rect.height}, color);
             break;
-        case SHAPE_CIRCLE: DrawCircle((int)(b.rect.x + b.rect.width/2), (int)(b.rect.y + b.rect.height/2), (float)b.rect.width/2, b.color); break;
+        case SHAPE_CIRCLE: DrawCircle((int)(b.rect.x + b.rect.width/2), (int)(b.rect.y + b.rect.height/2), (float)b.rect.width/2, color); break;
         case SHAPE_RHOMBUS:
-             DrawTriangle((Vector2){b.rect.x + b.rect.width/2, b.rect.y}, (Vector2){b.rect.x, b.rect.y + b.rect.height/2}, (Vector2){b.rect.x + b.rect.width, b.rect.y + b.rect.height/2}, b.color);
-             DrawTriangle((Vector2){b.rect.x, b.rect.y + b.rect.height/2}, (Vector2){b.rect.x + b.rect.width/2, b.rect.y + b.rect.height}, (Vector2){b.rect.x + b.rect.width, b.rect.y + b.rect.height/2}, b.color);
+             DrawTriangle((Vector2){b.rect.x + b.rect.width/2, b.rect.y}, (Vector2){b.rect.x, b.rect.y + b.rect.height/2}, (Vector2){b.rect.x + b.rect.width, b.rect.y + b.rect.height/2}, color);
+             DrawTriangle((Vector2){b.rect.x, b.rect.y + b.rect.height/2}, (Vector2){b.rect.x + b.rect.width/2, b.rect.y + b.rect.height}, (Vector2){b.rect.x + b.rect.width, b.rect.y + b.rect.height/2}, color);
              break;
     }
 }
@@ -198,35 +222,13 @@ void DrawPlayerRender(Player p, int id, Color color) {
     DrawText(label, (int)(p.position.x + 20 - textW/2), (int)(p.position.y - 15), 10, WHITE);
 }
 
-void AddBlock(float x, float y, int w, int h, int colorIdx, int shapeIdx) {
-    Rectangle target = {x, y, 1, 1};
-    for(int i=1; i<MAX_BLOCKS; i++) {
-        if (blocks[i].active && CheckCollisionRecs(target, blocks[i].rect)) return;
-    }
-    for (int i = 1; i < MAX_BLOCKS; i++) {
-        if (!blocks[i].active) {
-            blocks[i].active = 1;
-            blocks[i].rect = (Rectangle){ x, y, (float)w, (float)h };
-            blocks[i].color = blockColors[colorIdx];
-            blocks[i].shape = (BlockShape)shapeIdx;
-            break;
-        }
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--net-rate") == 0 && i + 1 < argc) netRate = Clamp((float)atof(argv[++i]), 1.0f, 60.0f);
     }
-}
-
-void RemoveBlock(float x, float y) {
-    Rectangle target = {x, y, 1, 1};
-    for (int i = 1; i < MAX_BLOCKS; i++) { 
-        if (blocks[i].active && CheckCollisionRecs(target, blocks[i].rect)) {
-            blocks[i].active = 0;
-        }
-    }
-}
-
-int main(void) {
     const int screenWidth = 1280;
     const int screenHeight = 720;
-    InitWindow(screenWidth, screenHeight, "Platform LAN 4 Players");
+    InitWindow(screenWidth, screenHeight, "Platform LAN");
     SetTargetFPS(60); 
     blockColors[0] = BLUE; blockColors[1] = RED; blockColors[2] = GREEN;
     blockColors[3] = YELLOW; blockColors[4] = PINK;
@@ -244,58 +246,58 @@ int main(void) {
     bool isNight = false;
     WeatherType currentWeather = WEATHER_NONE;
     int ipLetterCount = 0;
+    NetStats lastStats = { 0 };
+    NetStats lastServerStats = { 0 };
+    double nextStatsTime = 0.0;
+    float bytesInRate = 0.0f, bytesOutRate = 0.0f, serverOutRate = 0.0f;
 
     while (!WindowShouldClose()) {
         if (gameState == STATE_GAME) {
-            NetPacket packet;
-            struct sockaddr_in sender;
-            int senderLen = sizeof(sender);
-            while (recvfrom(sock, (char*)&packet, sizeof(packet), 0, (struct sockaddr*)&sender, &senderLen) > 0) {
-                if (packet.type == PACKET_HELLO && isServer) {
-                    clients[packet.playerId] = sender;
-                    clientConnected[packet.playerId] = true;
-                    NetPacket pEnv = {PACKET_ENV_UPDATE, myId, 0, 0, (int)currentWeather, (int)isNight};
-                    SendPacketTo(pEnv, sender);
-                    for(int i=1; i<MAX_BLOCKS; i++) {
-                        if (blocks[i].active) {
-                            int cIdx = 0;
-                            for(int c=0; c<5; c++) if(ColorToInt(blocks[i].color) == ColorToInt(blockColors[c])) cIdx = c;
-                            NetPacket pSync = {PACKET_BLOCK_ADD, myId, blocks[i].rect.x, blocks[i].rect.y, cIdx, blocks[i].shape};
-                            SendPacketTo(pSync, sender);
-                        }
-                    }
-                } else if (isServer && packet.type != PACKET_HELLO) {
-                    clients[packet.playerId] = sender;
-                    clientConnected[packet.playerId] = true;
-                    SendPacket(packet);
+            if (isServer) ServerUpdate(&server, NetTime());
+            // Datagrams were already read off the socket by the receive
+            // thread; this only empties its queue.
+            const NetDatagram* datagram;
+            for (; (datagram = NetPeek(&net)) != NULL; NetPop(&net)) {
+                if (datagram->size >= 1 && datagram->data[0] == PACKET_SNAPSHOT && joined) {
+                    Snapshot snapshot;
+                    // Older snapshots that arrive late are of no use.
+                    if (!SnapshotRead(datagram->data, datagram->size, &snapshots, &snapshot) || snapshot.sequence <= lastSnapshot) continue;
+                    SnapshotStore(&snapshots, &snapshot);
+                    lastSnapshot = snapshot.sequence;
+                    ApplySnapshot(&snapshot);
+                } else if (datagram->size >= 1 && datagram->data[0] == PACKET_RELIABLE) {
+                    ReliableReadPacket(&channel, datagram->data, datagram->size, datagram->time);
                 }
-                if (packet.playerId >= 0 && packet.playerId < MAX_PLAYERS && packet.playerId != myId) {
-                    if (packet.type == PACKET_POS) {
-                        players[packet.playerId].position = (Vector2){packet.x, packet.y};
-                        players[packet.playerId].colorIndex = packet.data1;
-                        players[packet.playerId].active = true;
-                    } else if (packet.type == PACKET_BLOCK_ADD) {
-                        AddBlock(packet.x, packet.y, (packet.data2 == SHAPE_RECT) ? BLOCK_SIZE * 2 : BLOCK_SIZE, BLOCK_SIZE, packet.data1, packet.data2);
-                    } else if (packet.type == PACKET_BLOCK_REM) {
-                        RemoveBlock(packet.x, packet.y);
-                    } else if (packet.type == PACKET_ENV_UPDATE) {
-                        currentWeather = (WeatherType)packet.data1;
-                        isNight = (bool)packet.data2;
-                    }
+            }
+            unsigned char message[RELIABLE_MAX_MESSAGE];
+            int size;
+            while ((size = ReliableReceive(&channel, message, sizeof(message))) > 0) {
+                if (message[0] == PACKET_WORLD_CHUNK) {
+                    WorldReadChunk(&world, message, size);
+                    continue;
+                }
+                NetPacket packet;
+                if (size != sizeof(packet)) continue;
+                memcpy(&packet, message, sizeof(packet));
+                if (packet.type == PACKET_WELCOME) {
+                    OnWelcome(packet.playerId);
+                } else if (packet.type == PACKET_BLOCK_ADD) {
+                    WorldAddBlock(&world, packet.x, packet.y, packet.data1, (BlockShape)packet.data2);
+                } else if (packet.type == PACKET_BLOCK_REM) {
+                    WorldRemoveAt(&world, packet.x, packet.y);
+                } else if (packet.type == PACKET_ENV_UPDATE) {
+                    currentWeather = (WeatherType)packet.data1;
+                    isNight = (bool)packet.data2;
                 }
             }
         }
 
         if (gameState == STATE_MENU) {
-            if (IsKeyPressed(KEY_H)) {
-                myId = 0; InitNetwork(true, ""); InitGame(); gameState = STATE_GAME;
-            }
-            for(int i=1; i<MAX_PLAYERS; i++) {
-                if (IsKeyPressed(KEY_ONE + i - 1)) {
-                    myId = i; InitNetwork(false, targetIP); InitGame(); gameState = STATE_GAME;
-                    NetPacket pHello = {PACKET_HELLO, myId};
-                    for(int j=0; j<3; j++) SendPacket(pHello);
-                }
+            bool host = IsKeyPressed(KEY_H);
+            if ((host || IsKeyPressed(KEY_J)) && InitNetwork(host, targetIP)) {
+                InitGame(); gameState = STATE_GAME;
+                NetPacket pHello = {PACKET_HELLO};
+                SendPacket(pHello);
             }
             int key = GetCharPressed();
             while (key > 0) {
@@ -310,9 +312,9 @@ int main(void) {
 
             BeginDrawing();
             ClearBackground(RAYWHITE);
-            DrawText("MULTIPLAYER 4P LAN", 100, 80, 40, DARKGRAY);
-            DrawText("[H] HOST (P0)", 100, 160, 20, BLACK);
-            DrawText("[1] JOIN AS P1 | [2] JOIN AS P2 | [3] JOIN AS P3", 100, 195, 20, DARKBLUE);
+            DrawText("MULTIPLAYER LAN", 100, 80, 40, DARKGRAY);
+            DrawText("[H] HOST", 100, 160, 20, BLACK);
+            DrawText(TextFormat("[J] JOIN (UP TO %d PLAYERS)", MAX_PLAYERS), 100, 195, 20, DARKBLUE);
             DrawText("IP SERVER:", 100, 300, 20, GRAY);
             DrawRectangle(100, 330, 300, 40, LIGHTGRAY);
             DrawText(targetIP, 110, 340, 20, BLACK);
@@ -351,23 +353,40 @@ int main(void) {
             me->position.x += me->velocity.x * dt;
             Rectangle pRect = { me->position.x, me->position.y, 40, 40 }; 
             for (int i = 0; i < MAX_BLOCKS; i++) {
-                if (blocks[i].active && CheckCollisionRecs(pRect, blocks[i].rect)) {
-                    if (me->velocity.x > 0) me->position.x = blocks[i].rect.x - 40;
-                    else if (me->velocity.x < 0) me->position.x = blocks[i].rect.x + blocks[i].rect.width;
+                if (world.blocks[i].active && CheckCollisionRecs(pRect, world.blocks[i].rect)) {
+                    if (me->velocity.x > 0) me->position.x = world.blocks[i].rect.x - 40;
+                    else if (me->velocity.x < 0) me->position.x = world.blocks[i].rect.x + world.blocks[i].rect.width;
                 }
             }
             me->position.y += me->velocity.y * dt;
             me->grounded = false;
             pRect = (Rectangle){me->position.x, me->position.y, 40, 40};
             for (int i = 0; i < MAX_BLOCKS; i++) {
-                if (blocks[i].active && CheckCollisionRecs(pRect, blocks[i].rect)) {
-                    if (me->velocity.y > 0) { me->position.y = blocks[i].rect.y - 40; me->velocity.y = 0; me->grounded = true; }
-                    else if (me->velocity.y < 0) { me->position.y = blocks[i].rect.y + blocks[i].rect.height; me->velocity.y = 0; }
+                if (world.blocks[i].active && CheckCollisionRecs(pRect, world.blocks[i].rect)) {
+                    if (me->velocity.y > 0) { me->position.y = world.blocks[i].rect.y - 40; me->velocity.y = 0; me->grounded = true; }
+                    else if (me->velocity.y < 0) { me->position.y = world.blocks[i].rect.y + world.blocks[i].rect.height; me->velocity.y = 0; }
+                }
+            }
+            if (me->position.y > 2000) ResetPlayer(me, world.blocks[0]);
+            // Our state goes out at the snapshot rate rather than every frame.
+            double now = NetTime();
+            if (joined && now >= nextStateSend) {
+                SendState(me);
+                nextStateSend = now + 1.0 / netRate;
+            }
+            InterpolatePlayers(dt);
+            if (now >= nextStatsTime) {
+                NetStats stats = NetGetStats(&net);
+                bytesInRate = (float)(stats.bytesIn - lastStats.bytesIn);
+                bytesOutRate = (float)(stats.bytesOut - lastStats.bytesOut);
+                lastStats = stats;
+                if (isServer) {
+                    NetStats serverStats = NetGetStats(&server.net);
+                    serverOutRate = (float)(serverStats.bytesOut - lastServerStats.bytesOut);
+                    lastServerStats = serverStats;
                 }
+                nextStatsTime = now + 1.0;
             }
-            if (me->position.y > 2000) ResetPlayer(me, blocks[0]);
-            NetPacket posP = {PACKET_POS, myId, me->position.x, me->position.y, me->colorIndex};
-            SendPacket(posP);
             camera.target.x += (me->position.x - camera.target.x) * 5.0f * dt;
             camera.target.y += (me->position.y - camera.target.y) * 5.0f * dt;
             Vector2 mWorld = GetScreenToWorld2D(GetMousePosition(), camera);
@@ -378,39 +397,43 @@ int main(void) {
             if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) {
                 bool ok = true;
                 for(int i=0; i<MAX_PLAYERS; i++) if(players[i].active && CheckCollisionRecs(potB, (Rectangle){players[i].position.x, players[i].position.y, 40, 40})) ok = false;
-                for(int i=0; i<MAX_BLOCKS; i++) if(blocks[i].active && CheckCollisionRecs(potB, blocks[i].rect)) ok = false;
+                if (WorldOverlaps(&world, potB)) ok = false;
+                // The server owns the blocks; ours appears when it sends it back.
                 if (ok) {
-                    AddBlock(potB.x, potB.y, bw, BLOCK_SIZE, selectedColorIndex, selectedShapeIndex);
                     NetPacket bP = {PACKET_BLOCK_ADD, myId, potB.x, potB.y, selectedColorIndex, selectedShapeIndex};
-                    SendPacket(bP); SendPacket(bP);
+                    SendPacket(bP);
                 }
             }
             if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
                 for (int i = 1; i < MAX_BLOCKS; i++) { 
-                    if (blocks[i].active && CheckCollisionPointRec(mWorld, blocks[i].rect)) {
-                        blocks[i].active = 0;
-                        NetPacket rP = {PACKET_BLOCK_REM, myId, blocks[i].rect.x, blocks[i].rect.y};
-                        SendPacket(rP); SendPacket(rP); break;
+                    if (world.blocks[i].active && CheckCollisionPointRec(mWorld, world.blocks[i].rect)) {
+                        NetPacket rP = {PACKET_BLOCK_REM, myId, world.blocks[i].rect.x, world.blocks[i].rect.y};
+                        SendPacket(rP); break;
                     }
                 }
             }
+            FlushReliable();
             UpdateWeather(currentWeather, camera, screenWidth, screenHeight);
             BeginDrawing();
                 ClearBackground(isNight ? (Color){ 10, 10, 30, 255 } : SKYBLUE);
                 BeginMode2D(camera);
-                    for (int i = 0; i < MAX_BLOCKS; i++) if (blocks[i].active) DrawBlockShape(blocks[i]);
+                    for (int i = 0; i < MAX_BLOCKS; i++) if (world.blocks[i].active) DrawBlockShape(world.blocks[i]);
                     for (int i = 0; i < MAX_PLAYERS; i++) if (players[i].active) DrawPlayerRender(players[i], i, playerColors[players[i].colorIndex]);
                     DrawWeather(currentWeather);
                     DrawRectangleLinesEx(potB, 2, WHITE);
                 EndMode2D();
                 if (previewTimer > 0) {
                     DrawRectangle(screenWidth - 150, screenHeight - 150, 140, 140, Fade(BLACK, 0.5f));
-                    Block pb = { {screenWidth - 110, screenHeight - 100, (selectedShapeIndex == SHAPE_RECT) ? 80 : 40, 40}, 1, blockColors[selectedColorIndex], selectedShapeIndex };
+                    Block pb = { {screenWidth - 110, screenHeight - 100, (selectedShapeIndex == SHAPE_RECT) ? 80 : 40, 40}, 1, selectedColorIndex, selectedShapeIndex };
                     DrawBlockShape(pb);
                     DrawText(shapeNames[selectedShapeIndex], screenWidth - 140, screenHeight - 30, 10, WHITE);
                 }
+                DrawText(TextFormat("Net %i Hz: %.1f KB/s in, %.1f KB/s out, RTT %i ms, %i resent", (int)netRate, bytesInRate / 1024.0f, bytesOutRate / 1024.0f, (int)(channel.srtt * 1000.0), (int)channel.resent), 10, 10, 10, WHITE);
+                if (isServer) DrawText(TextFormat("Server: %.1f KB/s out", serverOutRate / 1024.0f), 10, 24, 10, WHITE);
             EndDrawing();
         }
     }
-    closesocket(sock); WSACleanup(); CloseWindow(); return 0;
+    if (isConnected) NetClose(&net);
+    if (isConnected && isServer) ServerStop(&server);
+    CloseWindow(); return 0;
 }
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "net.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+double NetTime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Reads until the socket is empty. Only this thread moves head, only the
+// game moves tail.
+static void DrainSocket(NetSocket* net) {
+    // Where a datagram goes when the queue is full. Every socket has its own
+    // receive thread, so this cannot be shared between them.
+    unsigned char scratch[NET_MAX_DATAGRAM];
+    for (;;) {
+        unsigned int head = atomic_load_explicit(&net->head, memory_order_relaxed);
+        unsigned int tail = atomic_load_explicit(&net->tail, memory_order_acquire);
+        bool full = head - tail >= NET_QUEUE_SIZE;
+
+        NetDatagram* slot = full ? NULL : &net->queue[head % NET_QUEUE_SIZE];
+        socklen_t fromLength = sizeof(struct sockaddr_in);
+        struct sockaddr_in from;
+        ssize_t n = recvfrom(net->fd, full ? scratch : slot->data, NET_MAX_DATAGRAM, 0, (struct sockaddr*)&from, &fromLength);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+
+        if (full) {
+            atomic_fetch_add_explicit(&net->dropped, 1, memory_order_relaxed);
+            continue;
+        }
+        slot->from.addr = from;
+        slot->size = (int)n;
+        slot->time = NetTime();
+        atomic_fetch_add_explicit(&net->packetsIn, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&net->bytesIn, (unsigned long long)n, memory_order_relaxed);
+        atomic_store_explicit(&net->head, head + 1, memory_order_release);
+    }
+}
+
+static void* ReceiveThread(void* arg) {
+    NetSocket* net = arg;
+    struct epoll_event events[2];
+    for (;;) {
+        int count = epoll_wait(net->epollFd, events, 2, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == net->wakeFd) return NULL;
+            DrainSocket(net);
+        }
+    }
+    return NULL;
+}
+
+static void CloseFds(NetSocket* net) {
+    if (net->fd >= 0) close(net->fd);
+    if (net->epollFd >= 0) close(net->epollFd);
+    if (net->wakeFd >= 0) close(net->wakeFd);
+    net->fd = net->epollFd = net->wakeFd = -1;
+}
+
+bool NetOpen(NetSocket* net, unsigned short port) {
+    memset(net, 0, sizeof(*net));
+    net->fd = net->epollFd = net->wakeFd = -1;
+
+    net->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (net->fd < 0) return false;
+
+    // A bigger kernel buffer rides out the frames where the game is slow to
+    // pop; the kernel caps it at net.core.rmem_max.
+    int bufferSize = 1 << 20;
+    setsockopt(net->fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+    struct sockaddr_in local = { 0 };
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(net->fd, (struct sockaddr*)&local, sizeof(local)) != 0) {
+        CloseFds(net);
+        return false;
+    }
+
+    net->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    net->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event socketEvent = { .events = EPOLLIN, .data.fd = net->fd };
+    struct epoll_event wakeEvent = { .events = EPOLLIN, .data.fd = net->wakeFd };
+    if (net->epollFd < 0 || net->wakeFd < 0 ||
+        epoll_ctl(net->epollFd, EPOLL_CTL_ADD, net->fd, &socketEvent) != 0 ||
+        epoll_ctl(net->epollFd, EPOLL_CTL_ADD, net->wakeFd, &wakeEvent) != 0) {
+        CloseFds(net);
+        return false;
+    }
+
+    net->queue = malloc((size_t)NET_QUEUE_SIZE * sizeof(NetDatagram));
+    atomic_init(&net->head, 0);
+    atomic_init(&net->tail, 0);
+    atomic_init(&net->packetsIn, 0);
+    atomic_init(&net->bytesIn, 0);
+    atomic_init(&net->dropped, 0);
+
+    if (net->queue == NULL || pthread_create(&net->thread, NULL, ReceiveThread, net) != 0) {
+        free(net->queue);
+        net->queue = NULL;
+        CloseFds(net);
+        return false;
+    }
+    net->running = true;
+    return true;
+}
+
+void NetClose(NetSocket* net) {
+    if (net->running) {
+        unsigned long long one = 1;
+        ssize_t written = write(net->wakeFd, &one, sizeof(one));
+        (void)written;
+        pthread_join(net->thread, NULL);
+        net->running = false;
+    }
+    CloseFds(net);
+    free(net->queue);
+    net->queue = NULL;
+}
+
+bool NetResolve(NetAddress* address, const char* host, unsigned short port) {
+    memset(address, 0, sizeof(*address));
+    address->addr.sin_family = AF_INET;
+    address->addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &address->addr.sin_addr) == 1) return true;
+
+    struct addrinfo hints = { 0 };
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo* result = NULL;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL) return false;
+    address->addr.sin_addr = ((struct sockaddr_in*)result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+    return true;
+}
+
+bool NetAddressEqual(const NetAddress* a, const NetAddress* b) {
+    return a->addr.sin_addr.s_addr == b->addr.sin_addr.s_addr && a->addr.sin_port == b->addr.sin_port;
+}
+
+bool NetSend(NetSocket* net, const NetAddress* to, const void* data, int size) {
+    if (net->fd < 0 || size <= 0 || size > NET_MAX_DATAGRAM) return false;
+    ssize_t sent = sendto(net->fd, data, (size_t)size, 0, (const struct sockaddr*)&to->addr, sizeof(to->addr));
+    if (sent != size) return false;
+    net->packetsOut++;
+    net->bytesOut += (unsigned long long)size;
+    return true;
+}
+
+const NetDatagram* NetPeek(NetSocket* net) {
+    if (net->queue == NULL) return NULL;
+    unsigned int tail = atomic_load_explicit(&net->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&net->head, memory_order_acquire);
+    if (tail == head) return NULL;
+    return &net->queue[tail % NET_QUEUE_SIZE];
+}
+
+void NetPop(NetSocket* net) {
+    unsigned int tail = atomic_load_explicit(&net->tail, memory_order_relaxed);
+    atomic_store_explicit(&net->tail, tail + 1, memory_order_release);
+}
+
+NetStats NetGetStats(NetSocket* net) {
+    NetStats stats;
+    stats.packetsIn = atomic_load_explicit(&net->packetsIn, memory_order_relaxed);
+    stats.bytesIn = atomic_load_explicit(&net->bytesIn, memory_order_relaxed);
+    stats.dropped = atomic_load_explicit(&net->dropped, memory_order_relaxed);
+    stats.packetsOut = net->packetsOut;
+    stats.bytesOut = net->bytesOut;
+    return stats;
+}
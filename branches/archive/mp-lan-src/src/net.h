@@ -0,0 +1,78 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+// UDP socket with its receive path on a background thread. The thread sleeps
+// in epoll_wait until the socket is readable, drains it into a ring of
+// preallocated datagrams stamped with the time they were read, and goes back
+// to sleep. The game pops datagrams from the ring between frames, so a burst
+// of packets never holds a frame up and nothing is allocated per packet.
+// When the ring is full new datagrams are dropped and counted, as the kernel
+// would do with a full socket buffer.
+
+#define NET_PORT 25565
+#define NET_MAX_DATAGRAM 1200
+#define NET_QUEUE_SIZE 1024
+
+typedef struct {
+    struct sockaddr_in addr;
+} NetAddress;
+
+typedef struct {
+    NetAddress from;
+    double time;
+    int size;
+    unsigned char data[NET_MAX_DATAGRAM];
+} NetDatagram;
+
+typedef struct {
+    unsigned long long packetsIn;
+    unsigned long long bytesIn;
+    unsigned long long packetsOut;
+    unsigned long long bytesOut;
+    unsigned long long dropped;
+} NetStats;
+
+typedef struct {
+    int fd;
+    int epollFd;
+    int wakeFd;
+    pthread_t thread;
+    bool running;
+
+    NetDatagram* queue;
+    atomic_uint head;
+    atomic_uint tail;
+
+    atomic_ullong packetsIn;
+    atomic_ullong bytesIn;
+    atomic_ullong dropped;
+    unsigned long long packetsOut;
+    unsigned long long bytesOut;
+} NetSocket;
+
+// Seconds on a monotonic clock, the one datagrams are stamped with.
+double NetTime(void);
+
+// Binds to port on every interface, or to any free port for 0, and starts
+// the receive thread.
+bool NetOpen(NetSocket* net, unsigned short port);
+void NetClose(NetSocket* net);
+
+bool NetResolve(NetAddress* address, const char* host, unsigned short port);
+bool NetAddressEqual(const NetAddress* a, const NetAddress* b);
+
+// Sends right away; returns false if the datagram was not handed to the kernel.
+bool NetSend(NetSocket* net, const NetAddress* to, const void* data, int size);
+
+// Oldest datagram not popped yet, or NULL. It stays valid until NetPop.
+const NetDatagram* NetPeek(NetSocket* net);
+void NetPop(NetSocket* net);
+
+NetStats NetGetStats(NetSocket* net);
+
+#endif
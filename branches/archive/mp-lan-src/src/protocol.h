@@ -0,0 +1,45 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdbool.h>
+
+// What goes over the wire. Every datagram starts with its packet type in
+// the first byte. Block edits, the environment and joins are NetPackets
+// sent as messages on the reliable channel (see reliable.h), so they arrive
+// once and in order, as are the chunks of the block list a player is sent
+// when joining (see world.h); player state goes both ways unreliably as bit-packed,
+// quantised messages (see snapshot.h), where a lost one is simply replaced
+// by the next.
+
+// Player ids are slots the server hands out on join, see PACKET_WELCOME.
+#define MAX_PLAYERS 64
+
+#define PACKET_BLOCK_ADD 2
+#define PACKET_BLOCK_REM 3
+#define PACKET_ENV_UPDATE 4
+#define PACKET_HELLO 5
+#define PACKET_STATE 6
+#define PACKET_SNAPSHOT 7
+#define PACKET_RELIABLE 8
+#define PACKET_WORLD_CHUNK 9
+// Sent to a player that joined, with its id in playerId.
+#define PACKET_WELCOME 10
+
+// Snapshots and client state are sent this many times a second; the game
+// takes --net-rate to change it.
+#define NET_RATE_DEFAULT 20
+// Positions travel as integers in 1/POSITION_SCALE of a pixel.
+#define POSITION_SCALE 8
+// A client that sends nothing for this long is dropped.
+#define CLIENT_TIMEOUT 5.0
+
+typedef struct {
+    unsigned char type;
+    int playerId;
+    float x;
+    float y;
+    int data1;
+    int data2;
+} NetPacket;
+
+#endif
@@ -0,0 +1,249 @@
+#include "reliable.h"
+#include <string.h>
+
+#define HEADER_BYTES 10
+#define MESSAGE_HEADER_BYTES 4
+// Set in the count byte when the ack fields are valid, i.e. once anything
+// has been received from the other side.
+#define ACK_VALID 0x80
+
+static void Put16(unsigned char* p, unsigned int v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void Put32(unsigned char* p, unsigned int v) {
+    Put16(p, v);
+    Put16(p + 2, v >> 16);
+}
+
+static unsigned short Get16(const unsigned char* p) {
+    return (unsigned short)(p[0] | (p[1] << 8));
+}
+
+static unsigned int Get32(const unsigned char* p) {
+    return (unsigned int)Get16(p) | ((unsigned int)Get16(p + 2) << 16);
+}
+
+// Sequence numbers wrap, so a is newer than b when it is less than half the
+// range ahead.
+static bool SequenceNewer(unsigned short a, unsigned short b) {
+    unsigned short d = (unsigned short)(a - b);
+    return d != 0 && d < 0x8000;
+}
+
+void ReliableInit(ReliableChannel* channel) {
+    memset(channel, 0, sizeof(*channel));
+    channel->rto = 0.2;
+    channel->cwnd = RELIABLE_INITIAL_CWND;
+    channel->ssthresh = RELIABLE_WINDOW;
+    channel->lastLoss = -1.0;
+}
+
+// Packets carrying messages that are neither acked nor given up on yet.
+static int PacketsInFlight(const ReliableChannel* channel, double now) {
+    int count = 0;
+    for (int i = 0; i < RELIABLE_WINDOW; i++) {
+        const ReliableSentPacket* packet = &channel->sentPackets[i];
+        if (packet->used && !packet->acked && packet->messageCount > 0 && now - packet->sent < channel->rto) count++;
+    }
+    return count;
+}
+
+// One loss per round trip halves the window; the rest of the same burst
+// would otherwise shrink it to nothing.
+static void OnLoss(ReliableChannel* channel, double now) {
+    if (channel->lastLoss >= 0.0 && now - channel->lastLoss < channel->rto) return;
+    channel->lastLoss = now;
+    channel->ssthresh = channel->cwnd / 2.0;
+    if (channel->ssthresh < RELIABLE_MIN_CWND) channel->ssthresh = RELIABLE_MIN_CWND;
+    channel->cwnd = channel->ssthresh;
+}
+
+bool ReliableSend(ReliableChannel* channel, const void* data, int size) {
+    if (size < 1 || size > RELIABLE_MAX_MESSAGE || ReliablePending(channel) >= RELIABLE_WINDOW) return false;
+    ReliableMessage* message = &channel->sendQueue[channel->sendNext % RELIABLE_WINDOW];
+    message->queued = true;
+    message->acked = false;
+    message->id = channel->sendNext++;
+    message->lastSent = -1.0;
+    message->size = size;
+    memcpy(message->data, data, (size_t)size);
+    return true;
+}
+
+int ReliablePending(const ReliableChannel* channel) {
+    return (unsigned short)(channel->sendNext - channel->sendOldest);
+}
+
+int ReliableWritePacket(ReliableChannel* channel, double now, unsigned char* out, int capacity) {
+    if (capacity < HEADER_BYTES) return 0;
+
+    unsigned short ids[RELIABLE_PACKET_MESSAGES];
+    int count = 0;
+    int size = HEADER_BYTES;
+    bool windowOpen = PacketsInFlight(channel, now) < (int)channel->cwnd;
+    for (unsigned short id = channel->sendOldest; windowOpen && id != channel->sendNext && count < RELIABLE_PACKET_MESSAGES; id++) {
+        ReliableMessage* message = &channel->sendQueue[id % RELIABLE_WINDOW];
+        if (message->acked) continue;
+        if (message->lastSent >= 0.0 && now - message->lastSent < channel->rto) continue;
+        if (size + MESSAGE_HEADER_BYTES + message->size > capacity) break;
+
+        Put16(out + size, message->id);
+        Put16(out + size + 2, (unsigned int)message->size);
+        memcpy(out + size + MESSAGE_HEADER_BYTES, message->data, (size_t)message->size);
+        size += MESSAGE_HEADER_BYTES + message->size;
+
+        if (message->lastSent >= 0.0) {
+            channel->resent++;
+            OnLoss(channel, now);
+        }
+        message->lastSent = now;
+        ids[count++] = message->id;
+    }
+    if (count == 0 && !channel->ackPending) return 0;
+
+    out[0] = PACKET_RELIABLE;
+    Put16(out + 1, channel->packetNext);
+    Put16(out + 3, channel->remoteSequence);
+    Put32(out + 5, channel->remoteBits);
+    out[9] = (unsigned char)(count | (channel->hasRemote ? ACK_VALID : 0));
+
+    ReliableSentPacket* packet = &channel->sentPackets[channel->packetNext % RELIABLE_WINDOW];
+    packet->used = true;
+    packet->acked = false;
+    packet->sequence = channel->packetNext++;
+    packet->sent = now;
+    packet->messageCount = count;
+    memcpy(packet->messages, ids, sizeof(ids[0]) * (size_t)count);
+    channel->ackPending = false;
+    return size;
+}
+
+static void AckPacket(ReliableChannel* channel, unsigned short sequence, double now) {
+    ReliableSentPacket* packet = &channel->sentPackets[sequence % RELIABLE_WINDOW];
+    if (!packet->used || packet->acked || packet->sequence != sequence) return;
+    packet->acked = true;
+    // A packet with only acks in it is not acked back until the other side
+    // has something to send, so its ack says nothing about the round trip.
+    if (packet->messageCount == 0) return;
+
+    // Every packet has its own sequence number, so unlike a TCP segment a
+    // resent message never makes the sample ambiguous.
+    double sample = now - packet->sent;
+    if (channel->srtt <= 0.0) {
+        channel->srtt = sample;
+        channel->rttvar = sample / 2.0;
+    } else {
+        double error = channel->srtt - sample;
+        channel->rttvar = 0.75 * channel->rttvar + 0.25 * (error < 0.0 ? -error : error);
+        channel->srtt = 0.875 * channel->srtt + 0.125 * sample;
+    }
+    channel->rto = channel->srtt + 4.0 * channel->rttvar;
+    if (channel->rto < RELIABLE_MIN_RTO) channel->rto = RELIABLE_MIN_RTO;
+    if (channel->rto > RELIABLE_MAX_RTO) channel->rto = RELIABLE_MAX_RTO;
+
+    channel->cwnd += (channel->cwnd < channel->ssthresh) ? 1.0 : 1.0 / channel->cwnd;
+    if (channel->cwnd > RELIABLE_WINDOW) channel->cwnd = RELIABLE_WINDOW;
+    for (int i = 0; i < packet->messageCount; i++) {
+        ReliableMessage* message = &channel->sendQueue[packet->messages[i] % RELIABLE_WINDOW];
+        if (message->queued && message->id == packet->messages[i]) message->acked = true;
+    }
+}
+
+static void ReceiveSequence(ReliableChannel* channel, unsigned short sequence) {
+    if (!channel->hasRemote) {
+        channel->hasRemote = true;
+        channel->remoteSequence = sequence;
+        channel->remoteBits = 0;
+    } else if (SequenceNewer(sequence, channel->remoteSequence)) {
+        unsigned short shift = (unsigned short)(sequence - channel->remoteSequence);
+        unsigned int bits = (shift >= 32) ? 0 : channel->remoteBits << shift;
+        if (shift <= 32) bits |= 1u << (shift - 1);
+        channel->remoteBits = bits;
+        channel->remoteSequence = sequence;
+    } else {
+        unsigned short behind = (unsigned short)(channel->remoteSequence - sequence);
+        if (behind >= 1 && behind <= 32) channel->remoteBits |= 1u << (behind - 1);
+    }
+}
+
+bool ReliableReadPacket(ReliableChannel* channel, const unsigned char* data, int size, double now) {
+    if (size < HEADER_BYTES || data[0] != PACKET_RELIABLE) return false;
+    unsigned short sequence = Get16(data + 1);
+    unsigned short ack = Get16(data + 3);
+    unsigned int ackBits = Get32(data + 5);
+    int count = data[9] & ~ACK_VALID;
+
+    // Check the whole packet before using any of it. A message too far ahead
+    // to buffer means the game has not been taking them; the packet is then
+    // treated as lost so the sender tries again.
+    bool fits = true;
+    int offset = HEADER_BYTES;
+    for (int i = 0; i < count; i++) {
+        if (offset + MESSAGE_HEADER_BYTES > size) return false;
+        unsigned short id = Get16(data + offset);
+        int length = Get16(data + offset + 2);
+        if (length < 1 || length > RELIABLE_MAX_MESSAGE || offset + MESSAGE_HEADER_BYTES + length > size) return false;
+        unsigned short ahead = (unsigned short)(id - channel->recvNext);
+        if (ahead < 0x8000 && ahead >= RELIABLE_WINDOW) fits = false;
+        offset += MESSAGE_HEADER_BYTES + length;
+    }
+    if (offset != size) return false;
+
+    if (data[9] & ACK_VALID) {
+        AckPacket(channel, ack, now);
+        for (int i = 0; i < 32; i++) {
+            if (ackBits & (1u << i)) AckPacket(channel, (unsigned short)(ack - 1 - i), now);
+        }
+        while (channel->sendOldest != channel->sendNext) {
+            ReliableMessage* oldest = &channel->sendQueue[channel->sendOldest % RELIABLE_WINDOW];
+            if (!oldest->acked) break;
+            oldest->queued = false;
+            channel->sendOldest++;
+        }
+    }
+    if (!fits) return true;
+
+    ReceiveSequence(channel, sequence);
+    // Packets that only carry acks are not acked back, or two idle ends
+    // would keep answering each other.
+    if (count > 0) channel->ackPending = true;
+
+    offset = HEADER_BYTES;
+    for (int i = 0; i < count; i++) {
+        unsigned short id = Get16(data + offset);
+        int length = Get16(data + offset + 2);
+        const unsigned char* payload = data + offset + MESSAGE_HEADER_BYTES;
+        offset += MESSAGE_HEADER_BYTES + length;
+
+        // Already handed out, or a duplicate of one still waiting.
+        if ((unsigned short)(id - channel->recvNext) >= RELIABLE_WINDOW) continue;
+        ReliableMessage* message = &channel->recvQueue[id % RELIABLE_WINDOW];
+        if (message->queued && message->id == id) continue;
+        message->queued = true;
+        message->id = id;
+        message->size = length;
+        memcpy(message->data, payload, (size_t)length);
+    }
+    return true;
+}
+
+int ReliablePeekFirst(const unsigned char* data, int size, void* out, int capacity) {
+    if (size < HEADER_BYTES + MESSAGE_HEADER_BYTES || data[0] != PACKET_RELIABLE || (data[9] & ~ACK_VALID) == 0) return 0;
+    unsigned short id = Get16(data + HEADER_BYTES);
+    int length = Get16(data + HEADER_BYTES + 2);
+    if (id != 0 || length < 1 || length > RELIABLE_MAX_MESSAGE || HEADER_BYTES + MESSAGE_HEADER_BYTES + length > size) return 0;
+    memcpy(out, data + HEADER_BYTES + MESSAGE_HEADER_BYTES, (size_t)((length < capacity) ? length : capacity));
+    return length;
+}
+
+int ReliableReceive(ReliableChannel* channel, void* out, int capacity) {
+    ReliableMessage* message = &channel->recvQueue[channel->recvNext % RELIABLE_WINDOW];
+    if (!message->queued || message->id != channel->recvNext) return 0;
+    int size = (message->size < capacity) ? message->size : capacity;
+    memcpy(out, message->data, (size_t)size);
+    message->queued = false;
+    channel->recvNext++;
+    return size;
+}
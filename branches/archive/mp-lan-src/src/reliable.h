@@ -0,0 +1,102 @@
+#ifndef RELIABLE_H
+#define RELIABLE_H
+
+#include <stdbool.h>
+#include "protocol.h"
+
+// Reliable, ordered messages over the same UDP socket as everything else.
+// Each datagram the channel writes gets a packet sequence number and carries
+// an ack for the newest packet received from the other side plus a bitfield
+// for the 32 before it. Messages are numbered separately; one rides in
+// every packet until a packet carrying it is acked, being written again
+// whenever the retransmission timeout passes. That timeout follows the
+// measured round trip (srtt + 4 * rttvar, as in TCP). The receiver holds
+// messages that arrive early and hands them out strictly in order.
+//
+// How many packets with messages may be unacked at once is a congestion
+// window, again as in TCP: it grows by one per ack up to ssthresh and by one
+// per round trip after that, and a timeout halves it. Queuing a lot at once,
+// as a join sync does, then goes out as fast as the link takes it rather
+// than in one burst that overflows the receiver's socket.
+//
+//   packet   u8 PACKET_RELIABLE, 16 bit sequence, 16 bit ack, 32 bit ack bits,
+//            8 bit message count, then per message 16 bit id, 16 bit size, data
+
+#define RELIABLE_WINDOW 256
+#define RELIABLE_MAX_MESSAGE 256
+#define RELIABLE_PACKET_MESSAGES 32
+#define RELIABLE_MIN_RTO 0.05
+#define RELIABLE_MAX_RTO 1.0
+#define RELIABLE_INITIAL_CWND 4.0
+#define RELIABLE_MIN_CWND 2.0
+
+typedef struct {
+    bool queued;
+    bool acked;
+    unsigned short id;
+    double lastSent;
+    int size;
+    unsigned char data[RELIABLE_MAX_MESSAGE];
+} ReliableMessage;
+
+typedef struct {
+    bool used;
+    bool acked;
+    unsigned short sequence;
+    double sent;
+    int messageCount;
+    unsigned short messages[RELIABLE_PACKET_MESSAGES];
+} ReliableSentPacket;
+
+typedef struct {
+    // Sending: ids sendOldest up to sendNext are in flight.
+    unsigned short sendNext;
+    unsigned short sendOldest;
+    ReliableMessage sendQueue[RELIABLE_WINDOW];
+    unsigned short packetNext;
+    ReliableSentPacket sentPackets[RELIABLE_WINDOW];
+
+    // Receiving: recvNext is the next id ReliableReceive hands out.
+    unsigned short recvNext;
+    ReliableMessage recvQueue[RELIABLE_WINDOW];
+    bool hasRemote;
+    unsigned short remoteSequence;
+    unsigned int remoteBits;
+    bool ackPending;
+
+    // Round trip estimate, seconds.
+    double srtt;
+    double rttvar;
+    double rto;
+
+    // Congestion window, in packets.
+    double cwnd;
+    double ssthresh;
+    double lastLoss;
+
+    unsigned long long resent;
+} ReliableChannel;
+
+void ReliableInit(ReliableChannel* channel);
+
+// Queues a message. Returns false if it is too big or the window is full.
+bool ReliableSend(ReliableChannel* channel, const void* data, int size);
+// Messages sent but not acknowledged yet.
+int ReliablePending(const ReliableChannel* channel);
+
+// Writes the next datagram that is due: new messages, messages whose
+// timeout passed, or a bare ack if something arrived since the last one.
+// Messages wait while the congestion window is full. Returns the size, or 0
+// once nothing more is due; call it until then.
+int ReliableWritePacket(ReliableChannel* channel, double now, unsigned char* out, int capacity);
+// Takes a PACKET_RELIABLE datagram. Returns false if it is malformed.
+bool ReliableReadPacket(ReliableChannel* channel, const unsigned char* data, int size, double now);
+// Copies out the first message of a datagram from a channel that has not
+// been read from yet, which is message 0. Returns its size, or 0 if the
+// datagram is malformed or does not start with message 0.
+int ReliablePeekFirst(const unsigned char* data, int size, void* out, int capacity);
+// Copies out the next message in order. Returns its size, or 0 if the next
+// one has not arrived.
+int ReliableReceive(ReliableChannel* channel, void* out, int capacity);
+
+#endif
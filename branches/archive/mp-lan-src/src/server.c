@@ -0,0 +1,286 @@
+#include "server.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static ServerLogFn logLine = NULL;
+
+void ServerSetLog(ServerLogFn log) {
+    logLine = log;
+}
+
+static void Log(int logLevel, const char* format, ...) {
+    if (logLine == NULL) return;
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    logLine(logLevel, "%s", text);
+}
+
+bool ServerStart(Server* server, unsigned short port, float rate, bool listen) {
+    memset(server, 0, sizeof(*server));
+    if (!NetOpen(&server->net, port)) return false;
+    WorldReset(&server->world);
+    SnapshotHistoryClear(&server->history);
+    server->rate = (rate > 0.0f) ? rate : NET_RATE_DEFAULT;
+    server->nextSnapshot = NetTime();
+    server->listen = listen;
+    server->owner = -1;
+    return true;
+}
+
+static void DropClient(Server* server, int id) {
+    ServerClient* client = &server->clients[id];
+    client->connected = false;
+    free(client->backlog);
+    client->backlog = NULL;
+    client->backlogCount = client->backlogCapacity = 0;
+    if (server->owner == id) server->owner = -1;
+}
+
+void ServerStop(Server* server) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (server->clients[i].connected) DropClient(server, i);
+    }
+    NetClose(&server->net);
+}
+
+int ServerPlayerCount(const Server* server) {
+    int count = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (server->clients[i].connected) count++;
+    }
+    return count;
+}
+
+static void Enqueue(Server* server, int id, const NetPacket* packet) {
+    ServerClient* client = &server->clients[id];
+    if (client->backlogCount >= SERVER_MAX_BACKLOG) {
+        Log(LOG_WARNING, "NET: player %d is %d messages behind, disconnecting", id, client->backlogCount);
+        DropClient(server, id);
+        return;
+    }
+    if (client->backlogCount == client->backlogCapacity) {
+        int capacity = (client->backlogCapacity > 0) ? client->backlogCapacity * 2 : 64;
+        NetPacket* backlog = malloc((size_t)capacity * sizeof(NetPacket));
+        for (int i = 0; i < client->backlogCount; i++) {
+            backlog[i] = client->backlog[(client->backlogHead + i) % client->backlogCapacity];
+        }
+        free(client->backlog);
+        client->backlog = backlog;
+        client->backlogHead = 0;
+        client->backlogCapacity = capacity;
+    }
+    client->backlog[(client->backlogHead + client->backlogCount) % client->backlogCapacity] = *packet;
+    client->backlogCount++;
+}
+
+static void SendToAll(Server* server, const NetPacket* packet, int except) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (server->clients[i].connected && i != except) Enqueue(server, i, packet);
+    }
+}
+
+// Moves as much of the backlog into the channel as its window takes,
+// writing world chunks where the sync entry is.
+static void FeedChannel(Server* server, int id) {
+    ServerClient* client = &server->clients[id];
+    unsigned char chunk[RELIABLE_MAX_MESSAGE];
+    while (client->backlogCount > 0 && ReliablePending(&client->channel) < RELIABLE_WINDOW) {
+        const NetPacket* packet = &client->backlog[client->backlogHead];
+        if (packet->type == PACKET_WORLD_CHUNK) {
+            int size = WorldWriteChunk(&server->world, &client->syncCursor, chunk, sizeof(chunk));
+            if (size > 0) {
+                ReliableSend(&client->channel, chunk, size);
+                client->syncChunks++;
+                client->syncBytes += size;
+                continue;
+            }
+            Log(LOG_INFO, "NET: sent player %d the world, %d bytes in %d chunks", id, client->syncBytes, client->syncChunks);
+        } else {
+            ReliableSend(&client->channel, packet, sizeof(*packet));
+        }
+        client->backlogHead = (client->backlogHead + 1) % client->backlogCapacity;
+        client->backlogCount--;
+    }
+}
+
+static int FindClient(const Server* server, const NetAddress* from) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (server->clients[i].connected && NetAddressEqual(&server->clients[i].address, from)) return i;
+    }
+    return -1;
+}
+
+// Gives a new address the lowest free id, or -1 if the server is full.
+static int AddClient(Server* server, const NetAddress* from, double now) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ServerClient* client = &server->clients[i];
+        if (client->connected) continue;
+        memset(client, 0, sizeof(*client));
+        client->connected = true;
+        client->address = *from;
+        client->lastHeard = now;
+        ReliableInit(&client->channel);
+        if (server->listen && server->owner < 0) {
+            server->owner = i;
+            server->listen = false;
+        }
+        Log(LOG_INFO, "NET: player %d joined (%d/%d)", i, ServerPlayerCount(server), MAX_PLAYERS);
+        return i;
+    }
+    return -1;
+}
+
+// Whatever was still waiting is covered by the world the client is about
+// to be sent, so the backlog starts again from the welcome.
+static void SendWorld(Server* server, int id) {
+    ServerClient* client = &server->clients[id];
+    client->backlogCount = 0;
+    client->syncCursor = 0;
+    client->syncChunks = 0;
+    client->syncBytes = 0;
+
+    NetPacket welcome = { PACKET_WELCOME, id };
+    Enqueue(server, id, &welcome);
+    NetPacket env = { PACKET_ENV_UPDATE, 0, 0, 0, server->weather, server->isNight };
+    Enqueue(server, id, &env);
+    NetPacket sync = { PACKET_WORLD_CHUNK };
+    Enqueue(server, id, &sync);
+}
+
+static void HandleState(Server* server, const NetDatagram* datagram) {
+    int id = FindClient(server, &datagram->from);
+    ClientState state;
+    if (id < 0 || !ClientStateRead(datagram->data, datagram->size, &state)) return;
+    ServerClient* client = &server->clients[id];
+
+    client->lastHeard = datagram->time;
+    client->state = state.state;
+    // Datagrams can arrive out of order; an older ack is still valid but
+    // would only make the next delta bigger.
+    if (state.ack > client->acked) client->acked = state.ack;
+}
+
+static bool OverlapsPlayer(const Server* server, Rectangle area) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        const ServerClient* client = &server->clients[i];
+        if (!client->connected || !client->state.active) continue;
+        Rectangle body = { DequantisePosition(client->state.x), DequantisePosition(client->state.y), PLAYER_SIZE, PLAYER_SIZE };
+        if (RectsOverlap(area, body)) return true;
+    }
+    return false;
+}
+
+static void HandleMessage(Server* server, int id, const NetPacket* received) {
+    ServerClient* client = &server->clients[id];
+    NetPacket packet = *received;
+    packet.playerId = id;
+
+    switch (packet.type) {
+    case PACKET_HELLO:
+        // A new session has none of our snapshots to take deltas against.
+        client->acked = 0;
+        SendWorld(server, id);
+        break;
+    case PACKET_BLOCK_ADD: {
+        Rectangle area = { packet.x, packet.y, (float)((packet.data2 == SHAPE_RECT) ? BLOCK_SIZE * 2 : BLOCK_SIZE), (float)BLOCK_SIZE };
+        if (OverlapsPlayer(server, area)) break;
+        if (WorldAddBlock(&server->world, packet.x, packet.y, packet.data1, (BlockShape)packet.data2) >= 0) {
+            SendToAll(server, &packet, -1);
+        }
+        break;
+    }
+    case PACKET_BLOCK_REM:
+        if (WorldRemoveAt(&server->world, packet.x, packet.y) > 0) {
+            SendToAll(server, &packet, -1);
+        }
+        break;
+    case PACKET_ENV_UPDATE:
+        if (id != server->owner) break;
+        server->weather = packet.data1;
+        server->isNight = packet.data2;
+        SendToAll(server, &packet, id);
+        break;
+    }
+}
+
+// Only a channel opening with a hello makes a new player. Anything else
+// from an address the server does not know, such as the acks of a player
+// that timed out, is dropped rather than given a slot.
+static bool OpensWithHello(const NetDatagram* datagram) {
+    NetPacket packet;
+    return ReliablePeekFirst(datagram->data, datagram->size, &packet, sizeof(packet)) == (int)sizeof(packet) && packet.type == PACKET_HELLO;
+}
+
+static void HandleReliable(Server* server, const NetDatagram* datagram) {
+    int id = FindClient(server, &datagram->from);
+    if (id < 0 && OpensWithHello(datagram)) id = AddClient(server, &datagram->from, datagram->time);
+    if (id < 0) return;
+    ServerClient* client = &server->clients[id];
+    if (!ReliableReadPacket(&client->channel, datagram->data, datagram->size, datagram->time)) return;
+    client->lastHeard = datagram->time;
+
+    NetPacket packet;
+    int size;
+    // An edit that overflows the sender's own backlog disconnects it.
+    while (client->connected && (size = ReliableReceive(&client->channel, &packet, sizeof(packet))) > 0) {
+        if (size == sizeof(packet)) HandleMessage(server, id, &packet);
+    }
+}
+
+static void SendSnapshots(Server* server) {
+    Snapshot snapshot = { 0 };
+    snapshot.sequence = ++server->sequence;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (server->clients[i].connected) snapshot.players[i] = server->clients[i].state;
+    }
+    SnapshotStore(&server->history, &snapshot);
+
+    unsigned char buffer[SNAPSHOT_MAX_BYTES];
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ServerClient* client = &server->clients[i];
+        if (!client->connected) continue;
+        const Snapshot* baseline = SnapshotFind(&server->history, client->acked);
+        int size = SnapshotWrite(buffer, sizeof(buffer), &snapshot, baseline);
+        if (size > 0) NetSend(&server->net, &client->address, buffer, size);
+    }
+}
+
+void ServerUpdate(Server* server, double now) {
+    const NetDatagram* datagram;
+    for (; (datagram = NetPeek(&server->net)) != NULL; NetPop(&server->net)) {
+        if (datagram->size < 1) continue;
+        if (datagram->data[0] == PACKET_STATE) HandleState(server, datagram);
+        else if (datagram->data[0] == PACKET_RELIABLE) HandleReliable(server, datagram);
+    }
+
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ServerClient* client = &server->clients[i];
+        if (client->connected && now - client->lastHeard > CLIENT_TIMEOUT) {
+            DropClient(server, i);
+            Log(LOG_INFO, "NET: player %d timed out", i);
+        }
+    }
+
+    unsigned char buffer[NET_MAX_DATAGRAM];
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ServerClient* client = &server->clients[i];
+        if (!client->connected) continue;
+        FeedChannel(server, i);
+        int size;
+        while ((size = ReliableWritePacket(&client->channel, now, buffer, sizeof(buffer))) > 0) {
+            NetSend(&server->net, &client->address, buffer, size);
+        }
+    }
+
+    if (now >= server->nextSnapshot) {
+        SendSnapshots(server);
+        server->nextSnapshot += 1.0 / server->rate;
+        // After a long stall, carry on from now rather than sending a burst.
+        if (server->nextSnapshot < now) server->nextSnapshot = now + 1.0 / server->rate;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "net.h"
+#include "world.h"
+#include "snapshot.h"
+#include "reliable.h"
+
+// The LAN session's server. It owns the socket on NET_PORT, the block list
+// new players are sent when they join and the table of player states, and
+// sends every client a delta snapshot of that table `rate` times a second.
+// Block edits and the environment go to each client on its own reliable
+// channel, through a backlog that feeds the channel as its window frees up.
+// A client that joins is streamed the block list from a cursor, one
+// compressed chunk whenever the window has room; edits made meanwhile wait
+// in the backlog behind it, so the client's copy ends up right however long
+// the download takes. An edit that also made it into a later chunk is
+// harmless: adding where a block already is and removing where none is do
+// nothing. A client whose backlog passes SERVER_MAX_BACKLOG is not keeping
+// up at all and is disconnected rather than left with a wrong world.
+// Hosting runs it inside the game next to a client that connects to it over
+// the loopback like any other; platform_server runs it on its own.
+//
+// The server owns the blocks. Edits are requests: it applies the ones that
+// are valid and sends those to every player, the one who made it included.
+// Player ids are handed out to addresses as they join.
+
+#define SERVER_MAX_BACKLOG 8192
+
+typedef struct {
+    bool connected;
+    NetAddress address;
+    double lastHeard;
+    PlayerState state;
+    unsigned int acked;
+    ReliableChannel channel;
+
+    // Messages waiting for room in the channel, oldest at backlogHead. A
+    // PACKET_WORLD_CHUNK entry stands for the block list from syncCursor on.
+    NetPacket* backlog;
+    int backlogHead;
+    int backlogCount;
+    int backlogCapacity;
+    int syncCursor;
+    int syncChunks;
+    int syncBytes;
+} ServerClient;
+
+typedef struct {
+    NetSocket net;
+    World world;
+    int weather;
+    int isNight;
+    // On a listen server the first player to join is the host, who alone
+    // sets the weather; a dedicated server has no owner.
+    bool listen;
+    int owner;
+
+    ServerClient clients[MAX_PLAYERS];
+    SnapshotHistory history;
+    unsigned int sequence;
+    float rate;
+    double nextSnapshot;
+} Server;
+
+// Where the server's log lines go, with raylib's TraceLog levels. The game
+// passes TraceLog itself; the dedicated server, which does not link raylib,
+// prints them. Nothing is logged until one is set.
+typedef void (*ServerLogFn)(int logLevel, const char* text, ...);
+void ServerSetLog(ServerLogFn log);
+
+bool ServerStart(Server* server, unsigned short port, float rate, bool listen);
+void ServerStop(Server* server);
+// Handles everything received since the last call and sends the snapshots
+// that are due. now is on NetTime's clock.
+void ServerUpdate(Server* server, double now);
+int ServerPlayerCount(const Server* server);
+
+#endif
@@ -0,0 +1,121 @@
+#include "snapshot.h"
+#include "bitpack.h"
+#include <string.h>
+#include <math.h>
+
+int QuantisePosition(float v) {
+    return (int)lrintf(v * POSITION_SCALE);
+}
+
+float DequantisePosition(int v) {
+    return (float)v / POSITION_SCALE;
+}
+
+void SnapshotHistoryClear(SnapshotHistory* history) {
+    memset(history, 0, sizeof(*history));
+}
+
+void SnapshotStore(SnapshotHistory* history, const Snapshot* snapshot) {
+    history->snapshots[snapshot->sequence % SNAPSHOT_HISTORY] = *snapshot;
+}
+
+const Snapshot* SnapshotFind(const SnapshotHistory* history, unsigned int sequence) {
+    if (sequence == 0) return NULL;
+    const Snapshot* snapshot = &history->snapshots[sequence % SNAPSHOT_HISTORY];
+    return (snapshot->sequence == sequence) ? snapshot : NULL;
+}
+
+static bool SamePlayer(const PlayerState* a, const PlayerState* b) {
+    if (a->active != b->active) return false;
+    if (!a->active) return true;
+    return a->x == b->x && a->y == b->y && a->colorIndex == b->colorIndex;
+}
+
+// A position is sent relative to where the baseline had the player, or in
+// full when the baseline did not have it.
+static void WritePlayer(BitWriter* w, const PlayerState* player, const PlayerState* base) {
+    BitWriteBool(w, player->active);
+    if (!player->active) return;
+    bool relative = base != NULL && base->active;
+    BitWriteSigned(w, player->x - (relative ? base->x : 0));
+    BitWriteSigned(w, player->y - (relative ? base->y : 0));
+    BitWrite(w, (unsigned int)player->colorIndex, 3);
+}
+
+static void ReadPlayer(BitReader* r, PlayerState* player, const PlayerState* base) {
+    memset(player, 0, sizeof(*player));
+    player->active = BitReadBool(r);
+    if (!player->active) return;
+    bool relative = base != NULL && base->active;
+    player->x = BitReadSigned(r) + (relative ? base->x : 0);
+    player->y = BitReadSigned(r) + (relative ? base->y : 0);
+    player->colorIndex = (int)BitRead(r, 3);
+}
+
+int SnapshotWrite(unsigned char* out, int capacity, const Snapshot* snapshot, const Snapshot* baseline) {
+    if (capacity < 1) return 0;
+    out[0] = PACKET_SNAPSHOT;
+
+    BitWriter w;
+    BitWriterInit(&w, out + 1, capacity - 1);
+    BitWrite(&w, snapshot->sequence, 32);
+    BitWrite(&w, baseline != NULL ? baseline->sequence : 0u, 32);
+
+    static const PlayerState absent = { 0 };
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        const PlayerState* base = (baseline != NULL) ? &baseline->players[i] : &absent;
+        bool changed = !SamePlayer(&snapshot->players[i], base);
+        BitWriteBool(&w, changed);
+        if (changed) WritePlayer(&w, &snapshot->players[i], base);
+    }
+    return w.overflow ? 0 : 1 + BitWriterBytes(&w);
+}
+
+bool SnapshotRead(const unsigned char* data, int size, const SnapshotHistory* history, Snapshot* out) {
+    if (size < 1 || data[0] != PACKET_SNAPSHOT) return false;
+
+    BitReader r;
+    BitReaderInit(&r, data + 1, size - 1);
+    unsigned int sequence = BitRead(&r, 32);
+    unsigned int baselineSequence = BitRead(&r, 32);
+
+    const Snapshot* baseline = NULL;
+    if (baselineSequence != 0) {
+        baseline = SnapshotFind(history, baselineSequence);
+        if (baseline == NULL) return false;
+    }
+
+    Snapshot snapshot;
+    snapshot.sequence = sequence;
+    static const PlayerState absent = { 0 };
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        const PlayerState* base = (baseline != NULL) ? &baseline->players[i] : &absent;
+        if (BitReadBool(&r)) ReadPlayer(&r, &snapshot.players[i], base);
+        else snapshot.players[i] = *base;
+    }
+    if (r.overflow || sequence == 0) return false;
+
+    *out = snapshot;
+    return true;
+}
+
+int ClientStateWrite(unsigned char* out, int capacity, const ClientState* state) {
+    if (capacity < 1) return 0;
+    out[0] = PACKET_STATE;
+
+    BitWriter w;
+    BitWriterInit(&w, out + 1, capacity - 1);
+    BitWrite(&w, state->ack, 32);
+    WritePlayer(&w, &state->state, NULL);
+    return w.overflow ? 0 : 1 + BitWriterBytes(&w);
+}
+
+bool ClientStateRead(const unsigned char* data, int size, ClientState* state) {
+    if (size < 1 || data[0] != PACKET_STATE) return false;
+
+    BitReader r;
+    BitReaderInit(&r, data + 1, size - 1);
+    state->ack = BitRead(&r, 32);
+    ReadPlayer(&r, &state->state, NULL);
+    return !r.overflow;
+}
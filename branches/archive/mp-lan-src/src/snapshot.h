@@ -0,0 +1,67 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "protocol.h"
+
+// Player state replication. The server builds a snapshot of every player a
+// few times a second and sends each client the difference from the last
+// snapshot that client acknowledged: one bit for a player that did not
+// change, otherwise its position as a delta on the quantised grid plus its
+// colour. A client acknowledges by echoing the newest snapshot it decoded in
+// the state it sends back, and the server falls back to a full snapshot once
+// that acknowledgement drops out of its history.
+//
+//   snapshot  u8 PACKET_SNAPSHOT, 32 bit sequence, 32 bit baseline (0: none),
+//             per player slot: changed, then active, x, y, 3 bit colour
+//   state     u8 PACKET_STATE, 32 bit ack, active, x, y, colour
+//
+// A state carries no player id; the server knows its sender by address.
+//
+// Positions are written with BitWriteSigned, so a player that moved a few
+// pixels costs about 12 bits per axis.
+
+#define SNAPSHOT_HISTORY 64
+#define SNAPSHOT_MAX_BYTES (10 + MAX_PLAYERS * 10)
+
+typedef struct {
+    bool active;
+    int x;
+    int y;
+    int colorIndex;
+} PlayerState;
+
+typedef struct {
+    unsigned int sequence;
+    PlayerState players[MAX_PLAYERS];
+} Snapshot;
+
+// Snapshots kept by sequence number, so deltas can be taken against or
+// applied to any of the last SNAPSHOT_HISTORY.
+typedef struct {
+    Snapshot snapshots[SNAPSHOT_HISTORY];
+} SnapshotHistory;
+
+typedef struct {
+    unsigned int ack;
+    PlayerState state;
+} ClientState;
+
+int QuantisePosition(float v);
+float DequantisePosition(int v);
+
+void SnapshotHistoryClear(SnapshotHistory* history);
+void SnapshotStore(SnapshotHistory* history, const Snapshot* snapshot);
+// NULL if sequence is 0 or no longer kept.
+const Snapshot* SnapshotFind(const SnapshotHistory* history, unsigned int sequence);
+
+// Returns the bytes written to out, or 0 if capacity is too small.
+// baseline may be NULL for a full snapshot.
+int SnapshotWrite(unsigned char* out, int capacity, const Snapshot* snapshot, const Snapshot* baseline);
+// Decodes against the baseline it names, looked up in history. Returns
+// false if the packet is malformed or the baseline is gone.
+bool SnapshotRead(const unsigned char* data, int size, const SnapshotHistory* history, Snapshot* out);
+
+int ClientStateWrite(unsigned char* out, int capacity, const ClientState* state);
+bool ClientStateRead(const unsigned char* data, int size, ClientState* state);
+
+#endif
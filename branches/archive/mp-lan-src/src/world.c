@@ -0,0 +1,139 @@
+#include "world.h"
+#include "protocol.h"
+#include "bitpack.h"
+#include <string.h>
+#include <math.h>
+
+bool RectsOverlap(Rectangle a, Rectangle b) {
+    return a.x < b.x + b.width && a.x + a.width > b.x && a.y < b.y + b.height && a.y + a.height > b.y;
+}
+
+void WorldReset(World* world) {
+    memset(world, 0, sizeof(*world));
+    world->blocks[0].active = 1;
+    world->blocks[0].rect = (Rectangle){ -200, 300, 800, 40 };
+    world->blocks[0].colorIndex = -1;
+    world->blocks[0].shape = SHAPE_RECT;
+}
+
+int WorldAddBlock(World* world, float x, float y, int colorIndex, BlockShape shape) {
+    if (colorIndex < 0 || colorIndex >= BLOCK_COLOR_COUNT || shape < SHAPE_SQUARE || shape > SHAPE_RHOMBUS) return -1;
+
+    Rectangle target = { x, y, 1, 1 };
+    for (int i = 1; i < MAX_BLOCKS; i++) {
+        if (world->blocks[i].active && RectsOverlap(target, world->blocks[i].rect)) return -1;
+    }
+    for (int i = 1; i < MAX_BLOCKS; i++) {
+        Block* b = &world->blocks[i];
+        if (!b->active) {
+            b->active = 1;
+            b->rect = (Rectangle){ x, y, (float)((shape == SHAPE_RECT) ? BLOCK_SIZE * 2 : BLOCK_SIZE), (float)BLOCK_SIZE };
+            b->colorIndex = colorIndex;
+            b->shape = shape;
+            return i;
+        }
+    }
+    return -1;
+}
+
+int WorldRemoveAt(World* world, float x, float y) {
+    Rectangle target = { x, y, 1, 1 };
+    int removed = 0;
+    for (int i = 1; i < MAX_BLOCKS; i++) {
+        if (world->blocks[i].active && RectsOverlap(target, world->blocks[i].rect)) {
+            world->blocks[i].active = 0;
+            removed++;
+        }
+    }
+    return removed;
+}
+
+bool WorldOverlaps(const World* world, Rectangle area) {
+    for (int i = 0; i < MAX_BLOCKS; i++) {
+        if (world->blocks[i].active && RectsOverlap(area, world->blocks[i].rect)) return true;
+    }
+    return false;
+}
+
+// Worst case for one block: marker, grid bit, two raw floats, colour, shape.
+#define CHUNK_BLOCK_MAX_BITS (1 + 1 + 64 + 3 + 3)
+
+static bool OnGrid(float v) {
+    return fabsf(v) < 1e6f && fmodf(v, (float)BLOCK_SIZE) == 0.0f;
+}
+
+static unsigned int FloatBits(float v) {
+    unsigned int bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+static float BitsFloat(unsigned int bits) {
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+int WorldWriteChunk(const World* world, int* cursor, unsigned char* out, int capacity) {
+    if (*cursor >= MAX_BLOCKS || capacity < 2) return 0;
+    out[0] = PACKET_WORLD_CHUNK;
+
+    BitWriter w;
+    BitWriterInit(&w, out + 1, capacity - 1);
+
+    int i = (*cursor > 1) ? *cursor : 1;
+    int cellX = 0, cellY = 0;
+    for (; i < MAX_BLOCKS; i++) {
+        const Block* b = &world->blocks[i];
+        if (!b->active) continue;
+        // Keep room for the end marker.
+        if (w.bits + CHUNK_BLOCK_MAX_BITS + 1 > w.capacity * 8) break;
+
+        BitWriteBool(&w, true);
+        bool onGrid = OnGrid(b->rect.x) && OnGrid(b->rect.y);
+        BitWriteBool(&w, onGrid);
+        if (onGrid) {
+            int x = (int)(b->rect.x / BLOCK_SIZE), y = (int)(b->rect.y / BLOCK_SIZE);
+            BitWriteSigned(&w, x - cellX);
+            BitWriteSigned(&w, y - cellY);
+            cellX = x;
+            cellY = y;
+        } else {
+            BitWrite(&w, FloatBits(b->rect.x), 32);
+            BitWrite(&w, FloatBits(b->rect.y), 32);
+        }
+        BitWrite(&w, (unsigned int)b->colorIndex, 3);
+        BitWrite(&w, (unsigned int)b->shape, 3);
+    }
+    BitWriteBool(&w, false);
+    if (w.overflow) return 0;
+
+    *cursor = i;
+    return 1 + BitWriterBytes(&w);
+}
+
+bool WorldReadChunk(World* world, const unsigned char* data, int size) {
+    if (size < 2 || data[0] != PACKET_WORLD_CHUNK) return false;
+
+    BitReader r;
+    BitReaderInit(&r, data + 1, size - 1);
+
+    int cellX = 0, cellY = 0;
+    while (!r.overflow && BitReadBool(&r)) {
+        float x, y;
+        if (BitReadBool(&r)) {
+            cellX += BitReadSigned(&r);
+            cellY += BitReadSigned(&r);
+            x = (float)(cellX * BLOCK_SIZE);
+            y = (float)(cellY * BLOCK_SIZE);
+        } else {
+            x = BitsFloat(BitRead(&r, 32));
+            y = BitsFloat(BitRead(&r, 32));
+        }
+        int colorIndex = (int)BitRead(&r, 3);
+        BlockShape shape = (BlockShape)BitRead(&r, 3);
+        if (r.overflow) break;
+        WorldAddBlock(world, x, y, colorIndex, shape);
+    }
+    return !r.overflow;
+}
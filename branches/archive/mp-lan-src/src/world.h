@@ -0,0 +1,55 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "raylib.h"
+
+// The shared block list. It only uses raylib's types, never its functions,
+// so the server side runs without a window.
+
+#define MAX_BLOCKS 2000
+#define BLOCK_SIZE 40
+#define BLOCK_COLOR_COUNT 5
+#define PLAYER_SIZE 40
+
+typedef enum { SHAPE_SQUARE, SHAPE_RECT, SHAPE_TRIANGLE, SHAPE_CIRCLE, SHAPE_RHOMBUS } BlockShape;
+
+typedef struct {
+    Rectangle rect;
+    int active;
+    int colorIndex;
+    BlockShape shape;
+} Block;
+
+typedef struct {
+    Block blocks[MAX_BLOCKS];
+} World;
+
+// Leaves only block 0, the base platform.
+void WorldReset(World* world);
+// Places a block with its top left corner at x, y unless a block already
+// covers that point or the world is full. Returns its index or -1.
+int WorldAddBlock(World* world, float x, float y, int colorIndex, BlockShape shape);
+// Removes every block but the base platform covering x, y. Returns how many went.
+int WorldRemoveAt(World* world, float x, float y);
+bool WorldOverlaps(const World* world, Rectangle area);
+
+// The block list as sent to a player who joins, in chunks of at most
+// capacity bytes that each decode on their own. A block on the grid, as
+// every block placed in game is, costs a few bytes: its position as a
+// signed delta in cells from the block before it, then colour and shape.
+// Anything else falls back to the raw coordinates.
+//
+//   chunk  u8 PACKET_WORLD_CHUNK, then per block a 1 bit marker, 1 bit on
+//          grid, x and y, 3 bit colour, 3 bit shape; a 0 marker ends it
+//
+// Writes the blocks from *cursor on and moves it past them. Returns the
+// bytes written, or 0 once every block has been written.
+int WorldWriteChunk(const World* world, int* cursor, unsigned char* out, int capacity);
+// Adds the chunk's blocks on top of what the world has, which keeps blocks
+// the player placed before the download reached them. Returns false if it
+// is malformed.
+bool WorldReadChunk(World* world, const unsigned char* data, int size);
+
+bool RectsOverlap(Rectangle a, Rectangle b);
+
+#endif
@@ -0,0 +1,114 @@
+#include "server.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+// The dedicated server: the game's server without a window, audio or a
+// player of its own. It runs ServerUpdate at a fixed tick and prints once a
+// second how long the ticks took and how much went over the wire, which is
+// what sizing a host comes down to.
+//
+//   platform_server [--port N] [--tick N] [--net-rate N]
+
+#define SERVER_TICK_RATE 60
+
+static volatile sig_atomic_t running = 1;
+
+static void Stop(int signal) {
+    (void)signal;
+    running = 0;
+}
+
+static void SleepUntil(double time) {
+    double wait = time - NetTime();
+    if (wait <= 0.0) return;
+    struct timespec ts = { (time_t)wait, (long)((wait - (double)(time_t)wait) * 1e9) };
+    nanosleep(&ts, NULL);
+}
+
+// Prints the server's log lines the way raylib's TraceLog would.
+static void PrintLog(int logLevel, const char* text, ...) {
+    static const char* prefixes[] = { "", "TRACE", "DEBUG", "INFO", "WARNING", "ERROR", "FATAL" };
+    if (logLevel < LOG_INFO || logLevel > LOG_FATAL) return;
+    va_list args;
+    va_start(args, text);
+    printf("%s: ", prefixes[logLevel]);
+    vprintf(text, args);
+    printf("\n");
+    va_end(args);
+}
+
+// Kept out of main's stack: every player's reliable channel is in it.
+static Server server;
+
+int main(int argc, char** argv) {
+    int port = NET_PORT;
+    float tickRate = SERVER_TICK_RATE;
+    float netRate = NET_RATE_DEFAULT;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--tick") == 0 && i + 1 < argc) tickRate = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--net-rate") == 0 && i + 1 < argc) netRate = (float)atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: platform_server [--port N] [--tick N] [--net-rate N]\n");
+            return 1;
+        }
+    }
+    if (port <= 0 || port > 65535 || tickRate < 1.0f || netRate < 1.0f || netRate > tickRate) {
+        fprintf(stderr, "platform_server: bad port or rates\n");
+        return 1;
+    }
+
+    ServerSetLog(PrintLog);
+    if (!ServerStart(&server, (unsigned short)port, netRate, false)) {
+        fprintf(stderr, "platform_server: could not open UDP port %d\n", port);
+        return 1;
+    }
+    signal(SIGINT, Stop);
+    signal(SIGTERM, Stop);
+    printf("platform_server: port %d, %.0f Hz tick, %.0f Hz snapshots, up to %d players\n", port, tickRate, netRate, MAX_PLAYERS);
+    fflush(stdout);
+
+    double tickLength = 1.0 / tickRate;
+    double nextTick = NetTime();
+    double reportStart = nextTick;
+    NetStats last = NetGetStats(&server.net);
+    int ticks = 0;
+    double busy = 0.0, worst = 0.0;
+
+    while (running) {
+        double start = NetTime();
+        ServerUpdate(&server, start);
+        double spent = NetTime() - start;
+        ticks++;
+        busy += spent;
+        if (spent > worst) worst = spent;
+
+        double elapsed = start - reportStart;
+        if (elapsed >= 1.0) {
+            NetStats stats = NetGetStats(&server.net);
+            printf("tick %.3f ms avg, %.3f ms max, %d ticks | %d players | in %.1f KB/s %llu pkt, out %.1f KB/s %llu pkt | %llu dropped\n",
+                busy * 1000.0 / ticks, worst * 1000.0, ticks, ServerPlayerCount(&server),
+                (double)(stats.bytesIn - last.bytesIn) / 1024.0 / elapsed, stats.packetsIn - last.packetsIn,
+                (double)(stats.bytesOut - last.bytesOut) / 1024.0 / elapsed, stats.packetsOut - last.packetsOut,
+                stats.dropped - last.dropped);
+            fflush(stdout);
+            last = stats;
+            reportStart = start;
+            ticks = 0;
+            busy = worst = 0.0;
+        }
+
+        nextTick += tickLength;
+        // After a stall, tick on from now instead of catching up in a burst.
+        if (nextTick < NetTime() - tickLength) nextTick = NetTime();
+        SleepUntil(nextTick);
+    }
+
+    printf("platform_server: stopping\n");
+    ServerStop(&server);
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "bench.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define MAX_SAMPLES 200
+#define MIN_SAMPLES 5
+#define SAMPLE_TARGET_NS 20000.0
+
+static const char* benchFilter = NULL;
+static FILE* benchOut = NULL;
+static double benchBudgetNs = 200e6;
+static int benchCount = 0;
+static int benchFailures = 0;
+
+double BenchNowNs(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+void BenchFail(const char* message) {
+	fprintf(stderr, "platform_bench: %s\n", message);
+	benchFailures++;
+}
+
+static int CompareDoubles(const void* a, const void* b) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+static double Percentile(const double* sorted, int count, double q) {
+	int index = (int)ceil(q * count) - 1;
+	if (index < 0) index = 0;
+	if (index >= count) index = count - 1;
+	return sorted[index];
+}
+
+void BenchCase(const char* name, const char* param, int size, BenchOp op, void* ctx) {
+	if (benchFilter != NULL && strstr(name, benchFilter) == NULL) return;
+
+	int iteration = 0;
+	double t0 = BenchNowNs();
+	op(ctx, iteration++);
+	double estimate = BenchNowNs() - t0;
+	if (estimate < 1.0) estimate = 1.0;
+
+	int batch = (int)(SAMPLE_TARGET_NS / estimate);
+	if (batch < 1) batch = 1;
+	int samples = (int)(benchBudgetNs / (estimate * batch));
+	if (samples < MIN_SAMPLES) samples = MIN_SAMPLES;
+	if (samples > MAX_SAMPLES) samples = MAX_SAMPLES;
+
+	double results[MAX_SAMPLES];
+	double total = 0.0;
+	for (int s = 0; s < samples; s++) {
+		t0 = BenchNowNs();
+		for (int b = 0; b < batch; b++) op(ctx, iteration++);
+		double elapsed = BenchNowNs() - t0;
+		results[s] = elapsed / batch;
+		total += elapsed;
+	}
+	qsort(results, (size_t)samples, sizeof(double), CompareDoubles);
+
+	fprintf(benchOut, "%s\n    {\"name\": \"%s\", \"%s\": %d, \"iterations\": %d, \"ns_per_op\": %.1f, "
+		"\"min\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}",
+		(benchCount > 0) ? "," : "", name, param, size, samples * batch, total / (samples * batch),
+		results[0], Percentile(results, samples, 0.50), Percentile(results, samples, 0.90),
+		Percentile(results, samples, 0.99), results[samples - 1]);
+	fflush(benchOut);
+	benchCount++;
+}
+
+int GenerateWorld(World* world, int count, int* side) {
+	int s = (int)ceil(sqrt((double)count * 3.0));
+	unsigned char* used = calloc((size_t)s * s, 1);
+	int n = 0;
+
+	for (int y = 0; y < s && n < count; y++) {
+		for (int x = 0; x < s && n < count; x++) {
+			if (used[y * s + x] || GetRandomValue(0, 99) >= 50) continue;
+
+			bool wide = GetRandomValue(0, 4) == 0 && x + 1 < s && !used[y * s + x + 1];
+			used[y * s + x] = 1;
+			if (wide) used[y * s + x + 1] = 1;
+
+			Rectangle rect = { (float)(x * BLOCK_SIZE), (float)(y * BLOCK_SIZE), (float)(wide ? BLOCK_SIZE * 2 : BLOCK_SIZE), (float)BLOCK_SIZE };
+			WorldAdd(world, rect, BLUE, wide ? SHAPE_RECT : SHAPE_SQUARE);
+			n++;
+		}
+	}
+
+	free(used);
+	*side = s;
+	return n;
+}
+
+static void PrintUsage(void) {
+	fprintf(stderr, "usage: platform_bench [--filter text] [--out file.json] [--budget-ms ms] [--replay file.rpl]\n");
+}
+
+int main(int argc, char** argv) {
+	const char* outPath = NULL;
+	const char* replayPath = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) benchFilter = argv[++i];
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) outPath = argv[++i];
+		else if (strcmp(argv[i], "--budget-ms") == 0 && i + 1 < argc) benchBudgetNs = atof(argv[++i]) * 1e6;
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+		else {
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	benchOut = stdout;
+	if (outPath != NULL) {
+		benchOut = fopen(outPath, "w");
+		if (benchOut == NULL) {
+			fprintf(stderr, "platform_bench: cannot open %s\n", outPath);
+			return 2;
+		}
+	}
+
+	SetTraceLogLevel(LOG_NONE);
+	SetRandomSeed(1234);
+
+	fprintf(benchOut, "{\n  \"benchmarks\": [");
+	RunWorldBenchmarks();
+	RunWeatherBenchmarks();
+	RunIoBenchmarks();
+	RunReplayBenchmarks(replayPath);
+	fprintf(benchOut, "\n  ]\n}\n");
+
+	if (benchOut != stdout) fclose(benchOut);
+	return (benchFailures > 0) ? 1 : 0;
+}
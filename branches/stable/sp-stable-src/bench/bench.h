@@ -0,0 +1,24 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "game.h"
+#include "world.h"
+
+// Each case times op(ctx, i) in batches and reports ns/op percentiles over
+// the batches as one JSON record.
+
+typedef void (*BenchOp)(void* ctx, int iteration);
+
+void BenchCase(const char* name, const char* param, int size, BenchOp op, void* ctx);
+double BenchNowNs(void);
+void BenchFail(const char* message);
+
+int GenerateWorld(World* world, int count, int* side);
+
+void RunWorldBenchmarks(void);
+void RunWeatherBenchmarks(void);
+void RunIoBenchmarks(void);
+// fileName is a recorded session to play, or NULL for a scripted one.
+void RunReplayBenchmarks(const char* fileName);
+
+#endif
@@ -0,0 +1,58 @@
+#include "bench.h"
+#include "console.h"
+#include "save.h"
+#include <stdio.h>
+
+#define BENCH_LEVEL "platform_bench_level.dat"
+
+typedef struct {
+	World world;
+	Player player;
+} SaveBench;
+
+static void ConsoleCase(void* ctx, int i) {
+	(void)ctx;
+	(void)i;
+	AddConsoleLog("Player position reset");
+}
+
+static void SaveCase(void* ctx, int i) {
+	SaveBench* b = ctx;
+	(void)i;
+	SaveGame(BENCH_LEVEL, &b->player, &b->world, 0, WEATHER_NONE, 0, 0, 0);
+}
+
+static void SnapshotCase(void* ctx, int i) {
+	SaveBench* b = ctx;
+	World copy;
+	(void)i;
+	WorldCopy(&copy, &b->world);
+	WorldFree(&copy);
+}
+
+static void LoadCase(void* ctx, int i) {
+	SaveBench* b = ctx;
+	int isNight, playerColor, blockColor, blockShape;
+	WeatherType weather;
+	(void)i;
+	LoadGame(BENCH_LEVEL, &b->player, &b->world, &isNight, &weather, &playerColor, &blockColor, &blockShape);
+}
+
+void RunIoBenchmarks(void) {
+	BenchCase("console/add", "lines", CONSOLE_HISTORY, ConsoleCase, NULL);
+
+	int sizes[] = { 2000, 50000, 500000 };
+	for (int s = 0; s < 3; s++) {
+		SaveBench b = { 0 };
+		WorldInit(&b.world);
+		int side = 0;
+		GenerateWorld(&b.world, sizes[s], &side);
+
+		BenchCase("save/snapshot", "blocks", sizes[s], SnapshotCase, &b);
+		BenchCase("save/level", "blocks", sizes[s], SaveCase, &b);
+		BenchCase("load/level", "blocks", sizes[s], LoadCase, &b);
+
+		WorldFree(&b.world);
+	}
+	remove(BENCH_LEVEL);
+}
@@ -0,0 +1,87 @@
+#include "bench.h"
+#include "sim.h"
+#include "replay.h"
+#include <stdio.h>
+
+#define BENCH_REPLAY "platform_bench_replay.rpl"
+#define SCRIPTED_TICKS (SIM_TICK_RATE * 60)
+
+typedef struct {
+	Replay replay;
+	WorldState state;
+} ReplayBench;
+
+// A minute of running and jumping across a generated map, placing and
+// removing blocks on the way, for when no real session is given.
+static void ScriptedInput(InputFrame* input, int tick) {
+	*input = (InputFrame){ 0 };
+	input->right = (tick / 600) % 4 != 3;
+	input->left = !input->right;
+	input->jumpPressed = tick % 90 == 0;
+	input->placeHeld = tick % 240 < 8;
+	input->removeHeld = tick % 240 >= 120 && tick % 240 < 124;
+	input->mouseWorld = (Vector2){ (float)(tick % 2000), 200.0f };
+	input->blockColor = BLUE;
+	input->blockShape = (BlockShape)((tick / 240) % 5);
+}
+
+static bool RecordScriptedSession(const char* fileName) {
+	WorldState state;
+	SimInit(&state);
+	int side = 0;
+	GenerateWorld(&state.world, 50000, &side);
+
+	ReplayRecorder rec;
+	bool ok = ReplayStartRecording(&rec, fileName, &state, SIM_TICK_RATE);
+	for (int t = 0; ok && t < SCRIPTED_TICKS; t++) {
+		InputFrame input;
+		ScriptedInput(&input, t);
+		ReplayRecordStep(&rec, &state, &input, 1.0f / SIM_TICK_RATE);
+	}
+	if (ok) ok = ReplayStopRecording(&rec, &state);
+
+	SimFree(&state);
+	return ok;
+}
+
+static void StepCase(void* ctx, int i) {
+	ReplayBench* b = ctx;
+	(void)i;
+	if (!ReplayStep(&b->replay, &b->state)) ReplaySeek(&b->replay, &b->state, 0);
+}
+
+static void SeekCase(void* ctx, int i) {
+	ReplayBench* b = ctx;
+	ReplaySeek(&b->replay, &b->state, (unsigned long long)i * 997 % (b->replay.tickCount + 1));
+}
+
+void RunReplayBenchmarks(const char* fileName) {
+	bool scripted = (fileName == NULL);
+	if (scripted) {
+		fileName = BENCH_REPLAY;
+		if (!RecordScriptedSession(fileName)) {
+			BenchFail("cannot record the scripted replay");
+			return;
+		}
+	}
+
+	ReplayBench b;
+	if (!ReplayOpen(&b.replay, fileName)) {
+		BenchFail("cannot open the replay");
+		if (scripted) remove(fileName);
+		return;
+	}
+	SimInit(&b.state);
+
+	if (ReplaySeek(&b.replay, &b.state, 0)) {
+		BenchCase("replay/step", "ticks", (int)b.replay.tickCount, StepCase, &b);
+		BenchCase("replay/seek", "ticks", (int)b.replay.tickCount, SeekCase, &b);
+	}
+	else {
+		BenchFail("cannot seek into the replay");
+	}
+
+	SimFree(&b.state);
+	ReplayClose(&b.replay);
+	if (scripted) remove(fileName);
+}
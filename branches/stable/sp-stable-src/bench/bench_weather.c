@@ -0,0 +1,33 @@
+#include "bench.h"
+#include "weather.h"
+
+typedef struct {
+	ParticleSystem ps;
+	WeatherType weather;
+	Camera2D camera;
+} WeatherBench;
+
+static void UpdateWeatherCase(void* ctx, int i) {
+	WeatherBench* b = ctx;
+	b->camera.target.x = (float)(i % 600);
+	UpdateWeather(&b->ps, b->weather, b->camera, 1280, 720, 1.0f / 60.0f);
+}
+
+void RunWeatherBenchmarks(void) {
+	int counts[] = { 500, 5000, 100000 };
+
+	for (int c = 0; c < 3; c++) {
+		WeatherBench b = { 0 };
+		b.camera.zoom = 1.0f;
+		ParticleSystemInit(&b.ps, counts[c]);
+
+		b.weather = WEATHER_RAIN;
+		BenchCase("weather/rain", "particles", counts[c], UpdateWeatherCase, &b);
+
+		InitParticles(&b.ps);
+		b.weather = WEATHER_SNOW;
+		BenchCase("weather/snow", "particles", counts[c], UpdateWeatherCase, &b);
+
+		ParticleSystemFree(&b.ps);
+	}
+}
@@ -0,0 +1,205 @@
+#include "bench.h"
+#include "sim.h"
+#include "edit.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#define BENCH_PROBES 4096
+#define MAX_HITS 256
+
+typedef struct {
+	World world;
+	int side;
+	Rectangle probes[BENCH_PROBES];
+	Rectangle views[BENCH_PROBES];
+	Vector2 points[BENCH_PROBES];
+	Rectangle freeCells[BENCH_PROBES];
+	int freeCount;
+	long sink;
+} WorldBench;
+
+static void ScanCollide(void* ctx, int i) {
+	WorldBench* b = ctx;
+	Rectangle probe = b->probes[i % BENCH_PROBES];
+	for (int pass = 0; pass < 2; pass++) {
+		for (int id = 0; id < b->world.highWater; id++) {
+			const Block* block = WorldGet(&b->world, id);
+			if (block->active && CheckCollisionRecs(probe, block->rect)) b->sink++;
+		}
+	}
+}
+
+static void GridCollide(void* ctx, int i) {
+	WorldBench* b = ctx;
+	int ids[MAX_HITS];
+	Rectangle probe = b->probes[i % BENCH_PROBES];
+	for (int pass = 0; pass < 2; pass++) {
+		b->sink += GridQuery(&b->world.grid, probe, ids, MAX_HITS);
+	}
+}
+
+static void SolidCollide(void* ctx, int i) {
+	WorldBench* b = ctx;
+	const Rectangle* rects = NULL;
+	Rectangle probe = b->probes[i % BENCH_PROBES];
+	for (int pass = 0; pass < 2; pass++) {
+		b->sink += WorldCollide(&b->world, probe, &rects);
+	}
+}
+
+static void ScanFreeCheck(void* ctx, int i) {
+	WorldBench* b = ctx;
+	Rectangle probe = b->probes[i % BENCH_PROBES];
+	for (int id = 0; id < b->world.highWater; id++) {
+		const Block* block = WorldGet(&b->world, id);
+		if (block->active && CheckCollisionRecs(probe, block->rect)) {
+			b->sink++;
+			break;
+		}
+	}
+}
+
+static void GridFreeCheck(void* ctx, int i) {
+	WorldBench* b = ctx;
+	b->sink += GridOverlaps(&b->world.grid, b->probes[i % BENCH_PROBES]);
+}
+
+static void ScanPick(void* ctx, int i) {
+	WorldBench* b = ctx;
+	Vector2 point = b->points[i % BENCH_PROBES];
+	for (int id = 0; id < b->world.highWater; id++) {
+		const Block* block = WorldGet(&b->world, id);
+		if (block->active && CheckCollisionPointRec(point, block->rect)) b->sink++;
+	}
+}
+
+static void GridPick(void* ctx, int i) {
+	WorldBench* b = ctx;
+	int ids[MAX_HITS];
+	b->sink += GridQueryPoint(&b->world.grid, b->points[i % BENCH_PROBES], ids, MAX_HITS);
+}
+
+static void CellOccupied(void* ctx, int i) {
+	WorldBench* b = ctx;
+	Vector2 point = b->points[i % BENCH_PROBES];
+	b->sink += GridCellOccupied(&b->world.grid, (int)(point.x / BLOCK_SIZE), (int)(point.y / BLOCK_SIZE));
+}
+
+// A 32x32 cell area filled around whatever is already there, then erased.
+static void FillErase(void* ctx, int i) {
+	WorldBench* b = ctx;
+	Rectangle probe = b->probes[i % BENCH_PROBES];
+	Rectangle area = { probe.x, probe.y, 32 * BLOCK_SIZE, 32 * BLOCK_SIZE };
+	b->sink += EditFillRect(&b->world, area, RED, SHAPE_SQUARE, (Rectangle){ 0 });
+	b->sink += EditEraseRect(&b->world, area);
+}
+
+static void PlaceRemove(void* ctx, int i) {
+	WorldBench* b = ctx;
+	int id = WorldAdd(&b->world, b->freeCells[i % b->freeCount], RED, SHAPE_SQUARE);
+	WorldRemove(&b->world, id);
+}
+
+static void ScanCull(void* ctx, int i) {
+	WorldBench* b = ctx;
+	Rectangle view = b->views[i % BENCH_PROBES];
+	for (int id = 0; id < b->world.highWater; id++) {
+		const Block* block = WorldGet(&b->world, id);
+		if (block->active && CheckCollisionRecs(view, block->rect)) b->sink++;
+	}
+}
+
+static void GridCull(void* ctx, int i) {
+	WorldBench* b = ctx;
+	const int* ids = NULL;
+	b->sink += WorldQuery(&b->world, b->views[i % BENCH_PROBES], &ids);
+}
+
+static void PrepareWorld(WorldBench* b, int blockCount) {
+	WorldInit(&b->world);
+	GenerateWorld(&b->world, blockCount, &b->side);
+	b->sink = 0;
+
+	int extent = b->side * BLOCK_SIZE;
+	for (int i = 0; i < BENCH_PROBES; i++) {
+		float x = GetRandomValue(0, extent * 10) / 10.0f;
+		float y = GetRandomValue(0, extent * 10) / 10.0f;
+		b->probes[i] = (Rectangle){ x, y, 40, 40 };
+		b->points[i] = (Vector2){ x + 20, y + 20 };
+		b->views[i] = (Rectangle){ x - 640, y - 360, 1280, 720 };
+	}
+
+	// The first collision query merges every chunk; do it here so the
+	// collide cases only time queries.
+	const Rectangle* rects = NULL;
+	WorldCollide(&b->world, b->probes[0], &rects);
+
+	b->freeCount = 0;
+	for (int i = 0; i < BENCH_PROBES * 4 && b->freeCount < BENCH_PROBES; i++) {
+		Rectangle cell = { (float)(GetRandomValue(0, b->side - 1) * BLOCK_SIZE), (float)(GetRandomValue(0, b->side - 1) * BLOCK_SIZE), BLOCK_SIZE, BLOCK_SIZE };
+		if (!GridOverlaps(&b->world.grid, cell)) b->freeCells[b->freeCount++] = cell;
+	}
+}
+
+static void CheckGridAgainstScan(WorldBench* b) {
+	int ids[MAX_HITS];
+	for (int i = 0; i < 256; i++) {
+		int expected = 0;
+		for (int id = 0; id < b->world.highWater; id++) {
+			const Block* block = WorldGet(&b->world, id);
+			if (block->active && CheckCollisionRecs(b->probes[i], block->rect)) expected++;
+		}
+		if (GridQuery(&b->world.grid, b->probes[i], ids, MAX_HITS) != expected) {
+			BenchFail("grid query disagrees with a full scan");
+			return;
+		}
+	}
+}
+
+static void SimStepCase(void* ctx, int i) {
+	WorldState* state = ctx;
+	InputFrame input = { 0 };
+	input.right = (i / 120) % 2 == 0;
+	input.left = !input.right;
+	input.jumpPressed = (i % 45) == 0;
+	input.mouseWorld = (Vector2){ state->player.position.x + 80, state->player.position.y - 80 };
+	input.placeHeld = (i % 7) == 0;
+	input.removeHeld = (i % 11) == 0;
+	input.blockColor = RED;
+	input.blockShape = SHAPE_SQUARE;
+	SimStep(state, &input, 1.0f / 60.0f);
+}
+
+void RunWorldBenchmarks(void) {
+	static WorldBench b;
+	int sizes[] = { 2000, 50000, 500000 };
+
+	for (int s = 0; s < 3; s++) {
+		PrepareWorld(&b, sizes[s]);
+		CheckGridAgainstScan(&b);
+
+		BenchCase("collide/scan", "blocks", sizes[s], ScanCollide, &b);
+		BenchCase("collide/grid", "blocks", sizes[s], GridCollide, &b);
+		BenchCase("collide/solids", "blocks", sizes[s], SolidCollide, &b);
+		BenchCase("place/free_check_scan", "blocks", sizes[s], ScanFreeCheck, &b);
+		BenchCase("place/free_check_grid", "blocks", sizes[s], GridFreeCheck, &b);
+		BenchCase("place/add_remove", "blocks", sizes[s], PlaceRemove, &b);
+		BenchCase("place/cell_occupied", "blocks", sizes[s], CellOccupied, &b);
+		BenchCase("remove/pick_scan", "blocks", sizes[s], ScanPick, &b);
+		BenchCase("remove/pick_grid", "blocks", sizes[s], GridPick, &b);
+		BenchCase("cull/scan", "blocks", sizes[s], ScanCull, &b);
+		BenchCase("cull/grid", "blocks", sizes[s], GridCull, &b);
+		BenchCase("edit/fill_erase_32x32", "blocks", sizes[s], FillErase, &b);
+
+		WorldFree(&b.world);
+	}
+
+	for (int s = 0; s < 3; s++) {
+		WorldState state;
+		SimInit(&state);
+		int side = 0;
+		GenerateWorld(&state.world, sizes[s], &side);
+		BenchCase("sim/step", "blocks", sizes[s], SimStepCase, &state);
+		SimFree(&state);
+	}
+}
@@ -0,0 +1,195 @@
+#include "assets.h"
+#include "console.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double NowSeconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void AssetLoaderInit(AssetLoader* loader, const AssetPack* pack) {
+	memset(loader, 0, sizeof(*loader));
+	loader->pack = pack;
+	atomic_init(&loader->next, 0);
+	atomic_init(&loader->cancel, false);
+}
+
+int AssetQueue(AssetLoader* loader, AssetType type, const char* fileName) {
+	int packed = 0;
+	const unsigned char* data = (loader->pack != NULL) ? PackFind(loader->pack, fileName, &packed) : NULL;
+	if (data == NULL && !FileExists(fileName)) return -1;
+
+	if (loader->count == loader->capacity) {
+		loader->capacity = (loader->capacity > 0) ? loader->capacity * 2 : 32;
+		loader->assets = realloc(loader->assets, (size_t)loader->capacity * sizeof(Asset));
+	}
+
+	Asset* asset = &loader->assets[loader->count];
+	memset(asset, 0, sizeof(*asset));
+	asset->type = type;
+	snprintf(asset->fileName, sizeof(asset->fileName), "%s", fileName);
+	asset->data = data;
+	// Empty files still count for something on the progress bar.
+	asset->bytes = (data != NULL) ? packed : GetFileLength(fileName);
+	if (asset->bytes < 1) asset->bytes = 1;
+	atomic_init(&asset->done, false);
+
+	loader->totalBytes += asset->bytes;
+	return loader->count++;
+}
+
+static void DecodeAsset(Asset* asset) {
+	double t0 = NowSeconds();
+	const char* fileType = GetFileExtension(asset->fileName);
+	switch (asset->type) {
+	case ASSET_IMAGE:
+		if (asset->data != NULL) asset->image = LoadImageFromMemory(fileType, asset->data, asset->bytes);
+		else asset->image = LoadImage(asset->fileName);
+		if (asset->image.data != NULL) ImageFormat(&asset->image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+		break;
+	case ASSET_SOUND: {
+		Wave wave = (asset->data != NULL) ? LoadWaveFromMemory(fileType, asset->data, asset->bytes) : LoadWave(asset->fileName);
+		if (wave.data != NULL) asset->sound = LoadSoundFromWave(wave);
+		UnloadWave(wave);
+		break;
+	}
+	case ASSET_MUSIC:
+		if (asset->data != NULL) asset->music = LoadMusicStreamFromMemory(fileType, asset->data, asset->bytes);
+		else asset->music = LoadMusicStream(asset->fileName);
+		break;
+	}
+	asset->seconds = NowSeconds() - t0;
+	atomic_store(&asset->done, true);
+}
+
+static void* AssetWorker(void* arg) {
+	AssetLoader* loader = arg;
+	while (!atomic_load(&loader->cancel)) {
+		int i = atomic_fetch_add(&loader->next, 1);
+		if (i >= loader->count) break;
+		DecodeAsset(&loader->assets[loader->order[i]]);
+	}
+	return NULL;
+}
+
+static AssetLoader* sortLoader = NULL;
+
+static int CompareSize(const void* a, const void* b) {
+	int x = sortLoader->assets[*(const int*)a].bytes;
+	int y = sortLoader->assets[*(const int*)b].bytes;
+	if (x != y) return (x < y) - (x > y);
+	return *(const int*)a - *(const int*)b;
+}
+
+void AssetLoaderStart(AssetLoader* loader, int workers) {
+	loader->startTime = NowSeconds();
+
+	// One big song should not be the last thing a worker picks up.
+	loader->order = malloc((size_t)(loader->count > 0 ? loader->count : 1) * sizeof(int));
+	for (int i = 0; i < loader->count; i++) loader->order[i] = i;
+	sortLoader = loader;
+	qsort(loader->order, (size_t)loader->count, sizeof(int), CompareSize);
+	sortLoader = NULL;
+
+	if (workers <= 0) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		workers = (cores > 1) ? (int)cores - 1 : 1;
+	}
+	if (workers > ASSET_MAX_WORKERS) workers = ASSET_MAX_WORKERS;
+	if (workers > loader->count) workers = loader->count;
+
+	for (int i = 0; i < workers; i++) {
+		if (pthread_create(&loader->workers[loader->workerCount], NULL, AssetWorker, loader) != 0) break;
+		loader->workerCount++;
+	}
+
+	if (loader->workerCount == 0 && loader->count > 0) {
+		AddConsoleLogf(CONSOLE_WARNING, "Assets: could not start worker threads, loading on the main thread");
+		AssetWorker(loader);
+	}
+}
+
+static void JoinWorkers(AssetLoader* loader) {
+	for (int i = 0; i < loader->workerCount; i++) pthread_join(loader->workers[i], NULL);
+	loader->workerCount = 0;
+}
+
+static bool AssetFailed(const Asset* asset) {
+	switch (asset->type) {
+	case ASSET_IMAGE: return asset->image.data == NULL;
+	case ASSET_SOUND: return asset->sound.stream.buffer == NULL;
+	case ASSET_MUSIC: return asset->music.stream.buffer == NULL;
+	}
+	return true;
+}
+
+bool AssetLoaderUpdate(AssetLoader* loader) {
+	if (loader->finished) return true;
+
+	double decodeSeconds = 0.0;
+	for (int i = 0; i < loader->count; i++) {
+		Asset* asset = &loader->assets[i];
+		if (!asset->reported && atomic_load(&asset->done)) {
+			asset->reported = true;
+			loader->doneCount++;
+			loader->doneBytes += asset->bytes;
+			if (AssetFailed(asset)) AddConsoleLogf(CONSOLE_WARNING, "Asset: %s could not be decoded", asset->fileName);
+			else AddConsoleLogf(CONSOLE_INFO, "Asset: %s decoded in %.1f ms%s", asset->fileName, asset->seconds * 1000.0, (asset->data != NULL) ? " from the pack" : "");
+		}
+		if (asset->reported) decodeSeconds += asset->seconds;
+	}
+	if (loader->doneCount < loader->count) return false;
+
+	int workers = loader->workerCount;
+	JoinWorkers(loader);
+	loader->finished = true;
+	AddConsoleLogf(CONSOLE_INFO, "Assets: %d files in %.1f ms on %d workers (%.1f ms of decoding)", loader->count,
+		(NowSeconds() - loader->startTime) * 1000.0, workers, decodeSeconds * 1000.0);
+	return true;
+}
+
+float AssetLoaderProgress(const AssetLoader* loader) {
+	if (loader->totalBytes == 0) return 1.0f;
+	return (float)((double)loader->doneBytes / (double)loader->totalBytes);
+}
+
+Image AssetTakeImage(AssetLoader* loader, int handle) {
+	if (handle < 0 || handle >= loader->count || loader->assets[handle].taken) return (Image){ 0 };
+	loader->assets[handle].taken = true;
+	return loader->assets[handle].image;
+}
+
+Sound AssetTakeSound(AssetLoader* loader, int handle) {
+	if (handle < 0 || handle >= loader->count || loader->assets[handle].taken) return (Sound){ 0 };
+	loader->assets[handle].taken = true;
+	return loader->assets[handle].sound;
+}
+
+Music AssetTakeMusic(AssetLoader* loader, int handle) {
+	if (handle < 0 || handle >= loader->count || loader->assets[handle].taken) return (Music){ 0 };
+	loader->assets[handle].taken = true;
+	return loader->assets[handle].music;
+}
+
+void AssetLoaderFree(AssetLoader* loader) {
+	atomic_store(&loader->cancel, true);
+	JoinWorkers(loader);
+
+	for (int i = 0; i < loader->count; i++) {
+		Asset* asset = &loader->assets[i];
+		if (asset->taken || !atomic_load(&asset->done) || AssetFailed(asset)) continue;
+		switch (asset->type) {
+		case ASSET_IMAGE: UnloadImage(asset->image); break;
+		case ASSET_SOUND: UnloadSound(asset->sound); break;
+		case ASSET_MUSIC: UnloadMusicStream(asset->music); break;
+		}
+	}
+	free(loader->assets);
+	free(loader->order);
+	memset(loader, 0, sizeof(*loader));
+}
@@ -0,0 +1,86 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "raylib.h"
+#include "pack.h"
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define ASSET_MAX_WORKERS 8
+
+// Startup assets decoded on a pool of worker threads. Files are queued on
+// the main thread, then workers claim them one at a time and decode them:
+// images to RGBA pixels, sounds to audio buffers and music to an opened
+// stream. raylib registers audio buffers under the audio device's own lock,
+// so only the GPU upload of images is left for the main thread, through the
+// sprite atlas. AssetLoaderUpdate is polled once per frame and logs each
+// asset as it lands, with the time its decode took.
+//
+// Files are looked up in the asset pack first and decoded straight from its
+// mapping; only names the pack does not have are read as loose files, so
+// new custom blocks can still be dropped in next to it.
+
+typedef enum { ASSET_IMAGE, ASSET_SOUND, ASSET_MUSIC } AssetType;
+
+typedef struct {
+	AssetType type;
+	char fileName[256];
+	const unsigned char* data;
+	int bytes;
+
+	Image image;
+	Sound sound;
+	Music music;
+	bool taken;
+
+	double seconds;
+	atomic_bool done;
+	bool reported;
+} Asset;
+
+typedef struct {
+	const AssetPack* pack;
+	Asset* assets;
+	int count;
+	int capacity;
+	int* order;
+
+	pthread_t workers[ASSET_MAX_WORKERS];
+	int workerCount;
+	atomic_int next;
+	atomic_bool cancel;
+
+	long long totalBytes;
+	long long doneBytes;
+	int doneCount;
+	double startTime;
+	bool finished;
+} AssetLoader;
+
+// pack may be NULL. Music decoded from it keeps reading the mapping, so the
+// pack must stay open until the songs are unloaded.
+void AssetLoaderInit(AssetLoader* loader, const AssetPack* pack);
+// Queues fileName. Returns the asset's handle, or -1 if neither the pack
+// nor the disk has it. Everything must be queued before AssetLoaderStart.
+int AssetQueue(AssetLoader* loader, AssetType type, const char* fileName);
+// Starts `workers` threads, or one per core but the main thread's for 0.
+// The largest files are handed out first. If no thread can be started the
+// assets are decoded here instead.
+void AssetLoaderStart(AssetLoader* loader, int workers);
+// Logs what finished since the last call. Returns true once every asset is in.
+bool AssetLoaderUpdate(AssetLoader* loader);
+// Share of the queued bytes decoded so far, 0 to 1.
+float AssetLoaderProgress(const AssetLoader* loader);
+
+// Hand a finished asset over to the caller, who unloads it from then on.
+// A file that failed to decode gives an empty image, sound or music.
+Image AssetTakeImage(AssetLoader* loader, int handle);
+Sound AssetTakeSound(AssetLoader* loader, int handle);
+Music AssetTakeMusic(AssetLoader* loader, int handle);
+
+// Stops the workers, waiting for decodes already running, and unloads
+// whatever was not taken.
+void AssetLoaderFree(AssetLoader* loader);
+
+#endif
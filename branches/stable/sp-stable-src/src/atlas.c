@@ -0,0 +1,204 @@
+#include "atlas.h"
+#include "console.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const TextureAtlas* sortAtlas = NULL;
+
+static int CompareHeight(const void* a, const void* b) {
+	int ia = *(const int*)a;
+	int ib = *(const int*)b;
+	int ha = sortAtlas->pending[ia].height;
+	int hb = sortAtlas->pending[ib].height;
+	if (ha != hb) return hb - ha;
+	return ia - ib;
+}
+
+// Shelf packing, tallest sprites first. Returns the height used, or -1 when a
+// row of the given width cannot hold every sprite within ATLAS_MAX_SIZE.
+static int PackShelves(TextureAtlas* atlas, const int* order, int width) {
+	int x = 0, y = 0, shelfHeight = 0;
+
+	for (int i = 0; i < atlas->count; i++) {
+		const Image* img = &atlas->pending[order[i]];
+		int w = img->width + atlas->padding * 2;
+		int h = img->height + atlas->padding * 2;
+		if (w > width) return -1;
+
+		if (x + w > width) {
+			y += shelfHeight;
+			x = 0;
+			shelfHeight = 0;
+		}
+		if (y + h > ATLAS_MAX_SIZE) return -1;
+
+		atlas->sources[order[i]] = (Rectangle){ (float)(x + atlas->padding), (float)(y + atlas->padding), (float)img->width, (float)img->height };
+		x += w;
+		if (h > shelfHeight) shelfHeight = h;
+	}
+	return y + shelfHeight;
+}
+
+static void CopySprite(unsigned char* dst, int dstWidth, const Image* img, int x0, int y0, int border) {
+	const unsigned char* src = img->data;
+
+	for (int y = -border; y < img->height + border; y++) {
+		int sy = (y < 0) ? 0 : (y >= img->height) ? img->height - 1 : y;
+		unsigned char* row = dst + ((size_t)(y0 + y) * dstWidth + x0) * 4;
+		const unsigned char* srcRow = src + (size_t)sy * img->width * 4;
+
+		memcpy(row, srcRow, (size_t)img->width * 4);
+		for (int b = 1; b <= border; b++) {
+			memcpy(row - b * 4, srcRow, 4);
+			memcpy(row + (img->width - 1 + b) * 4, srcRow + (img->width - 1) * 4, 4);
+		}
+	}
+}
+
+void AtlasInit(TextureAtlas* atlas, int padding, bool extrude) {
+	memset(atlas, 0, sizeof(TextureAtlas));
+	atlas->padding = padding;
+	atlas->extrude = extrude;
+}
+
+void AtlasFree(TextureAtlas* atlas) {
+	if (atlas->pending != NULL) {
+		for (int i = 0; i < atlas->count; i++) UnloadImage(atlas->pending[i]);
+	}
+	if (atlas->texture.id != 0) UnloadTexture(atlas->texture);
+	free(atlas->pending);
+	free(atlas->sources);
+	AtlasInit(atlas, atlas->padding, atlas->extrude);
+}
+
+int AtlasAddImage(TextureAtlas* atlas, Image image) {
+	if (image.data == NULL || image.width <= 0 || image.height <= 0) return -1;
+	if (atlas->count > 0 && atlas->pending == NULL) {
+		UnloadImage(image);
+		return -1;
+	}
+
+	if (atlas->count == atlas->capacity) {
+		atlas->capacity = (atlas->capacity > 0) ? atlas->capacity * 2 : 32;
+		atlas->pending = realloc(atlas->pending, (size_t)atlas->capacity * sizeof(Image));
+		atlas->sources = realloc(atlas->sources, (size_t)atlas->capacity * sizeof(Rectangle));
+	}
+
+	ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+	atlas->pending[atlas->count] = image;
+	atlas->sources[atlas->count] = (Rectangle){ 0, 0, (float)image.width, (float)image.height };
+	return atlas->count++;
+}
+
+int AtlasAddFile(TextureAtlas* atlas, const char* fileName) {
+	if (!FileExists(fileName)) return -1;
+	return AtlasAddImage(atlas, LoadImage(fileName));
+}
+
+bool AtlasBuild(TextureAtlas* atlas, bool mipmaps) {
+	if (atlas->count == 0 || atlas->pending == NULL) return false;
+
+	int* order = malloc((size_t)atlas->count * sizeof(int));
+	long long area = 0;
+	for (int i = 0; i < atlas->count; i++) {
+		order[i] = i;
+		area += (long long)(atlas->pending[i].width + atlas->padding * 2) * (atlas->pending[i].height + atlas->padding * 2);
+	}
+
+	sortAtlas = atlas;
+	qsort(order, (size_t)atlas->count, sizeof(int), CompareHeight);
+	sortAtlas = NULL;
+
+	// Smallest power of two width whose packing also fits in that height.
+	int width = 64;
+	while ((long long)width * width < area && width < ATLAS_MAX_SIZE) width *= 2;
+
+	int height = -1;
+	for (; width <= ATLAS_MAX_SIZE; width *= 2) {
+		height = PackShelves(atlas, order, width);
+		if (height > 0 && height <= width) break;
+	}
+	free(order);
+
+	if (height <= 0 || width > ATLAS_MAX_SIZE) {
+		AddConsoleLog("Atlas: sprites do not fit in the texture size limit");
+		return false;
+	}
+
+	int texHeight = 1;
+	while (texHeight < height) texHeight *= 2;
+
+	unsigned char* pixels = calloc((size_t)width * texHeight, 4);
+	int border = atlas->extrude ? atlas->padding : 0;
+	for (int i = 0; i < atlas->count; i++) {
+		CopySprite(pixels, width, &atlas->pending[i], (int)atlas->sources[i].x, (int)atlas->sources[i].y, border);
+		UnloadImage(atlas->pending[i]);
+	}
+	free(atlas->pending);
+	atlas->pending = NULL;
+
+	Image image = { pixels, width, texHeight, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+	atlas->texture = LoadTextureFromImage(image);
+	free(pixels);
+
+	atlas->mipmaps = mipmaps;
+	if (mipmaps) {
+		GenTextureMipmaps(&atlas->texture);
+		SetTextureFilter(atlas->texture, TEXTURE_FILTER_TRILINEAR);
+	}
+
+	AddConsoleLogf(CONSOLE_INFO, "Atlas: %d sprites packed in %dx%d", atlas->count, width, texHeight);
+	return atlas->texture.id != 0;
+}
+
+int AtlasReplace(TextureAtlas* atlas, int sprite, Image image) {
+	if (image.data == NULL || image.width <= 0 || image.height <= 0 || atlas->texture.id == 0 || sprite >= atlas->count) {
+		UnloadImage(image);
+		return -1;
+	}
+	ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+	if (sprite >= 0 && image.width == (int)atlas->sources[sprite].width && image.height == (int)atlas->sources[sprite].height) {
+		int border = atlas->extrude ? atlas->padding : 0;
+		int w = image.width + border * 2;
+		int h = image.height + border * 2;
+		unsigned char* pixels = malloc((size_t)w * h * 4);
+		CopySprite(pixels, w, &image, border, border, border);
+
+		Rectangle rect = { atlas->sources[sprite].x - border, atlas->sources[sprite].y - border, (float)w, (float)h };
+		UpdateTextureRec(atlas->texture, rect, pixels);
+		if (atlas->mipmaps) GenTextureMipmaps(&atlas->texture);
+
+		free(pixels);
+		UnloadImage(image);
+		return sprite;
+	}
+
+	// Cut every sprite back out of the texture and pack them all again.
+	Image sheet = LoadImageFromTexture(atlas->texture);
+	if (sheet.data == NULL) {
+		UnloadImage(image);
+		return -1;
+	}
+	ImageFormat(&sheet, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+	// The packing goes into a second atlas so a failed build leaves the
+	// current texture in use.
+	TextureAtlas rebuilt;
+	AtlasInit(&rebuilt, atlas->padding, atlas->extrude);
+	if (sprite < 0) sprite = atlas->count;
+	int count = (sprite == atlas->count) ? atlas->count + 1 : atlas->count;
+	for (int i = 0; i < count; i++) {
+		AtlasAddImage(&rebuilt, (i == sprite) ? image : ImageFromImage(sheet, atlas->sources[i]));
+	}
+	UnloadImage(sheet);
+
+	if (rebuilt.count != count || !AtlasBuild(&rebuilt, atlas->mipmaps)) {
+		AtlasFree(&rebuilt);
+		return -1;
+	}
+	UnloadTexture(atlas->texture);
+	free(atlas->sources);
+	*atlas = rebuilt;
+	return sprite;
+}
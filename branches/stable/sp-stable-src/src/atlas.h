@@ -0,0 +1,52 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "raylib.h"
+#include <stdbool.h>
+
+#define ATLAS_MAX_SIZE 8192
+
+// Packs loose images into one texture so everything sampling it stays in a
+// single rlgl batch. Images are queued with AtlasAdd* and uploaded together
+// by AtlasBuild; sprites are referred to by the index AtlasAdd* returned.
+// Every sprite gets `padding` pixels of space around it, filled by repeating
+// its edge pixels when `extrude` is set so filtering and mipmaps never pick
+// up a neighbour.
+
+typedef struct {
+	Texture2D texture;
+	Rectangle* sources;
+	Image* pending;
+	int count;
+	int capacity;
+	int padding;
+	bool extrude;
+	bool mipmaps;
+} TextureAtlas;
+
+void AtlasInit(TextureAtlas* atlas, int padding, bool extrude);
+void AtlasFree(TextureAtlas* atlas);
+
+// Takes ownership of image. Returns the sprite index, or -1 if image is invalid.
+int AtlasAddImage(TextureAtlas* atlas, Image image);
+int AtlasAddFile(TextureAtlas* atlas, const char* fileName);
+
+bool AtlasBuild(TextureAtlas* atlas, bool mipmaps);
+
+// Swaps in new pixels for sprite after AtlasBuild, taking ownership of
+// image; sprite -1 adds it as a new sprite. A sprite that keeps its size is
+// rewritten in place. Otherwise the texture is read back and packed again,
+// which moves other sprites, so sources must not be cached across a call.
+// Returns the sprite index, or -1 if the atlas could not be updated, in
+// which case it is left as it was.
+int AtlasReplace(TextureAtlas* atlas, int sprite, Image image);
+
+static inline bool AtlasHas(const TextureAtlas* atlas, int sprite) {
+	return sprite >= 0 && sprite < atlas->count && atlas->texture.id != 0;
+}
+
+static inline Rectangle AtlasSource(const TextureAtlas* atlas, int sprite) {
+	return atlas->sources[sprite];
+}
+
+#endif
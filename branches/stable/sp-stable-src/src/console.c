@@ -0,0 +1,224 @@
+#include "console.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define CONSOLE_MASK (CONSOLE_HISTORY - 1)
+#define SINK_INTERVAL_NS 100000000L
+// Passes the sink waits for a record that is not there yet before it
+// assumes the record was dropped.
+#define SINK_PATIENCE 10
+
+// state is 0 while empty, (seq + 1) * 2 once record seq is in the slot, and
+// that value + 1 while a writer is filling it.
+typedef struct {
+	atomic_ullong state;
+	ConsoleRecord record;
+} ConsoleSlot;
+
+static ConsoleSlot ring[CONSOLE_HISTORY];
+static atomic_ullong head = 0;
+static atomic_ullong clearedAt = 0;
+
+int consoleScroll = 0;
+
+static struct timespec startTime;
+static pthread_once_t startOnce = PTHREAD_ONCE_INIT;
+
+static void InitStartTime(void) {
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+}
+
+static double ConsoleTime(void) {
+	pthread_once(&startOnce, InitStartTime);
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)(now.tv_sec - startTime.tv_sec) + (double)(now.tv_nsec - startTime.tv_nsec) * 1e-9;
+}
+
+// Claims the slot for a new record. Returns NULL, and the record is dropped,
+// if a writer that stalled a whole lap behind still holds the slot.
+static ConsoleSlot* BeginRecord(unsigned long long* seq) {
+	*seq = atomic_fetch_add_explicit(&head, 1, memory_order_relaxed);
+	ConsoleSlot* slot = &ring[*seq & CONSOLE_MASK];
+
+	unsigned long long state = atomic_load_explicit(&slot->state, memory_order_relaxed);
+	if (state & 1) return NULL;
+	if (!atomic_compare_exchange_strong_explicit(&slot->state, &state, (*seq + 1) * 2 + 1, memory_order_acquire, memory_order_relaxed)) return NULL;
+	return slot;
+}
+
+static void EndRecord(ConsoleSlot* slot, unsigned long long seq) {
+	atomic_store_explicit(&slot->state, (seq + 1) * 2, memory_order_release);
+}
+
+void AddConsoleLog(const char* text) {
+	unsigned long long seq;
+	ConsoleSlot* slot = BeginRecord(&seq);
+	if (slot == NULL) return;
+
+	slot->record.time = ConsoleTime();
+	slot->record.level = CONSOLE_INFO;
+	snprintf(slot->record.text, CONSOLE_LINE, "%s", text);
+	EndRecord(slot, seq);
+}
+
+void AddConsoleLogf(ConsoleLevel level, const char* format, ...) {
+	unsigned long long seq;
+	ConsoleSlot* slot = BeginRecord(&seq);
+	if (slot == NULL) return;
+
+	slot->record.time = ConsoleTime();
+	slot->record.level = level;
+	va_list args;
+	va_start(args, format);
+	vsnprintf(slot->record.text, CONSOLE_LINE, format, args);
+	va_end(args);
+	EndRecord(slot, seq);
+}
+
+// Seqlock style read: the copy only counts if the slot held record seq both
+// before and after it.
+static bool ReadRecord(unsigned long long seq, ConsoleRecord* record) {
+	const ConsoleSlot* slot = &ring[seq & CONSOLE_MASK];
+	unsigned long long expected = (seq + 1) * 2;
+
+	if (atomic_load_explicit(&slot->state, memory_order_acquire) != expected) return false;
+	memcpy(record, &slot->record, sizeof(ConsoleRecord));
+	atomic_thread_fence(memory_order_acquire);
+	if (atomic_load_explicit(&slot->state, memory_order_relaxed) != expected) return false;
+
+	record->text[CONSOLE_LINE - 1] = '\0';
+	return true;
+}
+
+void ClearConsoleLog(void) {
+	atomic_store(&clearedAt, atomic_load(&head));
+	consoleScroll = 0;
+}
+
+int GetConsoleLineCount(void) {
+	unsigned long long count = atomic_load(&head) - atomic_load(&clearedAt);
+	return (count > CONSOLE_HISTORY) ? CONSOLE_HISTORY : (int)count;
+}
+
+unsigned long long GetConsoleSequence(void) {
+	return atomic_load(&head);
+}
+
+bool GetConsoleLine(int back, ConsoleRecord* record) {
+	if (back < 0 || back >= GetConsoleLineCount()) return false;
+	return ReadRecord(atomic_load(&head) - 1 - (unsigned long long)back, record);
+}
+
+static const char* levelNames[] = { "INFO", "WARN", "ERROR" };
+
+static struct {
+	bool running;
+	pthread_t thread;
+	atomic_bool stop;
+	FILE* file;
+	char fileName[256];
+	long maxBytes;
+	long bytes;
+	int keep;
+	unsigned long long next;
+	int waited;
+} sink = { 0 };
+
+static void RotateSink(void) {
+	fclose(sink.file);
+
+	char from[300], to[300];
+	for (int i = sink.keep - 1; i >= 1; i--) {
+		snprintf(from, sizeof(from), "%s.%d", sink.fileName, i);
+		snprintf(to, sizeof(to), "%s.%d", sink.fileName, i + 1);
+		rename(from, to);
+	}
+	snprintf(to, sizeof(to), "%s.1", sink.fileName);
+	rename(sink.fileName, to);
+
+	sink.file = fopen(sink.fileName, "w");
+	sink.bytes = 0;
+	if (sink.file == NULL) AddConsoleLogf(CONSOLE_WARNING, "Console: could not reopen %s, file logging stopped", sink.fileName);
+}
+
+// Writes every finished record up to the current head. A record that is not
+// in its slot yet holds the sink back for a few passes; one that was
+// overwritten before the sink got to it is reported as lost. Once a
+// rotation has failed to reopen the file there is nowhere to write to.
+static void DrainSink(bool final) {
+	if (sink.file == NULL) return;
+	unsigned long long end = atomic_load(&head);
+	if (end - sink.next > CONSOLE_HISTORY) {
+		unsigned long long lost = end - CONSOLE_HISTORY - sink.next;
+		sink.bytes += fprintf(sink.file, "... %llu records lost ...\n", lost);
+		sink.next = end - CONSOLE_HISTORY;
+	}
+
+	while (sink.next < end && sink.file != NULL) {
+		ConsoleRecord record;
+		if (!ReadRecord(sink.next, &record)) {
+			unsigned long long state = atomic_load(&ring[sink.next & CONSOLE_MASK].state);
+			bool pending = state <= (sink.next + 1) * 2 + 1;
+			if (pending && !final && ++sink.waited < SINK_PATIENCE) break;
+			sink.waited = 0;
+			sink.next++;
+			continue;
+		}
+
+		sink.waited = 0;
+		sink.bytes += fprintf(sink.file, "[%10.3f] %-5s %s\n", record.time, levelNames[record.level], record.text);
+		sink.next++;
+		if (sink.keep > 0 && sink.bytes > sink.maxBytes) RotateSink();
+	}
+	if (sink.file != NULL) fflush(sink.file);
+}
+
+static void* SinkThread(void* arg) {
+	(void)arg;
+	struct timespec interval = { 0, SINK_INTERVAL_NS };
+	while (!atomic_load(&sink.stop) && sink.file != NULL) {
+		DrainSink(false);
+		nanosleep(&interval, NULL);
+	}
+	DrainSink(true);
+	return NULL;
+}
+
+bool StartConsoleFileSink(const char* fileName, long maxBytes, int keep) {
+	if (sink.running) return false;
+
+	snprintf(sink.fileName, sizeof(sink.fileName), "%s", fileName);
+	sink.file = fopen(sink.fileName, "w");
+	if (sink.file == NULL) return false;
+
+	sink.maxBytes = maxBytes;
+	sink.bytes = 0;
+	sink.keep = keep;
+	sink.waited = 0;
+	unsigned long long now = atomic_load(&head);
+	sink.next = (now > CONSOLE_HISTORY) ? now - CONSOLE_HISTORY : 0;
+	atomic_store(&sink.stop, false);
+
+	if (pthread_create(&sink.thread, NULL, SinkThread, NULL) != 0) {
+		fclose(sink.file);
+		sink.file = NULL;
+		return false;
+	}
+	sink.running = true;
+	return true;
+}
+
+void StopConsoleFileSink(void) {
+	if (!sink.running) return;
+
+	atomic_store(&sink.stop, true);
+	pthread_join(sink.thread, NULL);
+	if (sink.file != NULL) fclose(sink.file);
+	sink.file = NULL;
+	sink.running = false;
+}
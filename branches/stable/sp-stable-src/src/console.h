@@ -0,0 +1,48 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdbool.h>
+
+#define CONSOLE_HISTORY 1024
+#define CONSOLE_VISIBLE 15
+#define CONSOLE_LINE 128
+
+// The console is a fixed ring of records that any thread can append to
+// without locks: a writer claims a sequence number with one atomic add and
+// fills the slot it maps to, overwriting the oldest record. Readers (the F10
+// console and the optional file sink) copy a record out and check that it
+// was not rewritten meanwhile, so they never block a writer either.
+
+typedef enum { CONSOLE_INFO, CONSOLE_WARNING, CONSOLE_ERROR } ConsoleLevel;
+
+typedef struct {
+	double time;
+	ConsoleLevel level;
+	char text[CONSOLE_LINE];
+} ConsoleRecord;
+
+extern int consoleScroll;
+
+// Safe to call from any thread. AddConsoleLogf formats with vsnprintf, so
+// unlike TextFormat it can be used off the main thread too.
+void AddConsoleLog(const char* text);
+void AddConsoleLogf(ConsoleLevel level, const char* format, ...);
+
+// Hides everything logged so far from the console; the file sink still gets it.
+void ClearConsoleLog(void);
+
+// Records currently shown by the console, at most CONSOLE_HISTORY.
+int GetConsoleLineCount(void);
+// Total records ever logged, used to notice new ones.
+unsigned long long GetConsoleSequence(void);
+// back 0 is the newest record. Returns false if it is gone or still being written.
+bool GetConsoleLine(int back, ConsoleRecord* record);
+
+// Streams every record to fileName on a background thread. When the file
+// passes maxBytes it is renamed to fileName.1 (older ones shift up to
+// fileName.<keep>) and a new one is started.
+bool StartConsoleFileSink(const char* fileName, long maxBytes, int keep);
+// Writes out what is left and stops the thread.
+void StopConsoleFileSink(void);
+
+#endif
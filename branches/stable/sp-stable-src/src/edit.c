@@ -0,0 +1,127 @@
+#include "edit.h"
+#include <stdlib.h>
+#include <math.h>
+
+static int CellFloor(float v) {
+	return (int)floorf(v / BLOCK_SIZE);
+}
+
+static int CellLast(float v) {
+	return (int)ceilf(v / BLOCK_SIZE) - 1;
+}
+
+static Rectangle CellRect(int x, int y, int cells) {
+	return (Rectangle){ (float)(x * BLOCK_SIZE), (float)(y * BLOCK_SIZE), (float)(cells * BLOCK_SIZE), (float)BLOCK_SIZE };
+}
+
+static bool Fillable(const World* world, int x, int y, Rectangle avoid) {
+	return !GridCellOccupied(&world->grid, x, y) && !CheckCollisionRecs(CellRect(x, y, 1), avoid);
+}
+
+// Cells x0..x1 of row y are all free. A SHAPE_RECT block takes two of them,
+// so an odd cell at the end of a run stays empty.
+static int FillRun(World* world, int x0, int x1, int y, Color color, BlockShape shape) {
+	int cells = (shape == SHAPE_RECT) ? 2 : 1;
+	int added = 0;
+	for (int x = x0; x + cells - 1 <= x1; x += cells) {
+		WorldAdd(world, CellRect(x, y, cells), color, shape);
+		added++;
+	}
+	return added;
+}
+
+int EditFillRect(World* world, Rectangle area, Color color, BlockShape shape, Rectangle avoid) {
+	int x0 = CellFloor(area.x), x1 = CellLast(area.x + area.width);
+	int y0 = CellFloor(area.y), y1 = CellLast(area.y + area.height);
+	if (x1 < x0 || y1 < y0) return 0;
+	if ((long long)(x1 - x0 + 1) * (y1 - y0 + 1) > EDIT_MAX_CELLS) return -1;
+
+	int added = 0;
+	for (int y = y0; y <= y1; y++) {
+		int run = -1;
+		for (int x = x0; x <= x1 + 1; x++) {
+			bool empty = (x <= x1) && Fillable(world, x, y, avoid);
+			if (empty && run == -1) run = x;
+			if (!empty && run != -1) {
+				added += FillRun(world, run, x - 1, y, color, shape);
+				run = -1;
+			}
+		}
+	}
+	return added;
+}
+
+int EditEraseRect(World* world, Rectangle area) {
+	const int* ids;
+	int count = WorldQuery(world, area, &ids);
+
+	int removed = 0;
+	for (int i = 0; i < count; i++) {
+		if (ids[i] == 0) continue;
+		WorldRemove(world, ids[i]);
+		removed++;
+	}
+	return removed;
+}
+
+int EditFloodFill(World* world, Vector2 start, Color color, BlockShape shape, Rectangle avoid) {
+	const int side = EDIT_FLOOD_RADIUS * 2 + 1;
+	int sx = CellFloor(start.x);
+	int sy = CellFloor(start.y);
+	if (GridCellOccupied(&world->grid, sx, sy)) return -1;
+
+	// Cells are visited inside a box around the start; reaching its border
+	// means the region is open.
+	int ox = sx - EDIT_FLOOD_RADIUS;
+	int oy = sy - EDIT_FLOOD_RADIUS;
+	unsigned char* region = calloc((size_t)side * side, 1);
+	int* queue = malloc((size_t)EDIT_MAX_CELLS * sizeof(int));
+	int head = 0, tail = 0;
+
+	region[EDIT_FLOOD_RADIUS * side + EDIT_FLOOD_RADIUS] = 1;
+	queue[tail++] = EDIT_FLOOD_RADIUS * side + EDIT_FLOOD_RADIUS;
+
+	bool closed = true;
+	while (head < tail && closed) {
+		int cell = queue[head++];
+		int lx = cell % side;
+		int ly = cell / side;
+		if (lx == 0 || ly == 0 || lx == side - 1 || ly == side - 1) {
+			closed = false;
+			break;
+		}
+
+		const int next[4] = { cell - 1, cell + 1, cell - side, cell + side };
+		for (int n = 0; n < 4; n++) {
+			int c = next[n];
+			if (region[c] || GridCellOccupied(&world->grid, ox + c % side, oy + c / side)) continue;
+			if (tail == EDIT_MAX_CELLS) {
+				closed = false;
+				break;
+			}
+			region[c] = 1;
+			queue[tail++] = c;
+		}
+	}
+
+	int added = -1;
+	if (closed) {
+		// The player's cells are walked through but left empty.
+		added = 0;
+		for (int ly = 0; ly < side; ly++) {
+			int run = -1;
+			for (int lx = 0; lx <= side; lx++) {
+				bool fill = lx < side && region[ly * side + lx] && !CheckCollisionRecs(CellRect(ox + lx, oy + ly, 1), avoid);
+				if (fill && run == -1) run = lx;
+				if (!fill && run != -1) {
+					added += FillRun(world, ox + run, ox + lx - 1, oy + ly, color, shape);
+					run = -1;
+				}
+			}
+		}
+	}
+
+	free(queue);
+	free(region);
+	return added;
+}
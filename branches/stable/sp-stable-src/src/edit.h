@@ -0,0 +1,31 @@
+#ifndef EDIT_H
+#define EDIT_H
+
+#include "game.h"
+#include "world.h"
+
+// Bulk editing on the BLOCK_SIZE grid. The tools work cell by cell against
+// the grid's occupancy bits, so their cost follows the size of the area
+// edited, not the size of the world. Block 0, the base platform, is never
+// removed. Blocks are only placed on free cells and never over avoid,
+// which is meant for the player.
+
+#define EDIT_MAX_CELLS 65536
+// How far a flood fill may spread from where it started, in cells, before
+// the area is taken as open and nothing is filled.
+#define EDIT_FLOOD_RADIUS 128
+
+typedef enum { EDIT_BLOCK, EDIT_RECT, EDIT_FLOOD } EditTool;
+
+// Fills the free cells of the cell-aligned box around area. SHAPE_RECT
+// blocks need two free cells side by side. Returns how many blocks were
+// added, or -1 if the box has more than EDIT_MAX_CELLS cells.
+int EditFillRect(World* world, Rectangle area, Color color, BlockShape shape, Rectangle avoid);
+// Removes every block overlapping area and returns how many went.
+int EditEraseRect(World* world, Rectangle area);
+// Fills the free cells connected to the one under start. Returns how many
+// blocks were added, or -1 if the region is not closed in within
+// EDIT_FLOOD_RADIUS or start is not on a free cell.
+int EditFloodFill(World* world, Vector2 start, Color color, BlockShape shape, Rectangle avoid);
+
+#endif
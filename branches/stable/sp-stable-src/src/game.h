@@ -0,0 +1,38 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "raylib.h"
+
+#define MAX_PARTICLES 500
+#define PLAYER_SPEED 300.0f
+#define PLAYER_RUN_SPEED 500.0f
+#define JUMP_FORCE 550.0f
+#define GRAVITY 1000.0f
+#define MAX_FALL_SPEED 800.0f
+#define BLOCK_SIZE 40
+#define FREE_CAM_SPEED 600.0f
+
+typedef enum {
+	SHAPE_SQUARE, SHAPE_RECT, SHAPE_TRIANGLE, SHAPE_CIRCLE, SHAPE_RHOMBUS,
+	SHAPE_CUST1, SHAPE_CUST2, SHAPE_CUST3, SHAPE_CUST4, SHAPE_CUST5, SHAPE_CUST6,
+	SHAPE_CUST7, SHAPE_CUST8, SHAPE_CUST9, SHAPE_CUST10, SHAPE_CUST11, SHAPE_CUST12
+} BlockShape;
+
+typedef enum { WEATHER_NONE, WEATHER_RAIN, WEATHER_SNOW } WeatherType;
+typedef enum { CAM_FIXED, CAM_SMOOTH, CAM_FREE } GameCameraMode;
+
+typedef struct {
+	Rectangle rect;
+	int active;
+	Color color;
+	BlockShape shape;
+} Block;
+
+typedef struct {
+	Vector2 position;
+	Vector2 velocity;
+	bool grounded;
+	bool facingRight;
+} Player;
+
+#endif
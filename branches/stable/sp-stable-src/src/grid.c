@@ -0,0 +1,424 @@
+#include "grid.h"
+#include "game.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+
+// Shared by every grid so a chunk of a freshly loaded world can never carry
+// the same revision as the chunk it replaces.
+static atomic_uint revisionClock = 0;
+
+static int CellFloor(float v) {
+	return (int)floorf(v / BLOCK_SIZE);
+}
+
+static int CellLast(float v) {
+	return (int)ceilf(v / BLOCK_SIZE) - 1;
+}
+
+static int ChunkOf(int cell) {
+	return (cell >= 0) ? cell / GRID_CHUNK_CELLS : -((-cell - 1) / GRID_CHUNK_CELLS) - 1;
+}
+
+static unsigned int NextRevision(void) {
+	return atomic_fetch_add(&revisionClock, 1) + 1;
+}
+
+static unsigned int ChunkHash(int cx, int cy) {
+	unsigned int h = (unsigned int)cx * 0x9E3779B1u ^ (unsigned int)cy * 0x85EBCA77u;
+	return h ^ (h >> 16);
+}
+
+static GridChunk* FindChunk(const SpatialGrid* grid, int cx, int cy) {
+	if (grid->chunkCapacity == 0) return NULL;
+
+	unsigned int mask = (unsigned int)grid->chunkCapacity - 1;
+	unsigned int slot = ChunkHash(cx, cy) & mask;
+	while (grid->chunks[slot] != NULL) {
+		GridChunk* chunk = grid->chunks[slot];
+		if (chunk->cx == cx && chunk->cy == cy) return chunk;
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+
+static void PutChunk(GridChunk** table, int capacity, GridChunk* chunk) {
+	unsigned int mask = (unsigned int)capacity - 1;
+	unsigned int slot = ChunkHash(chunk->cx, chunk->cy) & mask;
+	while (table[slot] != NULL) slot = (slot + 1) & mask;
+	table[slot] = chunk;
+}
+
+static void ResizeChunks(SpatialGrid* grid, int newCapacity) {
+	GridChunk** table = calloc((size_t)newCapacity, sizeof(GridChunk*));
+	for (int i = 0; i < grid->chunkCapacity; i++) {
+		if (grid->chunks[i] != NULL) PutChunk(table, newCapacity, grid->chunks[i]);
+	}
+	free(grid->chunks);
+	grid->chunks = table;
+	grid->chunkCapacity = newCapacity;
+}
+
+static GridChunk* GetChunk(SpatialGrid* grid, int cx, int cy) {
+	GridChunk* chunk = FindChunk(grid, cx, cy);
+	if (chunk != NULL) return chunk;
+
+	if ((grid->chunkCount + 1) * 2 > grid->chunkCapacity) {
+		ResizeChunks(grid, (grid->chunkCapacity > 0) ? grid->chunkCapacity * 2 : 64);
+	}
+
+	chunk = malloc(sizeof(GridChunk));
+	chunk->cx = cx;
+	chunk->cy = cy;
+	chunk->anchorCount = 0;
+	chunk->revision = NextRevision();
+	memset(chunk->occupied, 0, sizeof(chunk->occupied));
+	for (int i = 0; i < GRID_CHUNK_AREA; i++) chunk->cellHead[i] = -1;
+
+	PutChunk(grid->chunks, grid->chunkCapacity, chunk);
+	grid->chunkCount++;
+	return chunk;
+}
+
+static int CellIndex(const GridChunk* chunk, int x, int y) {
+	return (y - chunk->cy * GRID_CHUNK_CELLS) * GRID_CHUNK_CELLS + (x - chunk->cx * GRID_CHUNK_CELLS);
+}
+
+static int* CellHead(GridChunk* chunk, int x, int y) {
+	return &chunk->cellHead[CellIndex(chunk, x, y)];
+}
+
+static bool CellBit(const GridChunk* chunk, int x, int y) {
+	int i = CellIndex(chunk, x, y);
+	return (chunk->occupied[i >> 6] >> (i & 63)) & 1;
+}
+
+static int AllocEntry(SpatialGrid* grid) {
+	if (grid->entryFree == -1) {
+		int oldCapacity = grid->entryCapacity;
+		int newCapacity = (oldCapacity > 0) ? oldCapacity * 2 : 256;
+		grid->entries = realloc(grid->entries, (size_t)newCapacity * sizeof(GridEntry));
+		for (int i = oldCapacity; i < newCapacity; i++) {
+			grid->entries[i].next = (i + 1 < newCapacity) ? i + 1 : -1;
+		}
+		grid->entryFree = oldCapacity;
+		grid->entryCapacity = newCapacity;
+	}
+
+	int e = grid->entryFree;
+	grid->entryFree = grid->entries[e].next;
+	grid->entryCount++;
+	return e;
+}
+
+static bool ChunkEmpty(const GridChunk* chunk) {
+	if (chunk->anchorCount > 0) return false;
+	for (int i = 0; i < GRID_CHUNK_AREA / 64; i++) {
+		if (chunk->occupied[i] != 0) return false;
+	}
+	return true;
+}
+
+// Frees a chunk nothing touches any more. The entries after it in its probe
+// run are shifted back over the hole so lookups never stop short.
+static void DropChunk(SpatialGrid* grid, GridChunk* chunk) {
+	unsigned int mask = (unsigned int)grid->chunkCapacity - 1;
+	unsigned int hole = ChunkHash(chunk->cx, chunk->cy) & mask;
+	while (grid->chunks[hole] != chunk) hole = (hole + 1) & mask;
+	free(chunk);
+
+	for (unsigned int next = (hole + 1) & mask; grid->chunks[next] != NULL; next = (next + 1) & mask) {
+		unsigned int home = ChunkHash(grid->chunks[next]->cx, grid->chunks[next]->cy) & mask;
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			grid->chunks[hole] = grid->chunks[next];
+			hole = next;
+		}
+	}
+	grid->chunks[hole] = NULL;
+	grid->chunkCount--;
+
+	if (grid->chunkCapacity > 64 && grid->chunkCount * 8 < grid->chunkCapacity) ResizeChunks(grid, grid->chunkCapacity / 2);
+}
+
+// Moves the entries in use to the front of a smaller array once most of it
+// has been freed, so the entries follow the blocks down as well as up.
+static void ShrinkEntries(SpatialGrid* grid) {
+	int capacity = grid->entryCapacity;
+	while (capacity > 256 && grid->entryCount * 4 < capacity) capacity /= 2;
+	if (capacity == grid->entryCapacity) return;
+
+	GridEntry* entries = malloc((size_t)capacity * sizeof(GridEntry));
+	int used = 0;
+	for (int i = 0; i < grid->chunkCapacity; i++) {
+		GridChunk* chunk = grid->chunks[i];
+		if (chunk == NULL) continue;
+		for (int cell = 0; cell < GRID_CHUNK_AREA; cell++) {
+			for (int* link = &chunk->cellHead[cell]; *link != -1; link = &entries[*link].next) {
+				entries[used] = grid->entries[*link];
+				*link = used++;
+			}
+		}
+	}
+	for (int i = used; i < capacity; i++) entries[i].next = (i + 1 < capacity) ? i + 1 : -1;
+
+	free(grid->entries);
+	grid->entries = entries;
+	grid->entryCapacity = capacity;
+	grid->entryFree = (used < capacity) ? used : -1;
+}
+
+static int CompareIds(const void* a, const void* b) {
+	int x = *(const int*)a;
+	int y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
+static void SortIds(int* ids, int count) {
+	if (count > 16) {
+		qsort(ids, (size_t)count, sizeof(int), CompareIds);
+		return;
+	}
+
+	for (int i = 1; i < count; i++) {
+		int v = ids[i];
+		int j = i - 1;
+		while (j >= 0 && ids[j] > v) {
+			ids[j + 1] = ids[j];
+			j--;
+		}
+		ids[j + 1] = v;
+	}
+}
+
+void GridInit(SpatialGrid* grid) {
+	grid->chunks = NULL;
+	grid->chunkCapacity = 0;
+	grid->chunkCount = 0;
+	grid->entries = NULL;
+	grid->entryCapacity = 0;
+	grid->entryCount = 0;
+	grid->entryFree = -1;
+}
+
+void GridFree(SpatialGrid* grid) {
+	for (int i = 0; i < grid->chunkCapacity; i++) free(grid->chunks[i]);
+	free(grid->chunks);
+	free(grid->entries);
+	GridInit(grid);
+}
+
+void GridCopy(SpatialGrid* dst, const SpatialGrid* src) {
+	*dst = *src;
+	dst->chunks = NULL;
+	dst->entries = NULL;
+
+	if (src->chunkCapacity > 0) {
+		dst->chunks = calloc((size_t)src->chunkCapacity, sizeof(GridChunk*));
+		for (int i = 0; i < src->chunkCapacity; i++) {
+			if (src->chunks[i] == NULL) continue;
+			dst->chunks[i] = malloc(sizeof(GridChunk));
+			memcpy(dst->chunks[i], src->chunks[i], sizeof(GridChunk));
+		}
+	}
+	if (src->entryCapacity > 0) {
+		dst->entries = malloc((size_t)src->entryCapacity * sizeof(GridEntry));
+		memcpy(dst->entries, src->entries, (size_t)src->entryCapacity * sizeof(GridEntry));
+	}
+}
+
+void GridClear(SpatialGrid* grid) {
+	for (int i = 0; i < grid->chunkCapacity; i++) {
+		free(grid->chunks[i]);
+		grid->chunks[i] = NULL;
+	}
+	grid->chunkCount = 0;
+
+	for (int i = 0; i < grid->entryCapacity; i++) {
+		grid->entries[i].next = (i + 1 < grid->entryCapacity) ? i + 1 : -1;
+	}
+	grid->entryFree = (grid->entryCapacity > 0) ? 0 : -1;
+	grid->entryCount = 0;
+}
+
+GridChunk* GridInsert(SpatialGrid* grid, int id, Rectangle rect) {
+	int x0 = CellFloor(rect.x), x1 = CellLast(rect.x + rect.width);
+	int y0 = CellFloor(rect.y), y1 = CellLast(rect.y + rect.height);
+	if (x1 < x0 || y1 < y0) return NULL;
+
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			GridChunk* chunk = GetChunk(grid, ChunkOf(x), ChunkOf(y));
+			int cell = CellIndex(chunk, x, y);
+			int e = AllocEntry(grid);
+			grid->entries[e].id = id;
+			grid->entries[e].rect = rect;
+			grid->entries[e].next = chunk->cellHead[cell];
+			chunk->cellHead[cell] = e;
+			chunk->occupied[cell >> 6] |= 1ull << (cell & 63);
+		}
+	}
+
+	GridChunk* anchor = FindChunk(grid, ChunkOf(x0), ChunkOf(y0));
+	if (anchor != NULL) {
+		anchor->anchorCount++;
+		anchor->revision = NextRevision();
+	}
+	return anchor;
+}
+
+bool GridRemove(SpatialGrid* grid, int id, Rectangle rect, int* anchorX, int* anchorY) {
+	int x0 = CellFloor(rect.x), x1 = CellLast(rect.x + rect.width);
+	int y0 = CellFloor(rect.y), y1 = CellLast(rect.y + rect.height);
+
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			GridChunk* chunk = FindChunk(grid, ChunkOf(x), ChunkOf(y));
+			if (chunk == NULL) continue;
+
+			int* link = CellHead(chunk, x, y);
+			while (*link != -1) {
+				int e = *link;
+				if (grid->entries[e].id == id) {
+					*link = grid->entries[e].next;
+					grid->entries[e].next = grid->entryFree;
+					grid->entryFree = e;
+					grid->entryCount--;
+					break;
+				}
+				link = &grid->entries[e].next;
+			}
+
+			int cell = CellIndex(chunk, x, y);
+			if (chunk->cellHead[cell] == -1) chunk->occupied[cell >> 6] &= ~(1ull << (cell & 63));
+		}
+	}
+
+	bool anchored = false;
+	GridChunk* anchor = FindChunk(grid, ChunkOf(x0), ChunkOf(y0));
+	if (anchor != NULL && x1 >= x0 && y1 >= y0) {
+		anchor->anchorCount--;
+		anchor->revision = NextRevision();
+		*anchorX = anchor->cx;
+		*anchorY = anchor->cy;
+		anchored = true;
+	}
+
+	if (x1 >= x0 && y1 >= y0) {
+		for (int cy = ChunkOf(y0); cy <= ChunkOf(y1); cy++) {
+			for (int cx = ChunkOf(x0); cx <= ChunkOf(x1); cx++) {
+				GridChunk* chunk = FindChunk(grid, cx, cy);
+				if (chunk != NULL && ChunkEmpty(chunk)) DropChunk(grid, chunk);
+			}
+		}
+	}
+	ShrinkEntries(grid);
+	return anchored;
+}
+
+size_t GridBytes(const SpatialGrid* grid) {
+	return (size_t)grid->chunkCount * sizeof(GridChunk) +
+		(size_t)grid->chunkCapacity * sizeof(GridChunk*) +
+		(size_t)grid->entryCapacity * sizeof(GridEntry);
+}
+
+int GridQuery(const SpatialGrid* grid, Rectangle area, int* out, int maxOut) {
+	int x0 = CellFloor(area.x), x1 = CellLast(area.x + area.width);
+	int y0 = CellFloor(area.y), y1 = CellLast(area.y + area.height);
+	int count = 0;
+
+	for (int y = y0; y <= y1; y++) {
+		GridChunk* chunk = NULL;
+		for (int x = x0; x <= x1; x++) {
+			if (chunk == NULL || ChunkOf(x) != chunk->cx || ChunkOf(y) != chunk->cy) {
+				chunk = FindChunk(grid, ChunkOf(x), ChunkOf(y));
+				if (chunk == NULL) {
+					x = (ChunkOf(x) + 1) * GRID_CHUNK_CELLS - 1;
+					continue;
+				}
+			}
+
+			for (int e = *CellHead(chunk, x, y); e != -1; e = grid->entries[e].next) {
+				const GridEntry* entry = &grid->entries[e];
+
+				// A block spanning several cells is reported only from the first
+				// cell it shares with the query.
+				int bx0 = CellFloor(entry->rect.x);
+				int by0 = CellFloor(entry->rect.y);
+				if (x != ((bx0 > x0) ? bx0 : x0) || y != ((by0 > y0) ? by0 : y0)) continue;
+				if (!CheckCollisionRecs(area, entry->rect)) continue;
+
+				if (count == maxOut) {
+					SortIds(out, count);
+					return count;
+				}
+				out[count++] = entry->id;
+			}
+		}
+	}
+
+	SortIds(out, count);
+	return count;
+}
+
+int GridQueryPoint(const SpatialGrid* grid, Vector2 point, int* out, int maxOut) {
+	int x = CellFloor(point.x);
+	int y = CellFloor(point.y);
+	GridChunk* chunk = FindChunk(grid, ChunkOf(x), ChunkOf(y));
+	if (chunk == NULL || !CellBit(chunk, x, y)) return 0;
+
+	int count = 0;
+	for (int e = *CellHead(chunk, x, y); e != -1 && count < maxOut; e = grid->entries[e].next) {
+		if (CheckCollisionPointRec(point, grid->entries[e].rect)) out[count++] = grid->entries[e].id;
+	}
+
+	SortIds(out, count);
+	return count;
+}
+
+GridChunk* GridFindChunk(const SpatialGrid* grid, int cx, int cy) {
+	return FindChunk(grid, cx, cy);
+}
+
+bool GridIsAnchor(const GridEntry* entry, int x, int y) {
+	return CellFloor(entry->rect.x) == x && CellFloor(entry->rect.y) == y;
+}
+
+bool GridOverlaps(const SpatialGrid* grid, Rectangle area) {
+	int x0 = CellFloor(area.x), x1 = CellLast(area.x + area.width);
+	int y0 = CellFloor(area.y), y1 = CellLast(area.y + area.height);
+
+	// A block touching a cell overlaps any area that covers the cell whole,
+	// which is the usual case when placing on the grid.
+	bool aligned = area.x == x0 * BLOCK_SIZE && area.y == y0 * BLOCK_SIZE &&
+		area.x + area.width == (x1 + 1) * BLOCK_SIZE && area.y + area.height == (y1 + 1) * BLOCK_SIZE;
+
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			GridChunk* chunk = FindChunk(grid, ChunkOf(x), ChunkOf(y));
+			if (chunk == NULL || !CellBit(chunk, x, y)) continue;
+			if (aligned) return true;
+
+			for (int e = *CellHead(chunk, x, y); e != -1; e = grid->entries[e].next) {
+				if (CheckCollisionRecs(area, grid->entries[e].rect)) return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool GridCellOccupied(const SpatialGrid* grid, int x, int y) {
+	GridChunk* chunk = FindChunk(grid, ChunkOf(x), ChunkOf(y));
+	return chunk != NULL && CellBit(chunk, x, y);
+}
+
+int GridCellBlock(const SpatialGrid* grid, int x, int y) {
+	GridChunk* chunk = FindChunk(grid, ChunkOf(x), ChunkOf(y));
+	if (chunk == NULL || !CellBit(chunk, x, y)) return -1;
+
+	int lowest = -1;
+	for (int e = *CellHead(chunk, x, y); e != -1; e = grid->entries[e].next) {
+		if (lowest == -1 || grid->entries[e].id < lowest) lowest = grid->entries[e].id;
+	}
+	return lowest;
+}
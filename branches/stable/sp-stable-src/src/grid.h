@@ -0,0 +1,77 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include "raylib.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define GRID_CHUNK_CELLS 16
+#define GRID_CHUNK_AREA (GRID_CHUNK_CELLS * GRID_CHUNK_CELLS)
+
+// Spatial hash over BLOCK_SIZE cells. Cells are grouped in chunks that are
+// allocated the first time something touches them; a block is linked into
+// every cell its rectangle covers. A block is anchored in the chunk holding
+// its top-left cell, and every insert or remove stamps that chunk with a new
+// revision so caches built per chunk can tell when they are stale. Revisions
+// are unique across all grids. Each chunk also keeps a bit per cell that is
+// set while any block touches the cell, so asking whether a cell is free
+// costs a hash lookup and a bit test. A chunk is freed again as soon as no
+// block touches it, and the entry array shrinks once most of it is unused,
+// so a grid's memory follows what it holds now rather than its peak.
+
+typedef struct {
+	int id;
+	int next;
+	Rectangle rect;
+} GridEntry;
+
+typedef struct {
+	int cx;
+	int cy;
+	int anchorCount;
+	unsigned int revision;
+	unsigned long long occupied[GRID_CHUNK_AREA / 64];
+	int cellHead[GRID_CHUNK_AREA];
+} GridChunk;
+
+typedef struct {
+	GridChunk** chunks;
+	int chunkCapacity;
+	int chunkCount;
+
+	GridEntry* entries;
+	int entryCapacity;
+	int entryCount;
+	int entryFree;
+} SpatialGrid;
+
+void GridInit(SpatialGrid* grid);
+void GridFree(SpatialGrid* grid);
+void GridClear(SpatialGrid* grid);
+// dst must not be initialised; it receives its own copy of every chunk.
+void GridCopy(SpatialGrid* dst, const SpatialGrid* src);
+
+// Returns the chunk the block is anchored in, or NULL for an empty rect.
+GridChunk* GridInsert(SpatialGrid* grid, int id, Rectangle rect);
+// Gives the chunk coordinates the block was anchored in; that chunk may
+// have been freed by the time this returns. Returns false for an empty rect.
+bool GridRemove(SpatialGrid* grid, int id, Rectangle rect, int* anchorX, int* anchorY);
+
+// Ids of the blocks overlapping area, in ascending order. Returns how many
+// were written to out (at most maxOut).
+int GridQuery(const SpatialGrid* grid, Rectangle area, int* out, int maxOut);
+int GridQueryPoint(const SpatialGrid* grid, Vector2 point, int* out, int maxOut);
+bool GridOverlaps(const SpatialGrid* grid, Rectangle area);
+
+// Cells are addressed in BLOCK_SIZE units, so cell (x, y) covers world
+// x * BLOCK_SIZE .. (x + 1) * BLOCK_SIZE.
+bool GridCellOccupied(const SpatialGrid* grid, int x, int y);
+// Lowest id of the blocks touching cell (x, y), or -1 if it is free.
+int GridCellBlock(const SpatialGrid* grid, int x, int y);
+
+GridChunk* GridFindChunk(const SpatialGrid* grid, int cx, int cy);
+// Heap memory the grid holds.
+size_t GridBytes(const SpatialGrid* grid);
+bool GridIsAnchor(const GridEntry* entry, int x, int y);
+
+#endif
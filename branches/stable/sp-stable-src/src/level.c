@@ -0,0 +1,634 @@
+#include "level.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define LEVEL_IO_BUFFER 65536
+#define LEVEL_MAX_PALETTE (1 << 20)
+#define LEVEL_CELL_LIMIT (1 << 24)
+#define LEVEL_MAX_BLOCK_CELLS (LEVEL_MAX_BLOCK_SIZE / BLOCK_SIZE)
+#define LEVEL_CHUNK_LIMIT (LEVEL_CELL_LIMIT / GRID_CHUNK_CELLS)
+
+typedef LevelPaletteEntry PaletteEntry;
+
+typedef struct {
+	PaletteEntry* entries;
+	int count;
+	int capacity;
+	int lastHit;
+} Palette;
+
+typedef struct {
+	unsigned char* data;
+	int length;
+	int capacity;
+} ByteBuffer;
+
+typedef struct {
+	int cx;
+	int cy;
+	int blocks;
+	unsigned long long offset;
+	int bytes;
+} ChunkRecord;
+
+typedef struct {
+	FILE* file;
+	unsigned char buffer[LEVEL_IO_BUFFER];
+	int length;
+	unsigned long long offset;
+	bool failed;
+} LevelWriter;
+
+// Reads either from a FILE*, refilling storage, or straight from memory when
+// file is NULL.
+typedef struct {
+	FILE* file;
+	unsigned char* storage;
+	const unsigned char* data;
+	size_t length;
+	size_t position;
+	unsigned long long consumed;
+	bool failed;
+} LevelReader;
+
+// Writing -------------------------------------------------------------------
+
+static void FlushWriter(LevelWriter* w) {
+	if (w->length > 0 && fwrite(w->buffer, 1, (size_t)w->length, w->file) != (size_t)w->length) w->failed = true;
+	w->length = 0;
+}
+
+static void WriteBytes(LevelWriter* w, const void* data, int size) {
+	const unsigned char* bytes = data;
+	w->offset += (unsigned long long)size;
+	while (size > 0) {
+		if (w->length == LEVEL_IO_BUFFER) FlushWriter(w);
+		int chunk = LEVEL_IO_BUFFER - w->length;
+		if (chunk > size) chunk = size;
+		memcpy(w->buffer + w->length, bytes, (size_t)chunk);
+		w->length += chunk;
+		bytes += chunk;
+		size -= chunk;
+	}
+}
+
+static int EncodeVarint(unsigned char* out, unsigned long long v) {
+	int n = 0;
+	while (v >= 0x80) {
+		out[n++] = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	out[n++] = (unsigned char)v;
+	return n;
+}
+
+static unsigned int Zigzag(int v) {
+	return ((unsigned int)v << 1) ^ (unsigned int)(v >> 31);
+}
+
+static int Unzigzag(unsigned int v) {
+	return (int)(v >> 1) ^ -(int)(v & 1);
+}
+
+static void WriteU8(LevelWriter* w, unsigned char v) {
+	WriteBytes(w, &v, 1);
+}
+
+static void WriteUInt(LevelWriter* w, unsigned long long v, int size) {
+	unsigned char bytes[8];
+	for (int i = 0; i < size; i++) bytes[i] = (unsigned char)(v >> (8 * i));
+	WriteBytes(w, bytes, size);
+}
+
+static void WriteF32(LevelWriter* w, float v) {
+	unsigned int bits;
+	memcpy(&bits, &v, sizeof(bits));
+	WriteUInt(w, bits, 4);
+}
+
+static void WriteVarint(LevelWriter* w, unsigned long long v) {
+	unsigned char bytes[10];
+	WriteBytes(w, bytes, EncodeVarint(bytes, v));
+}
+
+static void BufferVarint(ByteBuffer* b, unsigned long long v) {
+	if (b->length + 10 > b->capacity) {
+		b->capacity = (b->capacity > 0) ? b->capacity * 2 : 1024;
+		b->data = realloc(b->data, (size_t)b->capacity);
+	}
+	b->length += EncodeVarint(b->data + b->length, v);
+}
+
+// Palette -------------------------------------------------------------------
+
+static bool SameEntry(const PaletteEntry* a, const PaletteEntry* b) {
+	return a->color.r == b->color.r && a->color.g == b->color.g && a->color.b == b->color.b && a->color.a == b->color.a &&
+		a->shape == b->shape && a->w == b->w && a->h == b->h;
+}
+
+// Levels only ever use a handful of colour/shape pairs, so a linear search
+// that tries the last hit first is all this needs.
+static int PaletteIndex(Palette* palette, PaletteEntry entry) {
+	if (palette->count > 0 && SameEntry(&palette->entries[palette->lastHit], &entry)) return palette->lastHit;
+
+	for (int i = 0; i < palette->count; i++) {
+		if (SameEntry(&palette->entries[i], &entry)) {
+			palette->lastHit = i;
+			return i;
+		}
+	}
+
+	if (palette->count == palette->capacity) {
+		palette->capacity = (palette->capacity > 0) ? palette->capacity * 2 : 16;
+		palette->entries = realloc(palette->entries, (size_t)palette->capacity * sizeof(PaletteEntry));
+	}
+	palette->entries[palette->count] = entry;
+	palette->lastHit = palette->count;
+	return palette->count++;
+}
+
+static bool OnGrid(float v, int* cells) {
+	if (!(fabsf(v) < (float)LEVEL_CELL_LIMIT * BLOCK_SIZE)) return false;
+	int i = (int)v;
+	if ((float)i != v || i % BLOCK_SIZE != 0) return false;
+	*cells = i / BLOCK_SIZE;
+	return true;
+}
+
+bool LevelInfoValid(const LevelInfo* info) {
+	// The ranges of the name and colour tables in main.c.
+	return info->weather >= WEATHER_NONE && info->weather <= WEATHER_SNOW &&
+		info->playerColor >= 0 && info->playerColor <= 5 &&
+		info->blockColor >= 0 && info->blockColor <= 4 &&
+		info->blockShape >= SHAPE_SQUARE && info->blockShape <= SHAPE_CUST12;
+}
+
+bool LevelRectValid(Rectangle rect) {
+	const float limit = (float)LEVEL_CELL_LIMIT * BLOCK_SIZE;
+	if (!(fabsf(rect.x) < limit) || !(fabsf(rect.y) < limit)) return false;
+	return rect.width > 0.0f && rect.width <= LEVEL_MAX_BLOCK_SIZE && rect.height > 0.0f && rect.height <= LEVEL_MAX_BLOCK_SIZE;
+}
+
+// Cell position and size of a block that lies exactly on the grid.
+static bool CellsOf(Rectangle r, int* x, int* y, int* w, int* h) {
+	if (!OnGrid(r.x, x) || !OnGrid(r.y, y) || !OnGrid(r.width, w) || !OnGrid(r.height, h)) return false;
+	return *w >= 1 && *h >= 1 && *w <= GRID_CHUNK_CELLS && *h <= LEVEL_MAX_BLOCK_CELLS;
+}
+
+// Loose blocks get a palette entry with no cell size.
+static PaletteEntry EntryOf(const Block* b, int id) {
+	PaletteEntry entry = { b->color, b->shape, 0, 0 };
+	int x, y;
+	if (id != 0 && !CellsOf(b->rect, &x, &y, &entry.w, &entry.h)) {
+		entry.w = 0;
+		entry.h = 0;
+	}
+	return entry;
+}
+
+// Runs of blocks that touch along a row of one chunk and share a palette
+// entry, written as (skip, length - 1, palette). Cells are visited in order,
+// so runs come out sorted and skips are never negative.
+static int EncodeChunk(const World* world, const GridChunk* chunk, const Palette* palette, const int* paletteOf, ByteBuffer* out) {
+	const SpatialGrid* grid = &world->grid;
+	int blocks = 0;
+	int cursor = 0;
+	int runStart = -1, runLength = 0, runPalette = 0, runWidth = 1;
+
+	out->length = 0;
+	for (int i = 0; i < GRID_CHUNK_AREA; i++) {
+		int x = chunk->cx * GRID_CHUNK_CELLS + i % GRID_CHUNK_CELLS;
+		int y = chunk->cy * GRID_CHUNK_CELLS + i / GRID_CHUNK_CELLS;
+
+		for (int e = chunk->cellHead[i]; e != -1; e = grid->entries[e].next) {
+			const GridEntry* entry = &grid->entries[e];
+			if (!GridIsAnchor(entry, x, y)) continue;
+			int p = paletteOf[entry->id];
+			if (p < 0) continue;
+
+			int width = palette->entries[p].w;
+			blocks++;
+
+			bool extends = runStart >= 0 && p == runPalette && i == runStart + runLength * runWidth &&
+				i / GRID_CHUNK_CELLS == runStart / GRID_CHUNK_CELLS;
+			if (extends) {
+				runLength++;
+				continue;
+			}
+
+			if (runStart >= 0) {
+				BufferVarint(out, (unsigned long long)(runStart - cursor));
+				BufferVarint(out, (unsigned long long)(runLength - 1));
+				BufferVarint(out, (unsigned long long)runPalette);
+				cursor = runStart + (runLength - 1) * runWidth;
+			}
+			runStart = i;
+			runLength = 1;
+			runPalette = p;
+			runWidth = width;
+		}
+	}
+
+	if (runStart >= 0) {
+		BufferVarint(out, (unsigned long long)(runStart - cursor));
+		BufferVarint(out, (unsigned long long)(runLength - 1));
+		BufferVarint(out, (unsigned long long)runPalette);
+	}
+	return blocks;
+}
+
+bool LevelIsCurrentFormat(FILE* file) {
+	char magic[4] = { 0 };
+	long start = ftell(file);
+	size_t got = fread(magic, 1, 4, file);
+	fseek(file, start, SEEK_SET);
+	return got == 4 && memcmp(magic, LEVEL_MAGIC, 4) == 0;
+}
+
+static void WriteChunkHeader(LevelWriter* w, int cx, int cy, int blocks, int bytes, ChunkRecord** table, int* tableCount, int* tableCapacity) {
+	WriteU8(w, 1);
+	WriteVarint(w, Zigzag(cx));
+	WriteVarint(w, Zigzag(cy));
+	WriteVarint(w, (unsigned long long)blocks);
+	WriteVarint(w, (unsigned long long)bytes);
+
+	if (*tableCount == *tableCapacity) {
+		*tableCapacity = (*tableCapacity > 0) ? *tableCapacity * 2 : 64;
+		*table = realloc(*table, (size_t)*tableCapacity * sizeof(ChunkRecord));
+	}
+	(*table)[(*tableCount)++] = (ChunkRecord){ cx, cy, blocks, w->offset, bytes };
+}
+
+bool LevelWrite(FILE* file, const LevelInfo* info, const World* world, const LevelSource* source, atomic_int* progress) {
+	LevelWriter* w = calloc(1, sizeof(LevelWriter));
+	w->file = file;
+
+	// Palette index of every grid block by id, -1 for loose and inactive ones,
+	// so the chunk pass below never has to touch the blocks themselves. Raw
+	// chunks carried over from source index its palette, so that goes first.
+	Palette palette = { 0 };
+	long long totalBlocks = world->activeCount;
+	if (source != NULL) {
+		for (int i = 0; i < source->paletteCount; i++) {
+			if (palette.count == palette.capacity) {
+				palette.capacity = (palette.capacity > 0) ? palette.capacity * 2 : 16;
+				palette.entries = realloc(palette.entries, (size_t)palette.capacity * sizeof(PaletteEntry));
+			}
+			palette.entries[palette.count++] = source->palette[i];
+		}
+		for (int i = 0; i < source->chunkCount; i++) totalBlocks += source->chunks[i].blocks;
+	}
+	int* paletteOf = malloc((size_t)(world->highWater > 0 ? world->highWater : 1) * sizeof(int));
+	int* loose = NULL;
+	int looseCount = 0, looseCapacity = 0;
+
+	for (int id = 0; id < world->highWater; id++) {
+		const Block* b = WorldGet(world, id);
+		paletteOf[id] = -1;
+		if (!b->active) continue;
+
+		PaletteEntry pe = EntryOf(b, id);
+		int p = PaletteIndex(&palette, pe);
+		if (pe.w != 0) {
+			paletteOf[id] = p;
+		}
+		else {
+			if (looseCount == looseCapacity) {
+				looseCapacity = (looseCapacity > 0) ? looseCapacity * 2 : 16;
+				loose = realloc(loose, (size_t)looseCapacity * sizeof(int));
+			}
+			loose[looseCount++] = id;
+		}
+	}
+
+	WriteBytes(w, LEVEL_MAGIC, 4);
+	WriteUInt(w, LEVEL_VERSION, 2);
+	WriteUInt(w, 0, 2);
+
+	WriteF32(w, info->playerPos.x);
+	WriteF32(w, info->playerPos.y);
+	WriteU8(w, (unsigned char)info->isNight);
+	WriteU8(w, (unsigned char)info->weather);
+	WriteU8(w, (unsigned char)info->playerColor);
+	WriteU8(w, (unsigned char)info->blockColor);
+	WriteU8(w, (unsigned char)info->blockShape);
+
+	WriteVarint(w, (unsigned long long)palette.count);
+	for (int i = 0; i < palette.count; i++) {
+		const PaletteEntry* pe = &palette.entries[i];
+		WriteBytes(w, &pe->color, 4);
+		WriteU8(w, (unsigned char)pe->shape);
+		WriteVarint(w, (unsigned long long)pe->w);
+		WriteVarint(w, (unsigned long long)pe->h);
+	}
+
+	WriteVarint(w, (unsigned long long)looseCount);
+	for (int i = 0; i < looseCount; i++) {
+		const Block* b = WorldGet(world, loose[i]);
+		WriteVarint(w, (unsigned long long)PaletteIndex(&palette, EntryOf(b, loose[i])));
+		WriteF32(w, b->rect.x);
+		WriteF32(w, b->rect.y);
+		WriteF32(w, b->rect.width);
+		WriteF32(w, b->rect.height);
+	}
+
+	ChunkRecord* table = NULL;
+	int tableCount = 0, tableCapacity = 0;
+	ByteBuffer payload = { 0 };
+	long long written = looseCount;
+
+	for (int i = 0; i < world->grid.chunkCapacity; i++) {
+		const GridChunk* chunk = world->grid.chunks[i];
+		if (chunk == NULL || chunk->anchorCount == 0) continue;
+
+		int blocks = EncodeChunk(world, chunk, &palette, paletteOf, &payload);
+		if (blocks == 0) continue;
+
+		WriteChunkHeader(w, chunk->cx, chunk->cy, blocks, payload.length, &table, &tableCount, &tableCapacity);
+		WriteBytes(w, payload.data, payload.length);
+
+		written += blocks;
+		if (progress != NULL && totalBlocks > 0) atomic_store(progress, (int)(written * 999 / totalBlocks));
+	}
+
+	for (int i = 0; source != NULL && i < source->chunkCount; i++) {
+		const LevelChunkRef* ref = &source->chunks[i];
+		WriteChunkHeader(w, ref->cx, ref->cy, ref->blocks, ref->bytes, &table, &tableCount, &tableCapacity);
+		WriteBytes(w, ref->data, ref->bytes);
+
+		written += ref->blocks;
+		if (progress != NULL && totalBlocks > 0) atomic_store(progress, (int)(written * 999 / totalBlocks));
+	}
+	WriteU8(w, 0);
+
+	unsigned long long tableOffset = w->offset;
+	WriteVarint(w, (unsigned long long)tableCount);
+	for (int i = 0; i < tableCount; i++) {
+		WriteVarint(w, Zigzag(table[i].cx));
+		WriteVarint(w, Zigzag(table[i].cy));
+		WriteVarint(w, (unsigned long long)table[i].blocks);
+		WriteUInt(w, table[i].offset, 8);
+		WriteVarint(w, (unsigned long long)table[i].bytes);
+	}
+	WriteUInt(w, tableOffset, 8);
+	WriteBytes(w, LEVEL_FOOTER_MAGIC, 4);
+	FlushWriter(w);
+
+	bool ok = !w->failed;
+	if (progress != NULL) atomic_store(progress, 1000);
+	free(payload.data);
+	free(table);
+	free(loose);
+	free(paletteOf);
+	free(palette.entries);
+	free(w);
+	return ok;
+}
+
+// Reading -------------------------------------------------------------------
+
+static void InitMemoryReader(LevelReader* r, const unsigned char* data, size_t length) {
+	memset(r, 0, sizeof(LevelReader));
+	r->data = data;
+	r->length = length;
+}
+
+static unsigned char ReadU8(LevelReader* r) {
+	if (r->position == r->length) {
+		if (r->file == NULL) {
+			r->failed = true;
+			return 0;
+		}
+		r->length = fread(r->storage, 1, LEVEL_IO_BUFFER, r->file);
+		r->position = 0;
+		if (r->length == 0) {
+			r->failed = true;
+			return 0;
+		}
+	}
+	r->consumed++;
+	return r->data[r->position++];
+}
+
+static unsigned long long ReadUInt(LevelReader* r, int size) {
+	unsigned long long v = 0;
+	for (int i = 0; i < size; i++) v |= (unsigned long long)ReadU8(r) << (8 * i);
+	return v;
+}
+
+static float ReadF32(LevelReader* r) {
+	unsigned int bits = (unsigned int)ReadUInt(r, 4);
+	float v;
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+static unsigned long long ReadVarint(LevelReader* r) {
+	unsigned long long v = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		unsigned char byte = ReadU8(r);
+		v |= (unsigned long long)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) return v;
+	}
+	r->failed = true;
+	return 0;
+}
+
+// Header, info and palette. palette->entries is allocated even on failure.
+static bool ReadHeader(LevelReader* r, LevelInfo* info, Palette* palette) {
+	char magic[4];
+	for (int i = 0; i < 4; i++) magic[i] = (char)ReadU8(r);
+	unsigned int version = (unsigned int)ReadUInt(r, 2);
+	ReadUInt(r, 2);
+	if (r->failed || memcmp(magic, LEVEL_MAGIC, 4) != 0 || version == 0 || version > LEVEL_VERSION) return false;
+
+	info->playerPos.x = ReadF32(r);
+	info->playerPos.y = ReadF32(r);
+	info->isNight = ReadU8(r);
+	info->weather = (WeatherType)ReadU8(r);
+	info->playerColor = ReadU8(r);
+	info->blockColor = ReadU8(r);
+	info->blockShape = ReadU8(r);
+	if (r->failed || !LevelInfoValid(info)) return false;
+
+	unsigned long long paletteCount = ReadVarint(r);
+	if (r->failed || paletteCount > LEVEL_MAX_PALETTE) return false;
+	palette->count = palette->capacity = (int)paletteCount;
+	palette->entries = malloc((size_t)(paletteCount > 0 ? paletteCount : 1) * sizeof(PaletteEntry));
+	for (int i = 0; i < palette->count; i++) {
+		PaletteEntry* pe = &palette->entries[i];
+		pe->color.r = ReadU8(r);
+		pe->color.g = ReadU8(r);
+		pe->color.b = ReadU8(r);
+		pe->color.a = ReadU8(r);
+		pe->shape = (BlockShape)ReadU8(r);
+		pe->w = (int)ReadVarint(r);
+		pe->h = (int)ReadVarint(r);
+		if (pe->shape > SHAPE_CUST12) return false;
+		// Loose blocks share entries with no cell size; any other entry is
+		// one that CellsOf could have produced.
+		bool loose = pe->w == 0 && pe->h == 0;
+		if (!loose && (pe->w < 1 || pe->w > GRID_CHUNK_CELLS || pe->h < 1 || pe->h > LEVEL_MAX_BLOCK_CELLS)) return false;
+	}
+	return !r->failed;
+}
+
+static bool ReadLoose(LevelReader* r, const Palette* palette, World* world) {
+	unsigned long long looseCount = ReadVarint(r);
+	for (unsigned long long i = 0; i < looseCount && !r->failed; i++) {
+		unsigned long long p = ReadVarint(r);
+		Rectangle rect;
+		rect.x = ReadF32(r);
+		rect.y = ReadF32(r);
+		rect.width = ReadF32(r);
+		rect.height = ReadF32(r);
+		if (r->failed || p >= (unsigned long long)palette->count || !LevelRectValid(rect)) return false;
+		WorldAdd(world, rect, palette->entries[p].color, palette->entries[p].shape);
+	}
+	return !r->failed;
+}
+
+// Decodes the runs of one chunk payload. ids, when not NULL, receives the id
+// of every block added.
+static bool DecodeRuns(LevelReader* r, int cx, int cy, unsigned long long blocks, const Palette* palette, World* world, int* ids) {
+	unsigned long long decoded = 0;
+	int cursor = 0;
+
+	while (decoded < blocks) {
+		unsigned long long skip = ReadVarint(r);
+		unsigned long long length = ReadVarint(r) + 1;
+		unsigned long long p = ReadVarint(r);
+		if (r->failed || p >= (unsigned long long)palette->count || length > blocks - decoded) return false;
+		if (skip >= GRID_CHUNK_AREA || cursor + (int)skip >= GRID_CHUNK_AREA) return false;
+
+		const PaletteEntry* pe = &palette->entries[p];
+		if (pe->w == 0) return false;
+
+		int anchor = cursor + (int)skip;
+		int row = anchor / GRID_CHUNK_CELLS;
+		int last = anchor + (int)(length - 1) * pe->w;
+		if (last / GRID_CHUNK_CELLS != row) return false;
+
+		for (int k = 0; k < (int)length; k++) {
+			int cell = anchor + k * pe->w;
+			float x = (float)(cx * GRID_CHUNK_CELLS + cell % GRID_CHUNK_CELLS) * BLOCK_SIZE;
+			float y = (float)(cy * GRID_CHUNK_CELLS + row) * BLOCK_SIZE;
+			int id = WorldAdd(world, (Rectangle){ x, y, (float)(pe->w * BLOCK_SIZE), (float)(pe->h * BLOCK_SIZE) }, pe->color, pe->shape);
+			if (ids != NULL) ids[decoded + k] = id;
+		}
+
+		decoded += length;
+		cursor = last;
+	}
+	return true;
+}
+
+// Chunk coordinates and a block count, as both the chunk headers and the
+// table hold them. A chunk has a cell for each of its blocks, and any
+// coordinate past LEVEL_CHUNK_LIMIT would overflow the cell maths.
+static bool ReadChunkPlace(LevelReader* r, int* cx, int* cy, int* blocks) {
+	unsigned long long x = ReadVarint(r);
+	unsigned long long y = ReadVarint(r);
+	unsigned long long count = ReadVarint(r);
+	if (r->failed || x > 2ULL * LEVEL_CHUNK_LIMIT || y > 2ULL * LEVEL_CHUNK_LIMIT || count > GRID_CHUNK_AREA) return false;
+	*cx = Unzigzag((unsigned int)x);
+	*cy = Unzigzag((unsigned int)y);
+	*blocks = (int)count;
+	return true;
+}
+
+static bool ReadChunk(LevelReader* r, const Palette* palette, World* world) {
+	int cx, cy, blocks;
+	if (!ReadChunkPlace(r, &cx, &cy, &blocks)) return false;
+	unsigned long long bytes = ReadVarint(r);
+	if (r->failed) return false;
+
+	unsigned long long start = r->consumed;
+	if (!DecodeRuns(r, cx, cy, (unsigned long long)blocks, palette, world, NULL)) return false;
+	return r->consumed - start == bytes;
+}
+
+bool LevelRead(FILE* file, LevelInfo* info, World* world, atomic_int* progress) {
+	LevelReader* r = calloc(1, sizeof(LevelReader));
+	r->file = file;
+	r->storage = malloc(LEVEL_IO_BUFFER);
+	r->data = r->storage;
+
+	long start = ftell(file);
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file) - start;
+	fseek(file, start, SEEK_SET);
+
+	Palette palette = { 0 };
+	bool ok = false;
+
+	if (!ReadHeader(r, info, &palette) || !ReadLoose(r, &palette, world)) goto done;
+
+	for (;;) {
+		unsigned char marker = ReadU8(r);
+		if (r->failed || marker > 1) goto done;
+		if (marker == 0) break;
+		if (!ReadChunk(r, &palette, world)) goto done;
+		if (progress != NULL && fileSize > 0) atomic_store(progress, (int)((long long)r->consumed * 999 / fileSize));
+	}
+	ok = !r->failed;
+	if (ok && progress != NULL) atomic_store(progress, 1000);
+
+done:
+	free(palette.entries);
+	free(r->storage);
+	free(r);
+	return ok;
+}
+
+bool LevelOpenIndex(const unsigned char* data, size_t size, LevelIndex* index, World* world) {
+	memset(index, 0, sizeof(LevelIndex));
+
+	LevelReader r;
+	InitMemoryReader(&r, data, size);
+
+	Palette palette = { 0 };
+	bool ok = ReadHeader(&r, &index->info, &palette) && ReadLoose(&r, &palette, world);
+	index->palette = palette.entries;
+	index->paletteCount = palette.count;
+	if (!ok || size < 12 || memcmp(data + size - 4, LEVEL_FOOTER_MAGIC, 4) != 0) return false;
+
+	size_t chunksStart = (size_t)r.consumed;
+	InitMemoryReader(&r, data + size - 12, 8);
+	unsigned long long tableOffset = ReadUInt(&r, 8);
+	if (tableOffset < chunksStart || tableOffset > size - 12) return false;
+
+	InitMemoryReader(&r, data + tableOffset, size - 12 - (size_t)tableOffset);
+	unsigned long long count = ReadVarint(&r);
+	if (r.failed || count > (size - (size_t)tableOffset) / 4) return false;
+
+	index->chunks = malloc((size_t)(count > 0 ? count : 1) * sizeof(LevelChunkRef));
+	for (unsigned long long i = 0; i < count; i++) {
+		LevelChunkRef* ref = &index->chunks[index->chunkCount];
+		if (!ReadChunkPlace(&r, &ref->cx, &ref->cy, &ref->blocks)) return false;
+		unsigned long long offset = ReadUInt(&r, 8);
+		unsigned long long bytes = ReadVarint(&r);
+		if (r.failed || offset < chunksStart || bytes > tableOffset || offset > tableOffset - bytes) return false;
+
+		ref->data = data + offset;
+		ref->bytes = (int)bytes;
+		index->chunkCount++;
+	}
+	return true;
+}
+
+void LevelFreeIndex(LevelIndex* index) {
+	free(index->palette);
+	free(index->chunks);
+	memset(index, 0, sizeof(LevelIndex));
+}
+
+bool LevelDecodeChunk(const LevelChunkRef* chunk, const LevelPaletteEntry* palette, int paletteCount, World* world, int* ids) {
+	LevelReader r;
+	InitMemoryReader(&r, chunk->data, (size_t)chunk->bytes);
+
+	Palette view = { (PaletteEntry*)palette, paletteCount, paletteCount, 0 };
+	if (!DecodeRuns(&r, chunk->cx, chunk->cy, (unsigned long long)chunk->blocks, &view, world, ids)) return false;
+	return r.consumed == (unsigned long long)chunk->bytes;
+}
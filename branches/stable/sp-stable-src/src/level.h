@@ -0,0 +1,99 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include "game.h"
+#include "world.h"
+#include <stdio.h>
+#include <stdatomic.h>
+
+// Versioned level format, read and written in a single streaming pass.
+//
+//   header   "SLVL", u16 version, u16 flags
+//   info     f32 player x/y, u8 night, weather, player colour, block colour, shape
+//   palette  varint count, then per entry u8 r,g,b,a, u8 shape, varint w/h in cells
+//   loose    varint count, then per block varint palette, f32 x,y,w,h
+//   chunks   u8 1 per chunk: zigzag cx,cy, varint blocks, varint bytes, runs; u8 0 ends
+//   table    varint count, then zigzag cx,cy, varint blocks, u64 offset, varint bytes
+//   footer   u64 table offset, "SLVE"
+//
+// Blocks that sit on the BLOCK_SIZE grid are stored per 16x16 chunk as runs
+// of touching blocks along a row that share a palette entry: varint cells
+// skipped since the previous run, varint run length - 1, varint palette. The
+// rest, and always block 0, go in the loose list so the base platform keeps
+// id 0 after loading. The chunk table lets a reader find one chunk without
+// decoding the rest. Integers are little endian.
+
+#define LEVEL_MAGIC "SLVL"
+#define LEVEL_FOOTER_MAGIC "SLVE"
+#define LEVEL_VERSION 1
+// Edge of the largest block a file may hold, a few chunks across.
+#define LEVEL_MAX_BLOCK_SIZE (4 * GRID_CHUNK_CELLS * BLOCK_SIZE)
+
+typedef struct {
+	Vector2 playerPos;
+	int isNight;
+	WeatherType weather;
+	int playerColor;
+	int blockColor;
+	int blockShape;
+} LevelInfo;
+
+typedef struct {
+	Color color;
+	BlockShape shape;
+	int w;
+	int h;
+} LevelPaletteEntry;
+
+// One chunk payload (its runs) as stored in a file.
+typedef struct {
+	int cx;
+	int cy;
+	int blocks;
+	const unsigned char* data;
+	int bytes;
+} LevelChunkRef;
+
+// Encoded chunks a save should copy through without decoding them, plus the
+// palette their runs index into. That palette becomes the start of the
+// palette of the new file.
+typedef struct {
+	const LevelPaletteEntry* palette;
+	int paletteCount;
+	const LevelChunkRef* chunks;
+	int chunkCount;
+} LevelSource;
+
+typedef struct {
+	LevelInfo info;
+	LevelPaletteEntry* palette;
+	int paletteCount;
+	LevelChunkRef* chunks;
+	int chunkCount;
+} LevelIndex;
+
+// progress, when not NULL, is advanced from 0 to 1000 as the level streams
+// through, so another thread can watch a save or load happen.
+bool LevelIsCurrentFormat(FILE* file);
+// source, when not NULL, adds chunks that are copied through still encoded.
+bool LevelWrite(FILE* file, const LevelInfo* info, const World* world, const LevelSource* source, atomic_int* progress);
+// Whether the settings in a file are ones the game can show; a level whose
+// info is not is rejected as corrupt.
+bool LevelInfoValid(const LevelInfo* info);
+// A block rect read from a file is only handed to the world if it is finite,
+// has a positive size no bigger than LEVEL_MAX_BLOCK_SIZE, and sits inside
+// the cell range the grid can address.
+bool LevelRectValid(Rectangle rect);
+// world must be freshly initialised; blocks are added in file order.
+bool LevelRead(FILE* file, LevelInfo* info, World* world, atomic_int* progress);
+
+// Random access to a level held in memory (usually mmap'ed). Opening reads
+// the header, adds the loose blocks to world and parses the chunk table;
+// chunk payloads are only decoded on request. The index points into data,
+// which must outlive it.
+bool LevelOpenIndex(const unsigned char* data, size_t size, LevelIndex* index, World* world);
+void LevelFreeIndex(LevelIndex* index);
+// ids, when not NULL, receives the id of each of the chunk's blocks.
+bool LevelDecodeChunk(const LevelChunkRef* chunk, const LevelPaletteEntry* palette, int paletteCount, World* world, int* ids);
+
+#endif
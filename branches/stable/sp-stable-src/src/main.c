@@ -5,86 +5,54 @@
 #include <string.h>
 #include <math.h>
 #include "rlgl.h"
+#include "game.h"
+#include "sim.h"
+#include "console.h"
+#include "weather.h"
+#include "save.h"
+#include "render.h"
+#include "profiler.h"
+#include "replay.h"
+#include "edit.h"
+#include "assets.h"
+#include "music.h"
+#include "watch.h"
 
-#define MAX_BLOCKS 2000
-#define MAX_PARTICLES 500
-#define PLAYER_SPEED 300.0f
-#define PLAYER_RUN_SPEED 500.0f
-#define JUMP_FORCE 550.0f
-#define GRAVITY 1000.0f
-#define MAX_FALL_SPEED 800.0f
-#define BLOCK_SIZE 40
-#define FREE_CAM_SPEED 600.0f
 #define SONG_COUNT 6	
 
-#define CONSOLE_HISTORY 100
-#define CONSOLE_VISIBLE 15
 #define NUM_GEARS 7
 #define GEAR_OFFSET_X 45.0f
 
-#define NUM_CUSTOM_BLOCKS 12
-
-typedef enum {
-	SHAPE_SQUARE, SHAPE_RECT, SHAPE_TRIANGLE, SHAPE_CIRCLE, SHAPE_RHOMBUS,
-	SHAPE_CUST1, SHAPE_CUST2, SHAPE_CUST3, SHAPE_CUST4, SHAPE_CUST5, SHAPE_CUST6,
-	SHAPE_CUST7, SHAPE_CUST8, SHAPE_CUST9, SHAPE_CUST10, SHAPE_CUST11, SHAPE_CUST12
-} BlockShape;
-
-typedef enum { WEATHER_NONE, WEATHER_RAIN, WEATHER_SNOW } WeatherType;
-typedef enum { CAM_FIXED, CAM_SMOOTH, CAM_FREE } GameCameraMode;
-
-typedef struct {
-	Rectangle rect;
-	int active;
-	Color color;
-	BlockShape shape;
-} Block;
-
-typedef struct {
-	Vector2 position;
-	float speed;
-	int active;
-} Particle;
-
-typedef struct {
-	Vector2 position;
-	Vector2 velocity;
-	bool grounded;
-	bool facingRight;
-} Player;
-
-typedef struct {
-	Vector2 playerPos;
-	bool isNightState;
-	WeatherType weatherType;
-	int playerColor;
-	int blockColor;
-	int blockShape;
-	int activeBlocksCount;
-	Block blocksToSave[MAX_BLOCKS];
-} GameData;
-
-Block blocks[MAX_BLOCKS];
-Particle particles[MAX_PARTICLES];
+WorldState sim;
+LevelPager levelPager = { 0 };
+ReplayRecorder replayRecorder = { 0 };
+ParticleSystem weatherParticles;
 Color blockColors[5];
 Color playerColors[6];
 
-Texture2D playerTexture;
+int playerSprite = -1;
 bool hasPlayerTexture = false;
 
-Texture2D cursorTexture;
+int cursorSprite = -1;
 bool hasCursorTexture = false;
 
-Texture2D gearTextures[NUM_GEARS];
+int gearSprites[NUM_GEARS];
+int snowSprite = -1;
 int currentGearIndex = 0;
 
-Texture2D customBlockTextures[NUM_CUSTOM_BLOCKS];
-
 Sound fxDeath;
 bool hasDeathSound = false;
 
-Music songs[SONG_COUNT] = { 0 };
-int currentSongIndex = 0;
+// Handles into the startup AssetLoader, -1 for files that are missing.
+int playerAsset = -1;
+int cursorAsset = -1;
+int gearAssets[NUM_GEARS];
+int customBlockAssets[NUM_CUSTOM_BLOCKS];
+int deathAsset = -1;
+int firstSongAsset = -1;
+
+Playlist playlist;
+AssetWatcher assetWatcher;
 const char* songFiles[] = {
 	"sounds/song1.mp3",
 	"sounds/song2.mp3",
@@ -105,162 +73,21 @@ const char* blockColorNames[] = { "AZUL", "ROJO", "VERDE", "AMARILLO", "ROSA" };
 const char* cameraModeNames[] = { "FIJA", "SUAVE", "LIBRE" };
 const char* weatherNames[] = { "DESPEJADO", "LLUVIA", "NIEVE" };
 const char* dayNightNames[] = { "DIA", "NOCHE" };
+const char* editToolNames[] = { "BLOQUE", "RECTANGULO", "RELLENO" };
 
-char consoleLog[CONSOLE_HISTORY][128];
-int consoleScroll = 0;
 bool showConsole = false;
+unsigned long long consoleSeen = 0;
 
 bool showCheatUI = false;
 char cheatBuffer[7] = { 0 };
-bool cheatFly = false;
-bool cheatInfJump = false;
-bool cheatNoClip = false;
-
-static void AddConsoleLog(const char* text) {
-	for (int i = 0; i < CONSOLE_HISTORY - 1; i++) {
-		strcpy(consoleLog[i], consoleLog[i + 1]);
-	}
-	strncpy(consoleLog[CONSOLE_HISTORY - 1], text, 127);
-	consoleScroll = 0;
-}
-
-static void UpdateCheatState() {
-	cheatFly = false;
-	cheatInfJump = false;
-	cheatNoClip = false;
-
-	if (strcmp(cheatBuffer, "29103") == 0) cheatFly = true;
-	if (strcmp(cheatBuffer, "84721") == 0) cheatInfJump = true;
-	if (strcmp(cheatBuffer, "112233") == 0) cheatNoClip = true;
-}
-
-static void ResetPlayer(Player* player, Block startPlatform) {
-	player->position = (Vector2){ startPlatform.rect.x + 50, startPlatform.rect.y - 100 };
-	player->velocity = (Vector2){ 0, 0 };
-	player->facingRight = true;
-	AddConsoleLog("Player position reset");
-}
-
-static void ResetGame(Player* player, Block* baseBlocks) {
-	for (int i = 1; i < MAX_BLOCKS; i++) {
-		blocks[i].active = 0;
-	}
-	ResetPlayer(player, baseBlocks[0]);
-	AddConsoleLog("Game map reset");
-}
-
-static void InitParticles() {
-	for (int i = 0; i < MAX_PARTICLES; i++) {
-		particles[i].active = 0;
-	}
-}
-
-static void UpdateWeather(WeatherType weather, Camera2D cam, int screenW, int screenH) {
-	if (weather == WEATHER_NONE) return;
-
-	float dt = GetFrameTime();
-
-	for (int i = 0; i < MAX_PARTICLES; i++) {
-		if (!particles[i].active) {
-			particles[i].position.x = (float)GetRandomValue((int)(cam.target.x - screenW), (int)(cam.target.x + screenW));
-			particles[i].position.y = cam.target.y - screenH / 2.0f - GetRandomValue(0, 200);
-			particles[i].speed = (float)((weather == WEATHER_RAIN) ? GetRandomValue(400, 800) : GetRandomValue(50, 150));
-			particles[i].active = 1;
-		}
-
-		particles[i].position.y += particles[i].speed * dt;
-		if (weather == WEATHER_SNOW) particles[i].position.x += (float)GetRandomValue(-50, 50) * dt;
-
-		if (particles[i].position.y > cam.target.y + screenH) {
-			particles[i].active = 0;
-		}
-	}
-}
-
-static void DrawWeather(WeatherType weather) {
-	if (weather == WEATHER_NONE) return;
-	for (int i = 0; i < MAX_PARTICLES; i++) {
-		if (particles[i].active) {
-			if (weather == WEATHER_RAIN) {
-				DrawLineV(particles[i].position, (Vector2) { particles[i].position.x, particles[i].position.y + 10 }, Fade(BLUE, 0.7f));
-			}
-			else {
-				DrawCircleV(particles[i].position, 2, Fade(WHITE, 0.8f));
-			}
-		}
-	}
-}
-
-static void DrawBlockShape(Block b) {
-	if (b.shape >= SHAPE_CUST1 && b.shape <= SHAPE_CUST12) {
-		int texIndex = b.shape - SHAPE_CUST1;
-		if (customBlockTextures[texIndex].id != 0) {
-			Rectangle source = { 0.0f, 0.0f, (float)customBlockTextures[texIndex].width, (float)customBlockTextures[texIndex].height };
-			Vector2 origin = { 0.0f, 0.0f };
-			DrawTexturePro(customBlockTextures[texIndex], source, b.rect, origin, 0.0f, WHITE);
-		}
-		else {
-			DrawRectangleRec(b.rect, MAGENTA);
-		}
-		return;
-	}
-
-	switch (b.shape) {
-	case SHAPE_SQUARE: DrawRectangleRec(b.rect, b.color); break;
-	case SHAPE_RECT: DrawRectangleRec(b.rect, b.color); break;
-	case SHAPE_TRIANGLE:
-		DrawTriangle(
-			(Vector2) {
-			b.rect.x + b.rect.width / 2, b.rect.y
-		},
-			(Vector2) {
-			b.rect.x, b.rect.y + b.rect.height
-		},
-			(Vector2) {
-			b.rect.x + b.rect.width, b.rect.y + b.rect.height
-		},
-			b.color
-		);
-		break;
-	case SHAPE_CIRCLE:
-		DrawCircle((int)(b.rect.x + b.rect.width / 2), (int)(b.rect.y + b.rect.height / 2), (float)b.rect.width / 2, b.color);
-		break;
-	case SHAPE_RHOMBUS:
-		DrawTriangle(
-			(Vector2) {
-			b.rect.x + b.rect.width / 2, b.rect.y
-		},
-			(Vector2) {
-			b.rect.x, b.rect.y + b.rect.height / 2
-		},
-			(Vector2) {
-			b.rect.x + b.rect.width, b.rect.y + b.rect.height / 2
-		},
-			b.color
-		);
-		DrawTriangle(
-			(Vector2) {
-			b.rect.x, b.rect.y + b.rect.height / 2
-		},
-			(Vector2) {
-			b.rect.x + b.rect.width / 2, b.rect.y + b.rect.height
-		},
-			(Vector2) {
-			b.rect.x + b.rect.width, b.rect.y + b.rect.height / 2
-		},
-			b.color
-		);
-		break;
-	}
-}
 
 static void DrawPlayer(Player p, Color color) {
 	if (hasPlayerTexture) {
-		Rectangle sourceRec = { 0.0f, 0.0f, (float)playerTexture.width, (float)playerTexture.height };
+		Rectangle sourceRec = AtlasSource(&spriteAtlas, playerSprite);
 		if (!p.facingRight) sourceRec.width = -sourceRec.width;
 		Rectangle destRec = { p.position.x, p.position.y, 40.0f, 40.0f };
 		Vector2 origin = { 0.0f, 0.0f };
-		DrawTexturePro(playerTexture, sourceRec, destRec, origin, 0.0f, WHITE);
+		DrawTexturePro(spriteAtlas.texture, sourceRec, destRec, origin, 0.0f, WHITE);
 	}
 	else {
 		DrawRectangleV(p.position, (Vector2) { 40, 40 }, color);
@@ -275,83 +102,124 @@ static void DrawPlayer(Player p, Color color) {
 	}
 }
 
+// Whole cells between two world points, both included.
+static Rectangle CellSpan(Vector2 a, Vector2 b) {
+	float x0 = floorf(fminf(a.x, b.x) / BLOCK_SIZE) * BLOCK_SIZE;
+	float y0 = floorf(fminf(a.y, b.y) / BLOCK_SIZE) * BLOCK_SIZE;
+	float x1 = (floorf(fmaxf(a.x, b.x) / BLOCK_SIZE) + 1) * BLOCK_SIZE;
+	float y1 = (floorf(fmaxf(a.y, b.y) / BLOCK_SIZE) + 1) * BLOCK_SIZE;
+	return (Rectangle){ x0, y0, x1 - x0, y1 - y0 };
+}
+
 static void DrawTextRight(const char* text, int y, int fontSize, Color color, int screenWidth) {
 	int textWidth = MeasureText(text, fontSize);
 	DrawText(text, screenWidth - textWidth - 10, y, fontSize, color);
 }
 
-static void SaveGame(const Player* player, const Block* blocks, int isNight, WeatherType weather, int playerColorIndex, int selectedColorIndex, int selectedShapeIndex) {
-	static GameData data = { 0 };
-	memset(&data, 0, sizeof(GameData));
-	data.playerPos = player->position;
-	data.isNightState = isNight;
-	data.weatherType = weather;
-	data.playerColor = playerColorIndex;
-	data.blockColor = selectedColorIndex;
-	data.blockShape = selectedShapeIndex;
-
-	int activeCount = 0;
-	for (int i = 0; i < MAX_BLOCKS; i++) {
-		if (blocks[i].active) {
-			if (activeCount < MAX_BLOCKS) {
-				data.blocksToSave[activeCount] = blocks[i];
-				activeCount++;
-			}
-		}
-	}
-	data.activeBlocksCount = activeCount;
+static void QueueAssets(AssetLoader* assets) {
+	playerAsset = AssetQueue(assets, ASSET_IMAGE, "images/player.png");
+	if (playerAsset < 0) AddConsoleLogf(CONSOLE_WARNING, "Texture: player.png not found, using default");
+
+	cursorAsset = AssetQueue(assets, ASSET_IMAGE, "images/cursor.png");
+	if (cursorAsset < 0) AddConsoleLogf(CONSOLE_WARNING, "Texture: cursor.png not found, using system cursor");
 
-	unsigned int dataSize = sizeof(GameData);
-	if (SaveFileData("level.dat", &data, dataSize)) {
-		AddConsoleLog(TextFormat("Game saved successfully: %d blocks", activeCount));
+	for (int i = 0; i < NUM_GEARS; i++) {
+		const char* fileName = TextFormat("images/gear%d.png", i + 1);
+		gearAssets[i] = AssetQueue(assets, ASSET_IMAGE, fileName);
+		if (gearAssets[i] < 0) AddConsoleLogf(CONSOLE_WARNING, "Warning: %s not found", fileName);
 	}
-	else {
-		AddConsoleLog("Error saving game data!");
+
+	for (int i = 0; i < NUM_CUSTOM_BLOCKS; i++) {
+		const char* customName = TextFormat("custom/customblock%d.png", i + 1);
+		customBlockAssets[i] = AssetQueue(assets, ASSET_IMAGE, customName);
+		if (customBlockAssets[i] < 0) AddConsoleLogf(CONSOLE_WARNING, "Warning: %s not found", customName);
 	}
+
+	deathAsset = AssetQueue(assets, ASSET_SOUND, "sounds/oof.mp3");
+	if (deathAsset < 0) AddConsoleLogf(CONSOLE_WARNING, "SFX: oof.mp3 not found");
+
+	// The other songs are opened by the playlist when their turn comes.
+	firstSongAsset = AssetQueue(assets, ASSET_MUSIC, songFiles[0]);
+	if (firstSongAsset < 0) AddConsoleLogf(CONSOLE_WARNING, "Music: %s not found", songFiles[0]);
 }
 
-static void LoadGame(Player* player, Block* blocks, int* isNight, WeatherType* weather, int* playerColorIndex, int* selectedColorIndex, int* selectedShapeIndex) {
-	unsigned int bytesRead = 0;
-	unsigned char* fileData = LoadFileData("level.dat", &bytesRead);
+// Runs once every asset is decoded: packs the images into the atlas, which
+// is the only GPU upload, and takes over the sounds and songs.
+// Files that were never found were reported when they were queued; one that
+// was found but did not decode or has no pixels is reported here.
+static int AddSprite(AssetLoader* assets, int handle) {
+	if (handle < 0) return -1;
+	int sprite = AtlasAddImage(&spriteAtlas, AssetTakeImage(assets, handle));
+	if (sprite < 0) AddConsoleLogf(CONSOLE_WARNING, "Texture: %s could not be loaded", assets->assets[handle].fileName);
+	return sprite;
+}
 
-	if (fileData != NULL) {
-		if (bytesRead >= sizeof(GameData)) {
-			static GameData data = { 0 };
-			memcpy(&data, fileData, sizeof(GameData));
+static void ApplyAssets(AssetLoader* assets) {
+	playerSprite = AddSprite(assets, playerAsset);
+	hasPlayerTexture = (playerSprite >= 0);
 
-			player->position = data.playerPos;
-			player->velocity = (Vector2){ 0, 0 };
-			player->grounded = false;
+	cursorSprite = AddSprite(assets, cursorAsset);
+	hasCursorTexture = (cursorSprite >= 0);
 
-			*isNight = data.isNightState;
-			*weather = data.weatherType;
-			*playerColorIndex = data.playerColor;
-			*selectedColorIndex = data.blockColor;
-			*selectedShapeIndex = data.blockShape;
+	for (int i = 0; i < NUM_GEARS; i++) {
+		gearSprites[i] = AddSprite(assets, gearAssets[i]);
+	}
+	for (int i = 0; i < NUM_CUSTOM_BLOCKS; i++) {
+		customBlockSprites[i] = AddSprite(assets, customBlockAssets[i]);
+	}
+	// The snowflake is generated, so it is in the atlas whatever was found.
+	if (spriteAtlas.count == 0) AddConsoleLogf(CONSOLE_WARNING, "Texture: no sprites loaded, drawing plain shapes");
+	snowSprite = AtlasAddImage(&spriteAtlas, GenSnowflakeImage());
+
+	if (!AtlasBuild(&spriteAtlas, false)) {
+		AddConsoleLogf(CONSOLE_WARNING, "Texture: sprite atlas could not be built, drawing plain shapes");
+		hasPlayerTexture = false;
+		hasCursorTexture = false;
+	}
+	else {
+		if (hasPlayerTexture) AddConsoleLog("Texture: images/player.png loaded");
+		if (hasCursorTexture) AddConsoleLog("Texture: images/cursor.png loaded");
+	}
+	if (hasCursorTexture) HideCursor();
 
-			for (int i = 0; i < MAX_BLOCKS; i++) {
-				blocks[i].active = 0;
-			}
+	fxDeath = AssetTakeSound(assets, deathAsset);
+	hasDeathSound = (fxDeath.stream.buffer != NULL);
 
-			for (int i = 0; i < data.activeBlocksCount; i++) {
-				blocks[i] = data.blocksToSave[i];
-				blocks[i].active = 1;
-			}
+	PlaylistPlay(&playlist, AssetTakeMusic(assets, firstSongAsset), 0);
 
-			InitParticles();
-			AddConsoleLog(TextFormat("Game loaded successfully: %d blocks", data.activeBlocksCount));
-		}
-		else {
-			AddConsoleLog("Load failed: File size mismatch");
-		}
-		UnloadFileData(fileData);
+	AddConsoleLog("Audio System Started");
+}
+
+// Sprites the level designers iterate on are reloaded when their file is
+// saved.
+static void WatchSprites(AssetWatcher* watcher) {
+	WatcherAdd(watcher, "images/player.png", &playerSprite);
+	for (int i = 0; i < NUM_GEARS; i++) {
+		WatcherAdd(watcher, TextFormat("images/gear%d.png", i + 1), &gearSprites[i]);
 	}
-	else {
-		AddConsoleLog("Load failed: level.dat not found");
+	for (int i = 0; i < NUM_CUSTOM_BLOCKS; i++) {
+		WatcherAdd(watcher, TextFormat("custom/customblock%d.png", i + 1), &customBlockSprites[i]);
 	}
+	if (WatcherStart(watcher)) AddConsoleLogf(CONSOLE_INFO, "Watch: hot reload on for %d sprites", watcher->count);
 }
 
-int main(void) {
+static void ApplySpriteReloads(AssetWatcher* watcher) {
+	SpriteReload reload;
+	while (WatcherPoll(watcher, &reload)) {
+		double t0 = GetTime();
+		int sprite = AtlasReplace(&spriteAtlas, *reload.sprite, reload.image);
+		if (sprite < 0) {
+			AddConsoleLogf(CONSOLE_WARNING, "Reload: %s could not be swapped in", reload.fileName);
+			continue;
+		}
+		*reload.sprite = sprite;
+		AddConsoleLogf(CONSOLE_INFO, "Reload: %s decoded in %.1f ms, swapped in %.1f ms", reload.fileName,
+			reload.decodeSeconds * 1000.0, (GetTime() - t0) * 1000.0);
+	}
+	hasPlayerTexture = AtlasHas(&spriteAtlas, playerSprite);
+}
+
+int main(int argc, char** argv) {
 
 	//SetConfigFlags(FLAG_VSYNC_HINT);
 	SetExitKey(KEY_ESCAPE);
@@ -360,10 +228,20 @@ int main(void) {
 	int screenWidth = 1280;
 	int screenHeight = 720;
 
-	for (int i = 0; i < CONSOLE_HISTORY; i++) memset(consoleLog[i], 0, 128);
+	ClearConsoleLog();
+	StartConsoleFileSink("platform.log", 1024 * 1024, 3);
+
+	// --page-budget MB caps the memory a streamed level may hold.
+	int pageBudgetMB = PAGER_DEFAULT_BUDGET_MB;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--page-budget") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) pageBudgetMB = atoi(argv[++i]);
+		else AddConsoleLogf(CONSOLE_WARNING, "Ignoring argument %s", argv[i]);
+	}
 
 	InitWindow(screenWidth, screenHeight, "SDFX Engine - Cargando...");
 	InitAudioDevice();
+	RenderInit();
+	WeatherRenderInit();
 
 	SetTargetFPS(60);
 
@@ -381,71 +259,22 @@ int main(void) {
 	SetWindowTitle("Platform");
 	AddConsoleLog(TextFormat("GPU: OpenGL %s initialized correctly", glText));
 
-	if (FileExists("images/player.png")) {
-		playerTexture = LoadTexture("images/player.png");
-		hasPlayerTexture = true;
-		AddConsoleLog("Texture: images/player.png loaded");
-	}
-	else {
-		AddConsoleLog("Texture: player.png not found, using default");
-	}
-
-	if (FileExists("images/cursor.png")) {
-		cursorTexture = LoadTexture("images/cursor.png");
-		hasCursorTexture = true;
-		HideCursor();
-		AddConsoleLog("Texture: images/cursor.png loaded");
-	}
-	else {
-		AddConsoleLog("Texture: cursor.png not found, using system cursor");
-	}
-
-	for (int i = 0; i < NUM_GEARS; i++) {
-		const char* fileName = TextFormat("images/gear%d.png", i + 1);
-		if (FileExists(fileName)) {
-			gearTextures[i] = LoadTexture(fileName);
-		}
-		else {
-			AddConsoleLog(TextFormat("Warning: %s not found", fileName));
-		}
-	}
-
-	AddConsoleLog("Gear textures initialized");
-
-	for (int i = 0; i < NUM_CUSTOM_BLOCKS; i++) {
-		const char* customName = TextFormat("custom/customblock%d.png", i + 1);
-		if (FileExists(customName)) {
-			customBlockTextures[i] = LoadTexture(customName);
-			AddConsoleLog(TextFormat("Custom Block Loaded: %s", customName));
-		}
-		else {
-			AddConsoleLog(TextFormat("Warning: %s not found", customName));
-		}
-	}
-
-	if (FileExists("sounds/oof.mp3")) {
-		fxDeath = LoadSound("sounds/oof.mp3");
-		hasDeathSound = true;
-		AddConsoleLog("SFX: oof.mp3 loaded");
-	}
-	else {
-		AddConsoleLog("SFX: oof.mp3 not found");
-	}
+	AtlasInit(&spriteAtlas, 2, true);
 
-	for (int i = 0; i < SONG_COUNT; i++) {
-		if (FileExists(songFiles[i])) {
-			songs[i] = LoadMusicStream(songFiles[i]);
-			songs[i].looping = true;
-			AddConsoleLog(TextFormat("Music: %s loaded", songFiles[i]));
-		}
-		else {
-			AddConsoleLog(TextFormat("Music: %s not found", songFiles[i]));
-		}
+	// Everything is decoded in the background while the boot screen runs;
+	// the game starts on the frame the last file lands.
+	AssetPack assetPack;
+	if (PackOpen(&assetPack, PACK_DEFAULT_FILE)) {
+		AddConsoleLogf(CONSOLE_INFO, "Assets: %s mapped, %d files", PACK_DEFAULT_FILE, assetPack.count);
 	}
 
-	PlayMusicStream(songs[0]);
+	PlaylistInit(&playlist, songFiles, SONG_COUNT, &assetPack);
+	if (!WatcherInit(&assetWatcher)) AddConsoleLogf(CONSOLE_WARNING, "Watch: inotify unavailable, hot reload is off");
 
-	AddConsoleLog("Audio System Started");
+	AssetLoader assets;
+	AssetLoaderInit(&assets, &assetPack);
+	QueueAssets(&assets);
+	AssetLoaderStart(&assets, 0);
 
 	blockColors[0] = BLUE; blockColors[1] = RED; blockColors[2] = GREEN;
 	blockColors[3] = YELLOW; blockColors[4] = PINK;
@@ -453,16 +282,10 @@ int main(void) {
 	playerColors[0] = GRAY; playerColors[1] = ORANGE; playerColors[2] = VIOLET;
 	playerColors[3] = GOLD; playerColors[4] = LIME; playerColors[5] = BLUE;
 
-	blocks[0].active = 1;
-	blocks[0].rect = (Rectangle){ -200, 300, 800, 40 };
-	blocks[0].color = GRAY;
-	blocks[0].shape = SHAPE_RECT;
-
-	Player player = { 0 };
-	ResetPlayer(&player, blocks[0]);
+	SimInit(&sim);
 
 	Camera2D camera = { 0 };
-	camera.target = player.position;
+	camera.target = sim.cameraTarget;
 	camera.offset = (Vector2){ screenWidth / 2.0f, screenHeight / 2.0f };
 	camera.rotation = 0.0f;
 	camera.zoom = 1.0f;
@@ -474,7 +297,6 @@ int main(void) {
 	float previewTimer = 0.0f;
 	bool showControls = false;
 	bool isStarting = true;
-	float startTimer = 0.0f;
 	bool showStats = false;
 	bool showDebug = false;
 	int isNight = 0;
@@ -483,14 +305,29 @@ int main(void) {
 	float gearSpeeds[NUM_GEARS] = { 0.0f, 0.0f, 0.0f, 0.0f, 120.0f, 120.0f, 120.0f };
 	float gearAngles[NUM_GEARS] = { 0 };
 
+	// The rectangle tool fills on a right-button drag and erases on a left
+	// one; the flood tool fills the closed area under a right click.
+	EditTool editTool = EDIT_BLOCK;
+	int dragButton = -1;
+	Vector2 dragStart = { 0 };
+
 	WeatherType currentWeather = WEATHER_NONE;
-	GameCameraMode currentCameraMode = CAM_SMOOTH;
 
-	InitParticles();
-	Rectangle potentialBlock = { 0 };
-	Rectangle playerRect = { 0 };
+	ParticleSystemInit(&weatherParticles, MAX_PARTICLES);
+
+	// Physics and weather run on fixed ticks; the player and the camera are
+	// drawn between the last two ticks. Jump and reset presses are latched
+	// so a frame without a tick does not lose them.
+	SimClock simClock;
+	SimClockInit(&simClock, SIM_TICK_RATE);
+	Vector2 prevPlayerPos = sim.player.position;
+	Vector2 prevCameraTarget = sim.cameraTarget;
+	bool jumpLatched = false;
+	bool resetLatched = false;
+	int lastTicks = 0;
 
 	while (!WindowShouldClose()) {
+		ProfilerBeginFrame();
 		float dt = GetFrameTime();
 		if (dt > 0.034f) dt = 0.034f;
 
@@ -501,18 +338,32 @@ int main(void) {
 
 		if (isStarting) {
 			gamePaused = true;
-			startTimer += GetFrameTime();
-			if (startTimer >= 3.0f) {
+			if (AssetLoaderUpdate(&assets)) {
+				ApplyAssets(&assets);
+				AssetLoaderFree(&assets);
+				WatchSprites(&assetWatcher);
 				isStarting = false;
 				gamePaused = false;
 				AddConsoleLog("System loaded. Welcome.");
 			}
 		}
 
-		if (songs[currentSongIndex].stream.buffer != NULL) {
-			UpdateMusicStream(songs[currentSongIndex]);
+		if (!isStarting) ApplySpriteReloads(&assetWatcher);
+
+		ProfilerBegin(ZONE_MUSIC);
+		PlaylistUpdate(&playlist);
+		ProfilerEnd(ZONE_MUSIC);
+
+		ProfilerBegin(ZONE_STREAMING);
+		if (UpdateLevelJobs(&sim.player, &sim.world, &isNight, &currentWeather, &playerColorIndex, &selectedColorIndex, &selectedShapeIndex)) {
+			PagerClose(&levelPager);
+			InitParticles(&weatherParticles);
+			prevPlayerPos = sim.player.position;
+			prevCameraTarget = sim.cameraTarget;
 		}
+		ProfilerEnd(ZONE_STREAMING);
 
+		ProfilerBegin(ZONE_INPUT);
 		if (IsKeyPressed(KEY_F1)) {
             AddConsoleLog("HELP: https://github.com/agustinsdfx/Platform/blob/main/doc/HELP.md");
         }
@@ -522,23 +373,30 @@ int main(void) {
 			if (gamePaused) AddConsoleLog("GAME PAUSED");
 			else AddConsoleLog("GAME RESUMED");
 		}
+		ProfilerEnd(ZONE_INPUT);
 
 		if (!gamePaused) {
+			ProfilerBegin(ZONE_INPUT);
 
 			if (IsKeyPressed(KEY_F7)) {
-				if (songs[currentSongIndex].stream.buffer != NULL) StopMusicStream(songs[currentSongIndex]);
-				currentSongIndex++;
-				if (currentSongIndex >= SONG_COUNT) currentSongIndex = 0;
-				if (songs[currentSongIndex].stream.buffer != NULL) PlayMusicStream(songs[currentSongIndex]);
-				AddConsoleLog(TextFormat("Music changed to: %s", songFiles[currentSongIndex]));
+				PlaylistNext(&playlist);
 			}
 
 			if (IsKeyPressed(KEY_F8)) {
-				SaveGame(&player, blocks, isNight, currentWeather, playerColorIndex, selectedColorIndex, selectedShapeIndex);
+				SaveGameAsync("level.dat", &sim.player, &sim.world, PagerSnapshot(&levelPager, &sim.world), isNight, currentWeather, playerColorIndex, selectedColorIndex, selectedShapeIndex);
 			}
 			if (IsKeyPressed(KEY_F10)) showConsole = !showConsole;
 			if (IsKeyPressed(KEY_F9)) {
-				LoadGame(&player, blocks, &isNight, &currentWeather, &playerColorIndex, &selectedColorIndex, &selectedShapeIndex);
+				if (IsStreamableLevel("level.dat")) {
+					if (StreamGame("level.dat", &levelPager, pageBudgetMB, &sim.player, &sim.world, &isNight, &currentWeather, &playerColorIndex, &selectedColorIndex, &selectedShapeIndex)) {
+						InitParticles(&weatherParticles);
+						prevPlayerPos = sim.player.position;
+						prevCameraTarget = sim.cameraTarget;
+					}
+				}
+				else {
+					LoadGameAsync("level.dat");
+				}
 			}
 
 			if (IsKeyPressed(KEY_C)) {
@@ -546,8 +404,25 @@ int main(void) {
 				AddConsoleLog(hideUI ? "UI Hidden" : "UI Visible");
 			}
 
-			if (IsKeyPressed(KEY_F2)) showStats = !showStats;
-			if (IsKeyPressed(KEY_F3)) showDebug = !showDebug;
+			if (IsKeyPressed(KEY_F2)) {
+				if (IsKeyDown(KEY_LEFT_SHIFT)) {
+					if (ProfilerDumpTrace("trace.json", PROFILER_TRACE_SECONDS)) AddConsoleLog("Profiler: last 10 s written to trace.json");
+					else AddConsoleLogf(CONSOLE_ERROR, "Profiler: could not write trace.json");
+				}
+				else {
+					showStats = !showStats;
+				}
+			}
+			if (IsKeyPressed(KEY_F3)) {
+				if (IsKeyDown(KEY_LEFT_SHIFT)) {
+					int nextRate = (simClock.tickRate >= 240) ? 60 : simClock.tickRate * 2;
+					SimClockSetRate(&simClock, nextRate);
+					AddConsoleLogf(CONSOLE_INFO, "Simulation tick rate: %d Hz", nextRate);
+				}
+				else {
+					showDebug = !showDebug;
+				}
+			}
 			if (IsKeyPressed(KEY_F4)) {
 				isNight = (isNight == 0);
 				AddConsoleLog(isNight ? "Time: Night" : "Time: Day");
@@ -555,14 +430,14 @@ int main(void) {
 			if (IsKeyPressed(KEY_F5)) {
 				currentWeather = (WeatherType)(currentWeather + 1);
 				if (currentWeather > 2) currentWeather = WEATHER_NONE;
-				InitParticles();
+				InitParticles(&weatherParticles);
 				AddConsoleLog(TextFormat("Weather set to: %s", weatherNames[currentWeather]));
 			}
 			if (IsKeyPressed(KEY_F6)) {
-				int nextMode = (int)currentCameraMode + 1;
+				int nextMode = (int)sim.cameraMode + 1;
 				if (nextMode > (int)CAM_FREE) nextMode = (int)CAM_FIXED;
-				currentCameraMode = (GameCameraMode)nextMode;
-				AddConsoleLog(TextFormat("Camera set to: %s", cameraModeNames[currentCameraMode]));
+				sim.cameraMode = (GameCameraMode)nextMode;
+				AddConsoleLogf(CONSOLE_INFO, "Camera set to: %s", cameraModeNames[sim.cameraMode]);
 			}
 
 			if (IsKeyPressed(KEY_F11)) {
@@ -603,10 +478,15 @@ int main(void) {
 				AddConsoleLog("Screenshot saved: screenshot.png");
 			}
 
+			if (IsKeyPressed(KEY_R)) {
+				if (ReplayIsRecording(&replayRecorder)) ReplayStopRecording(&replayRecorder, &sim);
+				else ReplayStartRecording(&replayRecorder, "replay.rpl", &sim, simClock.tickRate);
+			}
+
+			ProfilerBegin(ZONE_CHEATS);
 			if (IsKeyPressed(KEY_K)) {
 				if (IsKeyDown(KEY_LEFT_SHIFT)) {
 					memset(cheatBuffer, 0, 7);
-					UpdateCheatState();
 					AddConsoleLog("CHEATS: ALL CLEARED");
 				}
 				else {
@@ -623,7 +503,6 @@ int main(void) {
 						if (len < 6) {
 							cheatBuffer[len] = numChar;
 							cheatBuffer[len + 1] = '\0';
-							UpdateCheatState();
 						}
 					}
 				}
@@ -631,19 +510,20 @@ int main(void) {
 					int len = (int)strlen(cheatBuffer);
 					if (len > 0) {
 						cheatBuffer[len - 1] = '\0';
-						UpdateCheatState();
 					}
 				}
 			}
+			ProfilerEnd(ZONE_CHEATS);
 
 			if (IsKeyPressed(KEY_Z)) {
 				playerColorIndex++;
 				if (playerColorIndex > 5) playerColorIndex = 0;
 			}
 
-			if (IsKeyPressed(KEY_X)) {
-				if (hasDeathSound) PlaySound(fxDeath);
-				ResetGame(&player, blocks);
+			if (IsKeyPressed(KEY_B)) {
+				editTool = (EditTool)((editTool + 1) % 3);
+				dragButton = -1;
+				AddConsoleLogf(CONSOLE_INFO, "Edit tool: %s", editToolNames[editTool]);
 			}
 
 			if (IsKeyPressed(KEY_G)) {
@@ -670,138 +550,101 @@ int main(void) {
 
 			if (previewTimer > 0) previewTimer -= dt;
 
-			if (currentCameraMode == CAM_FREE || cheatFly) {
-				float moveSpeed = (cheatFly) ? PLAYER_SPEED * 1.5f : FREE_CAM_SPEED;
-				float dtSpeed = moveSpeed * dt;
-
-				Vector2* targetPos = (cheatFly) ? &player.position : &camera.target;
-
-				if (IsKeyDown(KEY_RIGHT)) targetPos->x += dtSpeed;
-				if (IsKeyDown(KEY_LEFT)) targetPos->x -= dtSpeed;
-				if (IsKeyDown(KEY_UP)) targetPos->y -= dtSpeed;
-				if (IsKeyDown(KEY_DOWN)) targetPos->y += dtSpeed;
-
-				player.velocity = (Vector2){ 0, 0 };
-				if (cheatFly) camera.target = player.position;
-			}
-			else {
-				float currentSpeed = PLAYER_SPEED;
-				if (IsKeyDown(KEY_DOWN)) currentSpeed = PLAYER_RUN_SPEED;
-
-				if (IsKeyDown(KEY_RIGHT)) {
-					player.velocity.x = currentSpeed;
-					player.facingRight = true;
-				}
-				else if (IsKeyDown(KEY_LEFT)) {
-					player.velocity.x = -currentSpeed;
-					player.facingRight = false;
+			bool editing = !showConsole && !showCheatUI;
+
+			InputFrame input = { 0 };
+			input.left = IsKeyDown(KEY_LEFT);
+			input.right = IsKeyDown(KEY_RIGHT);
+			input.up = IsKeyDown(KEY_UP);
+			input.down = IsKeyDown(KEY_DOWN);
+			jumpLatched |= IsKeyPressed(KEY_UP);
+			resetLatched |= IsKeyPressed(KEY_X);
+			input.placeHeld = editing && editTool == EDIT_BLOCK && IsMouseButtonDown(MOUSE_BUTTON_RIGHT);
+			input.removeHeld = editing && editTool == EDIT_BLOCK && IsMouseButtonDown(MOUSE_BUTTON_LEFT);
+			input.mouseWorld = GetScreenToWorld2D(GetMousePosition(), camera);
+			input.blockColor = blockColors[selectedColorIndex];
+			input.blockShape = (BlockShape)selectedShapeIndex;
+			memcpy(input.cheatCode, cheatBuffer, sizeof(input.cheatCode));
+
+			Rectangle playerRect = { sim.player.position.x, sim.player.position.y, 40, 40 };
+			if (editing && editTool == EDIT_RECT) {
+				if (dragButton == -1) {
+					if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) dragButton = MOUSE_BUTTON_RIGHT;
+					else if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) dragButton = MOUSE_BUTTON_LEFT;
+					dragStart = input.mouseWorld;
 				}
-				else {
-					player.velocity.x = 0;
-				}
-
-				if (IsKeyPressed(KEY_UP)) {
-					if (player.grounded || cheatInfJump) {
-						player.velocity.y = -JUMP_FORCE;
-						player.grounded = false;
+				else if (IsMouseButtonReleased(dragButton)) {
+					Rectangle area = CellSpan(dragStart, input.mouseWorld);
+					if (dragButton == MOUSE_BUTTON_RIGHT) {
+						int added = EditFillRect(&sim.world, area, input.blockColor, input.blockShape, playerRect);
+						if (added < 0) AddConsoleLogf(CONSOLE_WARNING, "Fill: area too large");
+						else AddConsoleLogf(CONSOLE_INFO, "Fill: %d blocks placed", added);
 					}
+					else {
+						AddConsoleLogf(CONSOLE_INFO, "Erase: %d blocks removed", EditEraseRect(&sim.world, area));
+					}
+					dragButton = -1;
 				}
-
-				player.velocity.y += GRAVITY * dt;
 			}
-
-			if (!cheatFly) {
-				if (player.velocity.y > MAX_FALL_SPEED) player.velocity.y = MAX_FALL_SPEED;
-				player.position.x += player.velocity.x * dt;
+			else if (editing && editTool == EDIT_FLOOD && IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) {
+				int added = EditFloodFill(&sim.world, input.mouseWorld, input.blockColor, input.blockShape, playerRect);
+				if (added < 0) AddConsoleLogf(CONSOLE_WARNING, "Flood fill: the area is not closed");
+				else AddConsoleLogf(CONSOLE_INFO, "Flood fill: %d blocks placed", added);
 			}
-
-			playerRect = (Rectangle){ player.position.x, player.position.y, 40, 40 };
-
-			if (!cheatNoClip) {
-				for (int i = 0; i < MAX_BLOCKS; i++) {
-					if (blocks[i].active && CheckCollisionRecs(playerRect, blocks[i].rect)) {
-						if (player.velocity.x > 0) player.position.x = blocks[i].rect.x - playerRect.width;
-						else if (player.velocity.x < 0) player.position.x = blocks[i].rect.x + blocks[i].rect.width;
-					}
-				}
+			else {
+				dragButton = -1;
 			}
 
-			if (!cheatFly) {
-				player.position.y += player.velocity.y * dt;
-			}
+			ProfilerEnd(ZONE_INPUT);
 
-			player.grounded = false;
-			playerRect.x = player.position.x;
-			playerRect.y = player.position.y;
-
-			if (!cheatNoClip) {
-				for (int i = 0; i < MAX_BLOCKS; i++) {
-					if (blocks[i].active && CheckCollisionRecs(playerRect, blocks[i].rect)) {
-						if (player.velocity.y > 0) {
-							player.position.y = blocks[i].rect.y - playerRect.height;
-							player.velocity.y = 0;
-							player.grounded = true;
-						}
-						else if (player.velocity.y < 0) {
-							player.position.y = blocks[i].rect.y + blocks[i].rect.height;
-							player.velocity.y = 0;
-						}
-					}
-				}
-			}
+			ProfilerBegin(ZONE_STREAMING);
+			Vector2 pagerFocus[2] = { sim.cameraTarget, sim.player.position };
+			PagerUpdate(&levelPager, &sim.world, pagerFocus, 2);
+			ProfilerEnd(ZONE_STREAMING);
 
-			if (player.position.y > 2000 && !cheatFly) {
-				if (hasDeathSound) PlaySound(fxDeath);
-				ResetPlayer(&player, blocks[0]);
-				AddConsoleLog("Player died in void");
-			}
+			int ticks = SimClockAdvance(&simClock, GetFrameTime());
+			unsigned int frameEvents = 0;
+			lastTicks = ticks;
 
-			if (currentCameraMode == CAM_SMOOTH && !cheatFly) {
-				camera.target.x += (player.position.x - camera.target.x) * 5.0f * dt;
-				camera.target.y += (player.position.y - camera.target.y) * 5.0f * dt;
-			}
+			for (int t = 0; t < ticks; t++) {
+				input.jumpPressed = jumpLatched;
+				input.resetPressed = resetLatched;
+				jumpLatched = false;
+				resetLatched = false;
 
-			Vector2 mouseWorldPos = GetScreenToWorld2D(GetMousePosition(), camera);
-			int gridX = (int)((mouseWorldPos.x < 0) ? (mouseWorldPos.x - BLOCK_SIZE) : mouseWorldPos.x) / BLOCK_SIZE * BLOCK_SIZE;
-			int gridY = (int)((mouseWorldPos.y < 0) ? (mouseWorldPos.y - BLOCK_SIZE) : mouseWorldPos.y) / BLOCK_SIZE * BLOCK_SIZE;
-			int currentWidth = (selectedShapeIndex == SHAPE_RECT) ? BLOCK_SIZE * 2 : BLOCK_SIZE;
-			potentialBlock = (Rectangle){ (float)gridX, (float)gridY, (float)currentWidth, (float)BLOCK_SIZE };
+				ProfilerBegin(ZONE_PHYSICS);
+				prevPlayerPos = sim.player.position;
+				prevCameraTarget = sim.cameraTarget;
+				if (ReplayIsRecording(&replayRecorder)) ReplayRecordStep(&replayRecorder, &sim, &input, simClock.step);
+				else SimStep(&sim, &input, simClock.step);
+				frameEvents |= sim.events;
 
-			if (!showConsole && !showCheatUI) {
-				if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
-					bool freeSpace = !CheckCollisionRecs(potentialBlock, playerRect);
-					for (int i = 0; i < MAX_BLOCKS; i++) {
-						if (blocks[i].active && CheckCollisionRecs(potentialBlock, blocks[i].rect)) {
-							freeSpace = false; break;
-						}
-					}
-					if (freeSpace) {
-						for (int i = 1; i < MAX_BLOCKS; i++) {
-							if (!blocks[i].active) {
-								blocks[i].active = 1;
-								blocks[i].rect = potentialBlock;
-								blocks[i].color = blockColors[selectedColorIndex];
-								blocks[i].shape = (BlockShape)selectedShapeIndex;
-								break;
-							}
-						}
-					}
+				// Teleports are not interpolated.
+				if (sim.events & (SIM_EVENT_DIED | SIM_EVENT_RESET)) {
+					prevPlayerPos = sim.player.position;
+					prevCameraTarget = sim.cameraTarget;
 				}
+				if (sim.events & SIM_EVENT_RESET) PagerClose(&levelPager);
+				ProfilerEnd(ZONE_PHYSICS);
 
-				if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
-					for (int i = 1; i < MAX_BLOCKS; i++) {
-						if (blocks[i].active && CheckCollisionPointRec(mouseWorldPos, blocks[i].rect)) {
-							blocks[i].active = 0;
-						}
-					}
-				}
+				ProfilerBegin(ZONE_WEATHER);
+				Camera2D weatherCamera = camera;
+				weatherCamera.target = sim.cameraTarget;
+				UpdateWeather(&weatherParticles, currentWeather, weatherCamera, screenWidth, screenHeight, simClock.step);
+				ProfilerEnd(ZONE_WEATHER);
 			}
 
-			UpdateWeather(currentWeather, camera, screenWidth, screenHeight);
+			if ((frameEvents & (SIM_EVENT_DIED | SIM_EVENT_RESET)) && hasDeathSound) PlaySound(fxDeath);
 		}
 
+		float alpha = SimClockAlpha(&simClock);
+		Player drawnPlayer = sim.player;
+		drawnPlayer.position = Vector2Lerp(prevPlayerPos, sim.player.position, alpha);
+		camera.target = Vector2Lerp(prevCameraTarget, sim.cameraTarget, alpha);
+
 		if (IsKeyPressed(KEY_ESCAPE)) break;
 
+		ProfilerBegin(ZONE_WORLD_DRAW);
 		BeginDrawing();
 
 		ClearBackground(isNight ? (Color) { 10, 10, 30, 255 } : SKYBLUE);
@@ -814,39 +657,48 @@ int main(void) {
 		};
 
 		BeginMode2D(camera);
-		for (int i = 0; i < MAX_BLOCKS; i++) {
-			if (blocks[i].active) {
-				if (CheckCollisionRecs(screenView, blocks[i].rect)) {
-					DrawBlockShape(blocks[i]);
-				}
-			}
-		}
+		DrawWorld(&sim.world, screenView);
 
-		DrawPlayer(player, playerColors[playerColorIndex]);
+		DrawPlayer(drawnPlayer, playerColors[playerColorIndex]);
 
-		Texture2D currentGear = gearTextures[currentGearIndex];
-		if (currentGear.id != 0) {
-			float centerX = player.position.x + 20.0f;
+		int currentGear = gearSprites[currentGearIndex];
+		if (AtlasHas(&spriteAtlas, currentGear)) {
+			float centerX = drawnPlayer.position.x + 20.0f;
 			float gearX = centerX;
-			float gearY = player.position.y + 15.0f;
+			float gearY = drawnPlayer.position.y + 15.0f;
 			float rotation = gearAngles[currentGearIndex];
 
-			if (player.facingRight) {
+			if (sim.player.facingRight) {
 				gearX += GEAR_OFFSET_X;
 			}
 			else {
 				gearX -= GEAR_OFFSET_X;
 			}
 
-			Rectangle sourceRec = { 0.0f, 0.0f, (float)currentGear.width, (float)currentGear.height };
-			Rectangle destRec = { gearX, gearY, (float)currentGear.width, (float)currentGear.height };
-			Vector2 origin = { (float)currentGear.width / 2, (float)currentGear.height / 2 };
-			DrawTexturePro(currentGear, sourceRec, destRec, origin, rotation, WHITE);
+			Rectangle sourceRec = AtlasSource(&spriteAtlas, currentGear);
+			Rectangle destRec = { gearX, gearY, sourceRec.width, sourceRec.height };
+			Vector2 origin = { sourceRec.width / 2, sourceRec.height / 2 };
+			DrawTexturePro(spriteAtlas.texture, sourceRec, destRec, origin, rotation, WHITE);
 		}
 
-		DrawWeather(currentWeather);
-		if (!hideUI && !gamePaused) DrawRectangleLinesEx(potentialBlock, 2, WHITE);
+		ProfilerBegin(ZONE_WEATHER);
+		if (AtlasHas(&spriteAtlas, snowSprite)) DrawWeather(&weatherParticles, currentWeather, spriteAtlas.texture, AtlasSource(&spriteAtlas, snowSprite));
+		else DrawWeather(&weatherParticles, currentWeather, (Texture2D){ 0 }, (Rectangle){ 0 });
+		ProfilerEnd(ZONE_WEATHER);
+
+		if (!hideUI && !gamePaused) {
+			if (dragButton != -1) {
+				Rectangle area = CellSpan(dragStart, GetScreenToWorld2D(GetMousePosition(), camera));
+				DrawRectangleLinesEx(area, 2, (dragButton == MOUSE_BUTTON_RIGHT) ? WHITE : RED);
+			}
+			else if (editTool != EDIT_RECT) {
+				DrawRectangleLinesEx(sim.potentialBlock, 2, WHITE);
+			}
+		}
 		EndMode2D();
+		ProfilerEnd(ZONE_WORLD_DRAW);
+
+		ProfilerBegin(ZONE_HUD_DRAW);
 
 		Color cToggleColor = hideUI ? GRAY : WHITE;
 		DrawTextRight("C: UI (Toggle)", 10, 10, cToggleColor, screenWidth);
@@ -854,6 +706,7 @@ int main(void) {
 		if (!hideUI) {
 			Color f1Color = showControls ? GRAY : WHITE;
 			DrawTextRight("F1: Ayuda", 25, 10, f1Color, screenWidth);
+			DrawTextRight(TextFormat("B: %s", editToolNames[editTool]), 40, 10, WHITE, screenWidth);
 
 			if (previewTimer > 0) {
 				int panelSize = 140;
@@ -875,35 +728,50 @@ int main(void) {
 
 				previewBlock.rect = (Rectangle){ centerX, centerY, blockW, blockH };
 
-				DrawBlockShape(previewBlock);
+				DrawBlockShape(&previewBlock);
 				DrawText(shapeNames[selectedShapeIndex], panelX + 10, panelY + panelSize - 20, 10, WHITE);
 			}
 
 			if (showStats) {
+				DrawProfiler(screenWidth - 310, 40);
 				DrawText("Version: 1.2.1 OFFICIAL RELEASE | Release vID 07.01.2026", 10, screenHeight - 60, 20, BLUE);
 				DrawText(TextFormat("Desarrollado por AGUSTINSDFX | Build x86_64 - C - SDFX Engine - OpenGL Version: %s", glText) , 10, screenHeight - 35, 10, BLUE);
 			}
 
 			if (showDebug) {
-				int activeBlocks = 0;
-				for (int i = 1; i < MAX_BLOCKS; i++) if (blocks[i].active) activeBlocks++;
+				int activeBlocks = sim.world.activeCount;
+				if (WorldGet(&sim.world, 0)->active) activeBlocks--;
 
 				DrawText(TextFormat("FPS: %i", GetFPS()), 10, 10, 20, GRAY);
-				DrawText(TextFormat("Pos: [%.1f, %.1f]", player.position.x, player.position.y), 10, 35, 10, GRAY);
+				DrawText(TextFormat("Pos: [%.1f, %.1f]", sim.player.position.x, sim.player.position.y), 10, 35, 10, GRAY);
 				DrawText(TextFormat("Bloques: %i", activeBlocks), 10, 50, 10, GRAY);
 
 				DrawText(TextFormat("Color jug: %s", playerColorNames[playerColorIndex]), 10, 65, 10, GRAY);
 				DrawText(TextFormat("Forma: %s", shapeNames[selectedShapeIndex]), 10, 80, 10, GRAY);
 				DrawText(TextFormat("Color Bloque: %s", blockColorNames[selectedColorIndex]), 10, 95, 10, GRAY);
-				DrawText(TextFormat("Camara: %s", cameraModeNames[currentCameraMode]), 10, 110, 10, GRAY);
+				DrawText(TextFormat("Camara: %s", cameraModeNames[sim.cameraMode]), 10, 110, 10, GRAY);
 
 				DrawText(TextFormat("Tiempo: %s", dayNightNames[isNight ? 1 : 0]), 10, 125, 10, GRAY);
 				DrawText(TextFormat("Clima: %s", weatherNames[currentWeather]), 10, 140, 10, GRAY);
 
-				DrawText(TextFormat("Music [%i/6]: %s", currentSongIndex + 1, songFiles[currentSongIndex]), 10, 155, 10, GRAY);
+				DrawText(TextFormat("Music [%i/%i]: %s", playlist.currentIndex + 1, SONG_COUNT, songFiles[playlist.currentIndex]), 10, 155, 10, GRAY);
 				DrawText(TextFormat("Player.png: %s", hasPlayerTexture ? "YES" : "NO"), 10, 170, 10, hasPlayerTexture ? GRAY : RED);
 				DrawText(TextFormat("Cursor.png: %s", hasCursorTexture ? "YES" : "NO"), 10, 185, 10, hasCursorTexture ? GRAY : RED);
 				DrawText(TextFormat("Gear [%d/7]: gear%d.png", currentGearIndex + 1, currentGearIndex + 1), 10, 200, 10, GRAY);
+
+				RenderStats renderStats = GetRenderStats();
+				DrawText(TextFormat("Chunks: %i/%i (rebuilt %i), %i tris", renderStats.chunksDrawn, renderStats.chunksCached, renderStats.chunksRebuilt, renderStats.trianglesDrawn), 10, 215, 10, GRAY);
+
+				DrawText(TextFormat("Tick: %i Hz (%i this frame)", simClock.tickRate, lastTicks), 10, 230, 10, GRAY);
+
+				if (levelPager.active) {
+					PagerStats pagerStats = GetPagerStats(&levelPager);
+					DrawText(TextFormat("Paging: %i/%i chunks (%i pinned), %.1f/%.0f MB", pagerStats.residentChunks, pagerStats.totalChunks, pagerStats.pinnedChunks, pagerStats.residentMB, pagerStats.budgetMB), 10, 245, 10, GRAY);
+				}
+
+				if (ReplayIsRecording(&replayRecorder)) {
+					DrawText(TextFormat("Replay: recording, %llu ticks", replayRecorder.tick), 10, 260, 10, RED);
+				}
 			}
 		}
 
@@ -927,15 +795,15 @@ int main(void) {
 			}
 
 			int statusX = cx + 10;
-			if (cheatFly) {
+			if (sim.cheatFly) {
 				DrawText("FLY", statusX, cy + 70, 10, YELLOW);
 				statusX += MeasureText("FLY", 10) + 10;
 			}
-			if (cheatInfJump) {
+			if (sim.cheatInfJump) {
 				DrawText("INF JUMP", statusX, cy + 70, 10, YELLOW);
 				statusX += MeasureText("INF JUMP", 10) + 10;
 			}
-			if (cheatNoClip) {
+			if (sim.cheatNoClip) {
 				DrawText("NOCLIP", statusX, cy + 70, 10, YELLOW);
 			}
 
@@ -968,8 +836,7 @@ int main(void) {
 			DrawRectangleLinesEx(btnClear, 1, WHITE);
 			DrawText("CLEAR", (int)btnClear.x + ((btnWidth - textWidthClear) / 2), (int)btnClear.y + 7, 10, WHITE);
 			if (hoverClear && click) {
-				for (int i = 0; i < CONSOLE_HISTORY; i++) memset(consoleLog[i], 0, 128);
-				consoleScroll = 0;
+				ClearConsoleLog();
 			}
 
 			int textWidthHelp = MeasureText("HELP", 10);
@@ -982,12 +849,20 @@ int main(void) {
 				AddConsoleLog("DOCS: https://github.com/agustinsdfx/Platform/blob/main/doc/CONSOLE.md");
 			}
 
+			// New lines snap the view back to the bottom.
+			unsigned long long sequence = GetConsoleSequence();
+			if (sequence != consoleSeen) {
+				consoleSeen = sequence;
+				consoleScroll = 0;
+			}
+
 			int wheel = (int)GetMouseWheelMove();
 			if (wheel != 0) {
 				consoleScroll += wheel;
 			}
 
-			int maxScroll = CONSOLE_HISTORY - CONSOLE_VISIBLE;
+			int maxScroll = GetConsoleLineCount() - CONSOLE_VISIBLE;
+			if (maxScroll < 1) maxScroll = 1;
 			if (consoleScroll < 0) consoleScroll = 0;
 			if (consoleScroll > maxScroll) consoleScroll = maxScroll;
 
@@ -1009,12 +884,11 @@ int main(void) {
 			int textStartY = 40;
 
 			for (int i = 0; i < CONSOLE_VISIBLE; i++) {
-				int lineIndex = (CONSOLE_HISTORY - 1) - consoleScroll - (CONSOLE_VISIBLE - 1 - i);
-
-				if (lineIndex >= 0 && lineIndex < CONSOLE_HISTORY) {
-					if (consoleLog[lineIndex][0] != '\0') {
-						DrawText(consoleLog[lineIndex], 10, textStartY + (i * 20), 10, WHITE);
-					}
+				ConsoleRecord record;
+				if (GetConsoleLine(consoleScroll + (CONSOLE_VISIBLE - 1 - i), &record)) {
+					Color lineColor = (record.level == CONSOLE_ERROR) ? RED : (record.level == CONSOLE_WARNING) ? YELLOW : WHITE;
+					DrawText(TextFormat("%8.2f", record.time), 10, textStartY + (i * 20), 10, GRAY);
+					DrawText(record.text, 70, textStartY + (i * 20), 10, lineColor);
 				}
 			}
 
@@ -1043,45 +917,42 @@ int main(void) {
 
 			int bW = 400;
 			DrawRectangle((screenWidth / 2) - (bW / 2), (screenHeight / 2) + 40, bW, 6, DARKGRAY);
-			DrawRectangle((screenWidth / 2) - (bW / 2), (screenHeight / 2) + 40, (int)(bW * (startTimer / 3.0f)), 6, GREEN);
+			DrawRectangle((screenWidth / 2) - (bW / 2), (screenHeight / 2) + 40, (int)(bW * AssetLoaderProgress(&assets)), 6, GREEN);
 
-			DrawText("Loading textures and sounds...", (screenWidth / 2) - 70, (screenHeight / 2) + 60, 10, GRAY);
+			DrawText(TextFormat("Loading textures and sounds... %d/%d", assets.doneCount, assets.count), (screenWidth / 2) - 70, (screenHeight / 2) + 60, 10, GRAY);
 		}
 
 		if (hasCursorTexture) {
-			DrawTexture(cursorTexture, GetMouseX(), GetMouseY(), WHITE);
+			DrawTextureRec(spriteAtlas.texture, AtlasSource(&spriteAtlas, cursorSprite), (Vector2) { (float)GetMouseX(), (float)GetMouseY() }, WHITE);
 		}
 
-		EndDrawing();
-	}
-
-	if (hasPlayerTexture) {
-		UnloadTexture(playerTexture);
-	}
-
-	if (hasCursorTexture) {
-		UnloadTexture(cursorTexture);
-	}
+		ProfilerEnd(ZONE_HUD_DRAW);
 
-	for (int i = 0; i < NUM_GEARS; i++) {
-		if (gearTextures[i].id != 0) {
-			UnloadTexture(gearTextures[i]);
-		}
+		ProfilerBegin(ZONE_END_DRAWING);
+		EndDrawing();
+		ProfilerEnd(ZONE_END_DRAWING);
 	}
 
-	for (int i = 0; i < NUM_CUSTOM_BLOCKS; i++) {
-		UnloadTexture(customBlockTextures[i]);
-	}
+	AssetLoaderFree(&assets);
+	WatcherFree(&assetWatcher);
+	AtlasFree(&spriteAtlas);
 
 	if (hasDeathSound) {
 		UnloadSound(fxDeath);
 	}
 
-	for (int i = 0; i < SONG_COUNT; i++) {
-		if (songs[i].stream.buffer != NULL) UnloadMusicStream(songs[i]);
-	}
+	PlaylistFree(&playlist);
+	PackClose(&assetPack);
+	FinishLevelJobs();
+	if (ReplayIsRecording(&replayRecorder)) ReplayStopRecording(&replayRecorder, &sim);
+	PagerClose(&levelPager);
+	SimFree(&sim);
+	ParticleSystemFree(&weatherParticles);
+	RenderFree();
+	WeatherRenderFree();
 	CloseAudioDevice();
 	CloseWindow();
+	StopConsoleFileSink();
 
 	return 0;
 }
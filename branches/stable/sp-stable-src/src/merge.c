@@ -0,0 +1,351 @@
+#include "merge.h"
+#include "world.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum { CELL_EMPTY, CELL_CLAIMED, CELL_MERGED };
+
+static void AddLoose(MergedChunk* out, int id) {
+	if (out->looseCount == out->looseCapacity) {
+		out->looseCapacity = (out->looseCapacity > 0) ? out->looseCapacity * 2 : 64;
+		out->loose = realloc(out->loose, (size_t)out->looseCapacity * sizeof(int));
+	}
+	out->loose[out->looseCount++] = id;
+}
+
+// Cells a block covers if it is a plain square or two-cell rectangle lying
+// exactly on cell (x, y) and inside the chunk; 0 otherwise.
+static int PlainCells(const Block* b, int x, int y, int lx) {
+	if (b->rect.x != (float)(x * BLOCK_SIZE) || b->rect.y != (float)(y * BLOCK_SIZE) || b->rect.height != (float)BLOCK_SIZE) return 0;
+	if (b->shape == SHAPE_SQUARE && b->rect.width == (float)BLOCK_SIZE) return 1;
+	if (b->shape == SHAPE_RECT && b->rect.width == (float)(2 * BLOCK_SIZE) && lx + 1 < GRID_CHUNK_CELLS) return 2;
+	return 0;
+}
+
+static bool SameColor(Color a, Color b) {
+	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+void MergeChunk(MergedChunk* out, const World* world, const GridChunk* chunk) {
+	const SpatialGrid* grid = &world->grid;
+	unsigned char state[GRID_CHUNK_AREA];
+	Color color[GRID_CHUNK_AREA];
+	int baseX = chunk->cx * GRID_CHUNK_CELLS;
+	int baseY = chunk->cy * GRID_CHUNK_CELLS;
+
+	out->rectCount = 0;
+	out->looseCount = 0;
+	memset(state, CELL_EMPTY, sizeof(state));
+
+	// Cells are claimed in cell order. A cell anchoring more than one block
+	// keeps all of them loose, so the result never depends on the order the
+	// blocks were linked in.
+	for (int i = 0; i < GRID_CHUNK_AREA; i++) {
+		int lx = i % GRID_CHUNK_CELLS;
+		int x = baseX + lx;
+		int y = baseY + i / GRID_CHUNK_CELLS;
+
+		int anchored = 0;
+		int id = -1;
+		for (int e = chunk->cellHead[i]; e != -1; e = grid->entries[e].next) {
+			if (!GridIsAnchor(&grid->entries[e], x, y)) continue;
+			anchored++;
+			id = grid->entries[e].id;
+		}
+		if (anchored == 0) continue;
+
+		const Block* b = WorldGet(world, id);
+		int cells = (anchored == 1) ? PlainCells(b, x, y, lx) : 0;
+		if (cells > 0 && state[i] == CELL_EMPTY && (cells == 1 || state[i + 1] == CELL_EMPTY)) {
+			for (int c = 0; c < cells; c++) {
+				state[i + c] = CELL_CLAIMED;
+				color[i + c] = b->color;
+			}
+			continue;
+		}
+
+		for (int e = chunk->cellHead[i]; e != -1; e = grid->entries[e].next) {
+			if (GridIsAnchor(&grid->entries[e], x, y)) AddLoose(out, grid->entries[e].id);
+		}
+	}
+
+	for (int y = 0; y < GRID_CHUNK_CELLS; y++) {
+		for (int x = 0; x < GRID_CHUNK_CELLS; x++) {
+			int i = y * GRID_CHUNK_CELLS + x;
+			if (state[i] != CELL_CLAIMED) continue;
+			Color c = color[i];
+
+			int w = 1;
+			while (x + w < GRID_CHUNK_CELLS && state[i + w] == CELL_CLAIMED && SameColor(color[i + w], c)) w++;
+
+			int h = 1;
+			while (y + h < GRID_CHUNK_CELLS) {
+				int row = i + h * GRID_CHUNK_CELLS;
+				bool match = true;
+				for (int k = 0; k < w && match; k++) match = state[row + k] == CELL_CLAIMED && SameColor(color[row + k], c);
+				if (!match) break;
+				h++;
+			}
+
+			for (int dy = 0; dy < h; dy++) memset(&state[i + dy * GRID_CHUNK_CELLS], CELL_MERGED, (size_t)w);
+
+			MergedRect* r = &out->rects[out->rectCount++];
+			r->rect = (Rectangle){ (float)((baseX + x) * BLOCK_SIZE), (float)((baseY + y) * BLOCK_SIZE), (float)(w * BLOCK_SIZE), (float)(h * BLOCK_SIZE) };
+			r->color = c;
+		}
+	}
+}
+
+void MergedChunkFree(MergedChunk* merged) {
+	free(merged->loose);
+	merged->loose = NULL;
+	merged->looseCount = 0;
+	merged->looseCapacity = 0;
+}
+
+// Solid set ------------------------------------------------------------------
+
+static unsigned int ChunkHash(int cx, int cy) {
+	unsigned int h = (unsigned int)cx * 0x9E3779B1u ^ (unsigned int)cy * 0x85EBCA77u;
+	return h ^ (h >> 16);
+}
+
+static SolidChunk* FindSolidChunk(const SolidSet* set, int cx, int cy) {
+	if (set->chunkCapacity == 0) return NULL;
+
+	unsigned int mask = (unsigned int)set->chunkCapacity - 1;
+	unsigned int slot = ChunkHash(cx, cy) & mask;
+	while (set->chunks[slot].used) {
+		SolidChunk* chunk = &set->chunks[slot];
+		if (chunk->cx == cx && chunk->cy == cy) return chunk;
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+
+static void PutSolidChunk(SolidChunk* table, int capacity, const SolidChunk* chunk) {
+	unsigned int mask = (unsigned int)capacity - 1;
+	unsigned int slot = ChunkHash(chunk->cx, chunk->cy) & mask;
+	while (table[slot].used) slot = (slot + 1) & mask;
+	table[slot] = *chunk;
+}
+
+static void ResizeSolidChunks(SolidSet* set, int newCapacity) {
+	SolidChunk* table = calloc((size_t)newCapacity, sizeof(SolidChunk));
+	for (int i = 0; i < set->chunkCapacity; i++) {
+		if (set->chunks[i].used) PutSolidChunk(table, newCapacity, &set->chunks[i]);
+	}
+	free(set->chunks);
+	set->chunks = table;
+	set->chunkCapacity = newCapacity;
+}
+
+static SolidChunk* GetSolidChunk(SolidSet* set, int cx, int cy) {
+	SolidChunk* chunk = FindSolidChunk(set, cx, cy);
+	if (chunk != NULL) return chunk;
+
+	if ((set->chunkCount + 1) * 2 > set->chunkCapacity) {
+		ResizeSolidChunks(set, (set->chunkCapacity > 0) ? set->chunkCapacity * 2 : 64);
+	}
+
+	SolidChunk fresh = { cx, cy, true, false, -1 };
+	PutSolidChunk(set->chunks, set->chunkCapacity, &fresh);
+	set->chunkCount++;
+	return FindSolidChunk(set, cx, cy);
+}
+
+// Same backward shift as the grid's chunk table.
+static void DropSolidChunk(SolidSet* set, SolidChunk* chunk) {
+	unsigned int mask = (unsigned int)set->chunkCapacity - 1;
+	unsigned int hole = (unsigned int)(chunk - set->chunks);
+
+	for (unsigned int next = (hole + 1) & mask; set->chunks[next].used; next = (next + 1) & mask) {
+		unsigned int home = ChunkHash(set->chunks[next].cx, set->chunks[next].cy) & mask;
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			set->chunks[hole] = set->chunks[next];
+			hole = next;
+		}
+	}
+	set->chunks[hole].used = false;
+	set->chunkCount--;
+
+	if (set->chunkCapacity > 64 && set->chunkCount * 8 < set->chunkCapacity) ResizeSolidChunks(set, set->chunkCapacity / 2);
+}
+
+static void AddSolid(SolidSet* set, SolidChunk* owner, Rectangle rect) {
+	if (set->solidFree == -1) {
+		int oldCapacity = set->solidCapacity;
+		int newCapacity = (oldCapacity > 0) ? oldCapacity * 2 : 256;
+		set->solids = realloc(set->solids, (size_t)newCapacity * sizeof(Solid));
+		for (int i = oldCapacity; i < newCapacity; i++) set->solids[i].next = (i + 1 < newCapacity) ? i + 1 : -1;
+		set->solidFree = oldCapacity;
+		set->solidCapacity = newCapacity;
+	}
+
+	int id = set->solidFree;
+	set->solidFree = set->solids[id].next;
+	set->solidCount++;
+	set->solids[id].rect = rect;
+	set->solids[id].next = owner->head;
+	owner->head = id;
+	GridInsert(&set->grid, id, rect);
+}
+
+static void DropSolids(SolidSet* set, SolidChunk* owner) {
+	int id = owner->head;
+	while (id != -1) {
+		int next = set->solids[id].next;
+		int cx, cy;
+		GridRemove(&set->grid, id, set->solids[id].rect, &cx, &cy);
+		set->solids[id].next = set->solidFree;
+		set->solidFree = id;
+		set->solidCount--;
+		id = next;
+	}
+	owner->head = -1;
+}
+
+static void Sync(SolidSet* set, const World* world) {
+	if (set->rebuildAll) {
+		set->rebuildAll = false;
+		for (int i = 0; i < world->grid.chunkCapacity; i++) {
+			const GridChunk* chunk = world->grid.chunks[i];
+			if (chunk != NULL && chunk->anchorCount > 0) SolidSetTouch(set, chunk->cx, chunk->cy);
+		}
+	}
+
+	for (int q = 0; q < set->queueCount; q++) {
+		int cx = set->queue[q * 2];
+		int cy = set->queue[q * 2 + 1];
+		SolidChunk* owner = FindSolidChunk(set, cx, cy);
+		owner->queued = false;
+		DropSolids(set, owner);
+
+		const GridChunk* chunk = GridFindChunk(&world->grid, cx, cy);
+		if (chunk == NULL || chunk->anchorCount == 0) {
+			DropSolidChunk(set, owner);
+			continue;
+		}
+
+		MergeChunk(&set->scratch, world, chunk);
+		for (int i = 0; i < set->scratch.rectCount; i++) AddSolid(set, owner, set->scratch.rects[i].rect);
+		for (int i = 0; i < set->scratch.looseCount; i++) AddSolid(set, owner, WorldGet(world, set->scratch.loose[i])->rect);
+	}
+	set->queueCount = 0;
+
+	// Solids are referenced by index from the grid and the chunk lists, so
+	// once most of the array is free it is cheaper to merge again into a
+	// fresh one than to renumber them.
+	if (set->solidCapacity > 256 && set->solidCount * 4 < set->solidCapacity) {
+		SolidSetClear(set);
+		free(set->solids);
+		set->solids = NULL;
+		set->solidCapacity = 0;
+		set->solidFree = -1;
+		set->rebuildAll = true;
+		Sync(set, world);
+	}
+}
+
+void SolidSetInit(SolidSet* set) {
+	memset(set, 0, sizeof(SolidSet));
+	GridInit(&set->grid);
+	set->solidFree = -1;
+}
+
+void SolidSetFree(SolidSet* set) {
+	GridFree(&set->grid);
+	free(set->solids);
+	free(set->chunks);
+	free(set->queue);
+	free(set->hits);
+	free(set->rects);
+	MergedChunkFree(&set->scratch);
+	SolidSetInit(set);
+}
+
+void SolidSetClear(SolidSet* set) {
+	GridClear(&set->grid);
+	for (int i = 0; i < set->solidCapacity; i++) set->solids[i].next = (i + 1 < set->solidCapacity) ? i + 1 : -1;
+	set->solidFree = (set->solidCapacity > 0) ? 0 : -1;
+	set->solidCount = 0;
+	if (set->chunkCapacity > 0) memset(set->chunks, 0, (size_t)set->chunkCapacity * sizeof(SolidChunk));
+	set->chunkCount = 0;
+	set->queueCount = 0;
+	set->rebuildAll = false;
+}
+
+void SolidSetTouch(SolidSet* set, int cx, int cy) {
+	SolidChunk* chunk = GetSolidChunk(set, cx, cy);
+	if (chunk->queued) return;
+	chunk->queued = true;
+
+	if (set->queueCount == set->queueCapacity) {
+		set->queueCapacity = (set->queueCapacity > 0) ? set->queueCapacity * 2 : 64;
+		set->queue = realloc(set->queue, (size_t)set->queueCapacity * 2 * sizeof(int));
+	}
+	set->queue[set->queueCount * 2] = cx;
+	set->queue[set->queueCount * 2 + 1] = cy;
+	set->queueCount++;
+}
+
+size_t SolidSetBytes(const SolidSet* set) {
+	return GridBytes(&set->grid) +
+		(size_t)set->solidCapacity * sizeof(Solid) +
+		(size_t)set->chunkCapacity * sizeof(SolidChunk) +
+		(size_t)set->queueCapacity * 2 * sizeof(int) +
+		(size_t)set->hitCapacity * (sizeof(int) + sizeof(Rectangle)) +
+		(size_t)set->scratch.looseCapacity * sizeof(int);
+}
+
+void SolidSetInvalidate(SolidSet* set) {
+	SolidSetClear(set);
+	set->rebuildAll = true;
+}
+
+static int CompareRects(const void* a, const void* b) {
+	const Rectangle* r = a;
+	const Rectangle* s = b;
+	if (r->y != s->y) return (r->y > s->y) - (r->y < s->y);
+	if (r->x != s->x) return (r->x > s->x) - (r->x < s->x);
+	if (r->height != s->height) return (r->height > s->height) - (r->height < s->height);
+	return (r->width > s->width) - (r->width < s->width);
+}
+
+int SolidSetQuery(SolidSet* set, const World* world, Rectangle area, const Rectangle** rects) {
+	if (set->rebuildAll || set->queueCount > 0) Sync(set, world);
+
+	if (set->hitCapacity == 0) {
+		set->hitCapacity = 64;
+		set->hits = malloc((size_t)set->hitCapacity * sizeof(int));
+		set->rects = malloc((size_t)set->hitCapacity * sizeof(Rectangle));
+	}
+
+	int count = GridQuery(&set->grid, area, set->hits, set->hitCapacity);
+	while (count == set->hitCapacity) {
+		set->hitCapacity *= 2;
+		set->hits = realloc(set->hits, (size_t)set->hitCapacity * sizeof(int));
+		set->rects = realloc(set->rects, (size_t)set->hitCapacity * sizeof(Rectangle));
+		count = GridQuery(&set->grid, area, set->hits, set->hitCapacity);
+	}
+
+	Rectangle* out = set->rects;
+	for (int i = 0; i < count; i++) out[i] = set->solids[set->hits[i]].rect;
+	if (count > 16) {
+		qsort(out, (size_t)count, sizeof(Rectangle), CompareRects);
+	}
+	else {
+		for (int i = 1; i < count; i++) {
+			Rectangle v = out[i];
+			int j = i - 1;
+			while (j >= 0 && CompareRects(&out[j], &v) > 0) {
+				out[j + 1] = out[j];
+				j--;
+			}
+			out[j + 1] = v;
+		}
+	}
+
+	*rects = set->rects;
+	return count;
+}
@@ -0,0 +1,91 @@
+#ifndef MERGE_H
+#define MERGE_H
+
+#include "game.h"
+#include "grid.h"
+
+struct World;
+
+// Greedy merging of plain blocks. Within one grid chunk, squares and
+// two-cell rectangles that sit on the grid are grouped by colour. Each group
+// becomes a few large rectangles: the longest run along a row, grown
+// downwards while the rows below match. Blocks stay one per cell in the
+// world; only what is drawn and collided with is merged. Everything else
+// anchored in the chunk (other shapes, blocks off the grid or sticking out
+// of the chunk, cells holding more than one block) is left loose.
+
+typedef struct {
+	Rectangle rect;
+	Color color;
+} MergedRect;
+
+typedef struct {
+	MergedRect rects[GRID_CHUNK_AREA];
+	int rectCount;
+	int* loose;
+	int looseCount;
+	int looseCapacity;
+} MergedChunk;
+
+// Reuses out's loose array between calls.
+void MergeChunk(MergedChunk* out, const struct World* world, const GridChunk* chunk);
+void MergedChunkFree(MergedChunk* merged);
+
+// The collision view of a world: the merged rectangles of every chunk plus
+// the loose blocks, in a spatial grid of their own. A chunk whose blocks
+// change is queued and merged again before the next query, so an edit only
+// costs its own chunk.
+
+typedef struct {
+	Rectangle rect;
+	int next;
+} Solid;
+
+typedef struct {
+	int cx;
+	int cy;
+	bool used;
+	bool queued;
+	int head;
+} SolidChunk;
+
+typedef struct {
+	SpatialGrid grid;
+
+	Solid* solids;
+	int solidCapacity;
+	int solidCount;
+	int solidFree;
+
+	SolidChunk* chunks;
+	int chunkCapacity;
+	int chunkCount;
+
+	int* queue;
+	int queueCount;
+	int queueCapacity;
+	bool rebuildAll;
+
+	MergedChunk scratch;
+	int* hits;
+	Rectangle* rects;
+	int hitCapacity;
+} SolidSet;
+
+void SolidSetInit(SolidSet* set);
+void SolidSetFree(SolidSet* set);
+// Drops every solid; the world's chunks are queued again as blocks arrive.
+void SolidSetClear(SolidSet* set);
+// Queues the chunk with grid coordinates cx, cy.
+void SolidSetTouch(SolidSet* set, int cx, int cy);
+// Forgets everything and merges every chunk of the world on the next query.
+void SolidSetInvalidate(SolidSet* set);
+// Heap memory the set holds.
+size_t SolidSetBytes(const SolidSet* set);
+
+// Rectangles overlapping area, ordered by position so the result does not
+// depend on the order the world was edited in. The array belongs to the set
+// and is overwritten by the next query.
+int SolidSetQuery(SolidSet* set, const struct World* world, Rectangle area, const Rectangle** rects);
+
+#endif
@@ -0,0 +1,115 @@
+#include "music.h"
+#include "console.h"
+#include <string.h>
+#include <time.h>
+
+static double NowSeconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static Music OpenTrack(const Playlist* playlist, int index) {
+	const char* fileName = playlist->files[index];
+	int size = 0;
+	const unsigned char* data = (playlist->pack != NULL) ? PackFind(playlist->pack, fileName, &size) : NULL;
+
+	Music music = { 0 };
+	if (data != NULL) music = LoadMusicStreamFromMemory(GetFileExtension(fileName), data, size);
+	else if (FileExists(fileName)) music = LoadMusicStream(fileName);
+	else AddConsoleLogf(CONSOLE_WARNING, "Music: %s not found", fileName);
+
+	music.looping = true;
+	return music;
+}
+
+static void* PrefetchThread(void* arg) {
+	Playlist* playlist = arg;
+	double t0 = NowSeconds();
+	playlist->next = OpenTrack(playlist, playlist->nextIndex);
+	playlist->nextSeconds = NowSeconds() - t0;
+	atomic_store(&playlist->nextReady, true);
+	return NULL;
+}
+
+static void StartPrefetch(Playlist* playlist) {
+	if (playlist->prefetching || playlist->count < 2) return;
+
+	playlist->nextIndex = (playlist->currentIndex + 1) % playlist->count;
+	atomic_store(&playlist->nextReady, false);
+	playlist->prefetching = true;
+	if (pthread_create(&playlist->thread, NULL, PrefetchThread, playlist) != 0) {
+		playlist->prefetching = false;
+		PrefetchThread(playlist);
+	}
+}
+
+// Stops the prefetch thread, if any, and returns whether a track is waiting
+// in next.
+static bool FinishPrefetch(Playlist* playlist) {
+	if (playlist->prefetching) {
+		pthread_join(playlist->thread, NULL);
+		playlist->prefetching = false;
+	}
+	return atomic_load(&playlist->nextReady);
+}
+
+static void CloseTrack(Music* music) {
+	if (music->stream.buffer != NULL) {
+		StopMusicStream(*music);
+		UnloadMusicStream(*music);
+	}
+	memset(music, 0, sizeof(*music));
+}
+
+void PlaylistInit(Playlist* playlist, const char* const* files, int count, const AssetPack* pack) {
+	memset(playlist, 0, sizeof(*playlist));
+	playlist->files = files;
+	playlist->count = count;
+	playlist->pack = pack;
+	atomic_init(&playlist->nextReady, false);
+}
+
+void PlaylistPlay(Playlist* playlist, Music first, int index) {
+	CloseTrack(&playlist->current);
+	playlist->current = first;
+	playlist->current.looping = true;
+	playlist->currentIndex = index;
+	if (playlist->current.stream.buffer != NULL) PlayMusicStream(playlist->current);
+	StartPrefetch(playlist);
+}
+
+void PlaylistUpdate(Playlist* playlist) {
+	if (playlist->switchPending && atomic_load(&playlist->nextReady)) {
+		FinishPrefetch(playlist);
+		CloseTrack(&playlist->current);
+
+		playlist->current = playlist->next;
+		playlist->currentIndex = playlist->nextIndex;
+		memset(&playlist->next, 0, sizeof(playlist->next));
+		atomic_store(&playlist->nextReady, false);
+		playlist->switchPending = false;
+
+		if (playlist->current.stream.buffer != NULL) {
+			PlayMusicStream(playlist->current);
+			AddConsoleLogf(CONSOLE_INFO, "Music changed to: %s (opened in %.1f ms ahead)", playlist->files[playlist->currentIndex], playlist->nextSeconds * 1000.0);
+		}
+		else {
+			AddConsoleLogf(CONSOLE_WARNING, "Music: %s could not be opened", playlist->files[playlist->currentIndex]);
+		}
+		StartPrefetch(playlist);
+	}
+
+	if (playlist->current.stream.buffer != NULL) UpdateMusicStream(playlist->current);
+}
+
+void PlaylistNext(Playlist* playlist) {
+	if (playlist->count < 2) return;
+	playlist->switchPending = true;
+	StartPrefetch(playlist);
+}
+
+void PlaylistFree(Playlist* playlist) {
+	if (FinishPrefetch(playlist)) CloseTrack(&playlist->next);
+	CloseTrack(&playlist->current);
+}
@@ -0,0 +1,45 @@
+#ifndef MUSIC_H
+#define MUSIC_H
+
+#include "raylib.h"
+#include "pack.h"
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// The song list. Only the playing track has an open stream; the track after
+// it is opened on a worker thread while the current one plays, so skipping
+// to it costs no decoder setup on the main thread. A track is closed as
+// soon as it stops playing.
+
+typedef struct {
+	const char* const* files;
+	int count;
+	const AssetPack* pack;
+
+	Music current;
+	int currentIndex;
+
+	pthread_t thread;
+	bool prefetching;
+	int nextIndex;
+	Music next;
+	double nextSeconds;
+	atomic_bool nextReady;
+	bool switchPending;
+} Playlist;
+
+// files must outlive the playlist. pack may be NULL; tracks it has are
+// streamed from its mapping.
+void PlaylistInit(Playlist* playlist, const char* const* files, int count, const AssetPack* pack);
+// Starts playing track index from first, which may already be open (or
+// empty if it failed), and prefetches the next one.
+void PlaylistPlay(Playlist* playlist, Music first, int index);
+// Feeds the playing stream and carries out a pending skip once the next
+// track is open. Call once per frame.
+void PlaylistUpdate(Playlist* playlist);
+// Skips to the next track, at once if it is prefetched already.
+void PlaylistNext(Playlist* playlist);
+void PlaylistFree(Playlist* playlist);
+
+#endif
@@ -0,0 +1,173 @@
+#include "pack.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static unsigned long long GetUInt(const unsigned char* p, int size) {
+	unsigned long long v = 0;
+	for (int i = size - 1; i >= 0; i--) v = (v << 8) | p[i];
+	return v;
+}
+
+static void PutUInt(unsigned char* p, unsigned long long v, int size) {
+	for (int i = 0; i < size; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static const unsigned char* EntryAt(const AssetPack* pack, int i) {
+	return pack->base + PACK_HEADER_SIZE + (size_t)i * PACK_ENTRY_SIZE;
+}
+
+static bool CheckDirectory(const unsigned char* base, size_t size, int count) {
+	for (int i = 0; i < count; i++) {
+		const unsigned char* entry = base + PACK_HEADER_SIZE + (size_t)i * PACK_ENTRY_SIZE;
+		if (memchr(entry, 0, PACK_NAME_SIZE) == NULL) return false;
+		if (i > 0 && strcmp((const char*)entry - PACK_ENTRY_SIZE, (const char*)entry) >= 0) return false;
+
+		unsigned long long offset = GetUInt(entry + PACK_NAME_SIZE, 8);
+		unsigned long long length = GetUInt(entry + PACK_NAME_SIZE + 8, 8);
+		if (offset > size || length > size - offset || length > INT_MAX) return false;
+	}
+	return true;
+}
+
+bool PackOpen(AssetPack* pack, const char* fileName) {
+	memset(pack, 0, sizeof(*pack));
+
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < PACK_HEADER_SIZE) {
+		close(fd);
+		return false;
+	}
+
+	void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) return false;
+
+	const unsigned char* p = base;
+	size_t size = (size_t)st.st_size;
+	unsigned long long count = GetUInt(p + 8, 4);
+	bool valid = memcmp(p, PACK_MAGIC, 4) == 0 && GetUInt(p + 4, 2) == PACK_VERSION &&
+		count <= (size - PACK_HEADER_SIZE) / PACK_ENTRY_SIZE && CheckDirectory(p, size, (int)count);
+	if (!valid) {
+		munmap(base, size);
+		return false;
+	}
+
+	// Everything in the pack is read during startup, so start reading it all
+	// in now rather than one fault at a time.
+	madvise(base, size, MADV_WILLNEED);
+
+	pack->base = p;
+	pack->size = size;
+	pack->count = (int)count;
+	return true;
+}
+
+void PackClose(AssetPack* pack) {
+	if (pack->base != NULL) munmap((void*)pack->base, pack->size);
+	memset(pack, 0, sizeof(*pack));
+}
+
+const unsigned char* PackFind(const AssetPack* pack, const char* name, int* size) {
+	int lo = 0, hi = pack->count - 1;
+	while (lo <= hi) {
+		int mid = lo + (hi - lo) / 2;
+		const unsigned char* entry = EntryAt(pack, mid);
+		int c = strcmp(name, (const char*)entry);
+		if (c == 0) {
+			if (size != NULL) *size = (int)GetUInt(entry + PACK_NAME_SIZE + 8, 8);
+			return pack->base + GetUInt(entry + PACK_NAME_SIZE, 8);
+		}
+		if (c < 0) hi = mid - 1;
+		else lo = mid + 1;
+	}
+	return NULL;
+}
+
+static int ComparePaths(const void* a, const void* b) {
+	return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+static unsigned long long AlignUp(unsigned long long v) {
+	return (v + PACK_ALIGN - 1) / PACK_ALIGN * PACK_ALIGN;
+}
+
+static bool CopyFile(FILE* out, const char* path, unsigned long long size) {
+	FILE* in = fopen(path, "rb");
+	if (in == NULL) return false;
+
+	unsigned char buffer[65536];
+	unsigned long long copied = 0;
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+		if (fwrite(buffer, 1, n, out) != n) break;
+		copied += n;
+	}
+	fclose(in);
+	return copied == size;
+}
+
+bool PackWrite(const char* fileName, const char* const* paths, int count) {
+	const char** sorted = malloc((size_t)(count > 0 ? count : 1) * sizeof(char*));
+	unsigned long long* sizes = malloc((size_t)(count > 0 ? count : 1) * sizeof(unsigned long long));
+	memcpy(sorted, paths, (size_t)count * sizeof(char*));
+	qsort(sorted, (size_t)count, sizeof(char*), ComparePaths);
+
+	bool ok = true;
+	for (int i = 0; i < count && ok; i++) {
+		struct stat st;
+		ok = strlen(sorted[i]) < PACK_NAME_SIZE && (i == 0 || strcmp(sorted[i - 1], sorted[i]) != 0) &&
+			stat(sorted[i], &st) == 0 && S_ISREG(st.st_mode) && st.st_size <= INT_MAX;
+		if (ok) sizes[i] = (unsigned long long)st.st_size;
+	}
+
+	// Written next to the old pack and renamed over it, so a game starting
+	// meanwhile never maps half a file.
+	char tempName[4096];
+	snprintf(tempName, sizeof(tempName), "%s.tmp", fileName);
+	FILE* out = ok ? fopen(tempName, "wb") : NULL;
+	if (out != NULL) {
+		unsigned char header[PACK_HEADER_SIZE];
+		memcpy(header, PACK_MAGIC, 4);
+		PutUInt(header + 4, PACK_VERSION, 2);
+		PutUInt(header + 6, 0, 2);
+		PutUInt(header + 8, (unsigned long long)count, 4);
+		fwrite(header, 1, sizeof(header), out);
+
+		unsigned long long offset = AlignUp(PACK_HEADER_SIZE + (unsigned long long)count * PACK_ENTRY_SIZE);
+		for (int i = 0; i < count; i++) {
+			unsigned char entry[PACK_ENTRY_SIZE] = { 0 };
+			memcpy(entry, sorted[i], strlen(sorted[i]));
+			PutUInt(entry + PACK_NAME_SIZE, offset, 8);
+			PutUInt(entry + PACK_NAME_SIZE + 8, sizes[i], 8);
+			fwrite(entry, 1, sizeof(entry), out);
+			offset = AlignUp(offset + sizes[i]);
+		}
+
+		static const unsigned char zeros[PACK_ALIGN] = { 0 };
+		for (int i = 0; i < count && ok; i++) {
+			long position = ftell(out);
+			fwrite(zeros, 1, (size_t)(AlignUp((unsigned long long)position) - (unsigned long long)position), out);
+			ok = CopyFile(out, sorted[i], sizes[i]);
+		}
+
+		ok = (fclose(out) == 0) && ok;
+		if (ok) ok = rename(tempName, fileName) == 0;
+		if (!ok) remove(tempName);
+	}
+	else {
+		ok = false;
+	}
+
+	free(sizes);
+	free(sorted);
+	return ok;
+}
@@ -0,0 +1,45 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Asset pack: every startup file in one archive that the game maps at once.
+//
+//   header   "SPAK", u16 version, u16 flags, u32 entry count
+//   entries  per file: name padded with zeros to PACK_NAME_SIZE, u64 offset, u64 size
+//   blobs    the file contents, each starting on a PACK_ALIGN boundary
+//
+// Entries are sorted by name so a lookup is a binary search of the mapped
+// directory. Names are the paths the game asks for, such as
+// "images/player.png". Integers are little endian.
+
+#define PACK_MAGIC "SPAK"
+#define PACK_VERSION 1
+#define PACK_NAME_SIZE 112
+#define PACK_ALIGN 64
+#define PACK_HEADER_SIZE 12
+#define PACK_ENTRY_SIZE (PACK_NAME_SIZE + 16)
+#define PACK_DEFAULT_FILE "assets.pak"
+
+typedef struct {
+	const unsigned char* base;
+	size_t size;
+	int count;
+} AssetPack;
+
+// Maps fileName and checks its directory. Returns false, leaving the pack
+// empty, if the file is missing or not a valid pack.
+bool PackOpen(AssetPack* pack, const char* fileName);
+void PackClose(AssetPack* pack);
+
+// Contents of the entry called name, or NULL if the pack does not have it.
+// The memory stays valid until PackClose.
+const unsigned char* PackFind(const AssetPack* pack, const char* name, int* size);
+
+// Writes the files in paths into a new pack at fileName, each stored under
+// its path as given. Returns false if a file cannot be read or a path is
+// too long for an entry name.
+bool PackWrite(const char* fileName, const char* const* paths, int count);
+
+#endif
@@ -0,0 +1,305 @@
+#include "pager.h"
+#include "console.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static unsigned int PagerHash(int cx, int cy) {
+	unsigned int h = (unsigned int)cx * 0x9E3779B1u ^ (unsigned int)cy * 0x85EBCA77u;
+	return h ^ (h >> 16);
+}
+
+static int FindChunk(const LevelPager* pager, int cx, int cy) {
+	unsigned int mask = (unsigned int)pager->tableCapacity - 1;
+	unsigned int slot = PagerHash(cx, cy) & mask;
+	while (pager->table[slot] != -1) {
+		const LevelChunkRef* ref = &pager->index.chunks[pager->table[slot]];
+		if (ref->cx == cx && ref->cy == cy) return pager->table[slot];
+		slot = (slot + 1) & mask;
+	}
+	return -1;
+}
+
+static void ReleaseMapping(LevelMapping* mapping) {
+	if (mapping == NULL) return;
+	if (atomic_fetch_sub(&mapping->refs, 1) == 1) {
+		munmap(mapping->base, mapping->size);
+		free(mapping);
+	}
+}
+
+static LevelMapping* MapFile(const char* fileName) {
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) return NULL;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < 16) {
+		close(fd);
+		return NULL;
+	}
+
+	void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) return NULL;
+
+	// Chunks are read in whatever order the player walks, not front to back.
+	madvise(base, (size_t)st.st_size, MADV_RANDOM);
+
+	LevelMapping* mapping = malloc(sizeof(LevelMapping));
+	mapping->base = base;
+	mapping->size = (size_t)st.st_size;
+	atomic_init(&mapping->refs, 1);
+	return mapping;
+}
+
+static bool IsEdited(const LevelPager* pager, const World* world, int i) {
+	const LevelChunkRef* ref = &pager->index.chunks[i];
+	const GridChunk* chunk = GridFindChunk(&world->grid, ref->cx, ref->cy);
+	return chunk == NULL || chunk->revision != pager->chunks[i].revision;
+}
+
+static void PageIn(LevelPager* pager, World* world, int i) {
+	const LevelChunkRef* ref = &pager->index.chunks[i];
+	PagedChunk* pc = &pager->chunks[i];
+
+	// Blocks the player placed here before the chunk arrived would otherwise
+	// look like part of it, so such a chunk never leaves again.
+	const GridChunk* before = GridFindChunk(&world->grid, ref->cx, ref->cy);
+	bool occupied = before != NULL && before->anchorCount > 0;
+
+	pc->ids = malloc((size_t)(ref->blocks > 0 ? ref->blocks : 1) * sizeof(int));
+	for (int k = 0; k < ref->blocks; k++) pc->ids[k] = -1;
+
+	if (!LevelDecodeChunk(ref, pager->index.palette, pager->index.paletteCount, world, pc->ids)) {
+		for (int k = 0; k < ref->blocks; k++) {
+			if (pc->ids[k] != -1) WorldRemove(world, pc->ids[k]);
+		}
+		free(pc->ids);
+		pc->ids = NULL;
+		pc->failed = true;
+		AddConsoleLogf(CONSOLE_WARNING, "Paging: chunk %d,%d is corrupt, skipped", ref->cx, ref->cy);
+		return;
+	}
+
+	const GridChunk* after = GridFindChunk(&world->grid, ref->cx, ref->cy);
+	pc->revision = (after != NULL) ? after->revision : 0;
+	pc->resident = true;
+	pc->pinned = occupied;
+	pc->residentSlot = pager->residentCount;
+	pager->resident[pager->residentCount++] = i;
+	pager->residentBlocks += ref->blocks;
+	pager->idBytes += (long long)ref->blocks * (long long)sizeof(int);
+}
+
+static void Evict(LevelPager* pager, World* world, int i) {
+	PagedChunk* pc = &pager->chunks[i];
+	const LevelChunkRef* ref = &pager->index.chunks[i];
+
+	for (int k = 0; k < ref->blocks; k++) WorldRemove(world, pc->ids[k]);
+	free(pc->ids);
+	pc->ids = NULL;
+	pc->resident = false;
+
+	int last = pager->resident[--pager->residentCount];
+	pager->resident[pc->residentSlot] = last;
+	pager->chunks[last].residentSlot = pc->residentSlot;
+	pager->residentBlocks -= ref->blocks;
+	pager->idBytes -= (long long)ref->blocks * (long long)sizeof(int);
+}
+
+// What the world and the pager's own id lists really hold. Blocks, grid
+// chunks and grid entries are all given back as chunks are evicted, so this
+// falls with every eviction rather than staying at the peak.
+static long long ResidentBytes(const LevelPager* pager, const World* world) {
+	return (long long)WorldBytes(world) + pager->idBytes;
+}
+
+static const LevelPager* sortPager = NULL;
+
+static int CompareLastUsed(const void* a, const void* b) {
+	unsigned int ua = sortPager->chunks[*(const int*)a].lastUsed;
+	unsigned int ub = sortPager->chunks[*(const int*)b].lastUsed;
+	return (ua > ub) - (ua < ub);
+}
+
+static void EvictOverBudget(LevelPager* pager, World* world) {
+	pager->residentBytes = ResidentBytes(pager, world);
+	if (pager->residentBytes <= pager->budgetBytes) return;
+
+	int* candidates = malloc((size_t)(pager->residentCount > 0 ? pager->residentCount : 1) * sizeof(int));
+	int count = 0;
+	for (int r = 0; r < pager->residentCount; r++) {
+		int i = pager->resident[r];
+		PagedChunk* pc = &pager->chunks[i];
+		if (!pc->pinned && IsEdited(pager, world, i)) pc->pinned = true;
+		if (pc->pinned || pc->lastUsed == pager->frame) continue;
+		candidates[count++] = i;
+	}
+
+	sortPager = pager;
+	qsort(candidates, (size_t)count, sizeof(int), CompareLastUsed);
+	sortPager = NULL;
+
+	for (int c = 0; c < count && pager->residentBytes > pager->budgetBytes; c++) {
+		Evict(pager, world, candidates[c]);
+		pager->residentBytes = ResidentBytes(pager, world);
+	}
+	free(candidates);
+}
+
+bool PagerOpen(LevelPager* pager, const char* fileName, World* world, LevelInfo* info, long long budgetBytes) {
+	LevelMapping* mapping = MapFile(fileName);
+	if (mapping == NULL) return false;
+	if (memcmp(mapping->base, LEVEL_MAGIC, 4) != 0) {
+		ReleaseMapping(mapping);
+		return false;
+	}
+
+	World loaded;
+	WorldInit(&loaded);
+	LevelIndex index;
+	if (!LevelOpenIndex(mapping->base, mapping->size, &index, &loaded)) {
+		LevelFreeIndex(&index);
+		WorldFree(&loaded);
+		ReleaseMapping(mapping);
+		return false;
+	}
+
+	PagerClose(pager);
+	WorldFree(world);
+	*world = loaded;
+	*info = index.info;
+
+	pager->active = true;
+	pager->mapping = mapping;
+	pager->index = index;
+	pager->chunks = calloc((size_t)(index.chunkCount > 0 ? index.chunkCount : 1), sizeof(PagedChunk));
+	pager->resident = malloc((size_t)(index.chunkCount > 0 ? index.chunkCount : 1) * sizeof(int));
+	pager->residentCount = 0;
+	pager->residentBlocks = 0;
+	pager->idBytes = 0;
+	pager->residentBytes = ResidentBytes(pager, world);
+	pager->budgetBytes = budgetBytes;
+	pager->frame = 0;
+	pager->radius = PAGER_RADIUS;
+
+	pager->tableCapacity = 64;
+	while (pager->tableCapacity < index.chunkCount * 2) pager->tableCapacity *= 2;
+	pager->table = malloc((size_t)pager->tableCapacity * sizeof(int));
+	for (int i = 0; i < pager->tableCapacity; i++) pager->table[i] = -1;
+
+	unsigned int mask = (unsigned int)pager->tableCapacity - 1;
+	for (int i = 0; i < index.chunkCount; i++) {
+		unsigned int slot = PagerHash(index.chunks[i].cx, index.chunks[i].cy) & mask;
+		while (pager->table[slot] != -1) slot = (slot + 1) & mask;
+		pager->table[slot] = i;
+	}
+
+	AddConsoleLogf(CONSOLE_INFO, "Paging %s: %d chunks, %.0f MB budget", fileName, index.chunkCount, (double)budgetBytes / (1024.0 * 1024.0));
+	return true;
+}
+
+void PagerClose(LevelPager* pager) {
+	if (!pager->active) return;
+
+	for (int i = 0; i < pager->index.chunkCount; i++) free(pager->chunks[i].ids);
+	free(pager->chunks);
+	free(pager->resident);
+	free(pager->table);
+	LevelFreeIndex(&pager->index);
+	ReleaseMapping(pager->mapping);
+	memset(pager, 0, sizeof(LevelPager));
+}
+
+void PagerUpdate(LevelPager* pager, World* world, const Vector2* focus, int focusCount) {
+	if (!pager->active) return;
+	pager->frame++;
+
+	const float chunkSize = (float)(BLOCK_SIZE * GRID_CHUNK_CELLS);
+	int pageIns = 0;
+
+	// Nearest rings first; the chunks right around a focus point are loaded
+	// no matter what so the player never falls through unpaged ground.
+	for (int d = 0; d <= pager->radius; d++) {
+		for (int f = 0; f < focusCount; f++) {
+			int fx = (int)floorf(focus[f].x / chunkSize);
+			int fy = (int)floorf(focus[f].y / chunkSize);
+
+			for (int cy = fy - d; cy <= fy + d; cy++) {
+				for (int cx = fx - d; cx <= fx + d; cx++) {
+					if (abs(cx - fx) != d && abs(cy - fy) != d) continue;
+
+					int i = FindChunk(pager, cx, cy);
+					if (i < 0) continue;
+
+					PagedChunk* pc = &pager->chunks[i];
+					pc->lastUsed = pager->frame;
+					if (pc->resident || pc->failed) continue;
+					if (d > 1 && pageIns >= PAGER_MAX_PAGE_INS) continue;
+
+					PageIn(pager, world, i);
+					pageIns++;
+				}
+			}
+		}
+	}
+
+	EvictOverBudget(pager, world);
+}
+
+PagerSource* PagerSnapshot(LevelPager* pager, World* world) {
+	if (!pager->active) return NULL;
+
+	for (int g = 0; g < world->grid.chunkCapacity; g++) {
+		const GridChunk* chunk = world->grid.chunks[g];
+		if (chunk == NULL || chunk->anchorCount == 0) continue;
+
+		int i = FindChunk(pager, chunk->cx, chunk->cy);
+		if (i < 0 || pager->chunks[i].resident || pager->chunks[i].failed) continue;
+		PageIn(pager, world, i);
+		pager->chunks[i].pinned = true;
+	}
+
+	PagerSource* source = calloc(1, sizeof(PagerSource));
+	source->mapping = pager->mapping;
+	atomic_fetch_add(&source->mapping->refs, 1);
+
+	source->palette = malloc((size_t)(pager->index.paletteCount > 0 ? pager->index.paletteCount : 1) * sizeof(LevelPaletteEntry));
+	memcpy(source->palette, pager->index.palette, (size_t)pager->index.paletteCount * sizeof(LevelPaletteEntry));
+
+	source->chunks = malloc((size_t)(pager->index.chunkCount > 0 ? pager->index.chunkCount : 1) * sizeof(LevelChunkRef));
+	int count = 0;
+	for (int i = 0; i < pager->index.chunkCount; i++) {
+		if (pager->chunks[i].resident || pager->chunks[i].failed) continue;
+		source->chunks[count++] = pager->index.chunks[i];
+	}
+
+	source->source = (LevelSource){ source->palette, pager->index.paletteCount, source->chunks, count };
+	return source;
+}
+
+void PagerSourceFree(PagerSource* source) {
+	if (source == NULL) return;
+	ReleaseMapping(source->mapping);
+	free(source->palette);
+	free(source->chunks);
+	free(source);
+}
+
+PagerStats GetPagerStats(const LevelPager* pager) {
+	PagerStats stats = { 0 };
+	if (!pager->active) return stats;
+
+	stats.residentChunks = pager->residentCount;
+	stats.totalChunks = pager->index.chunkCount;
+	for (int r = 0; r < pager->residentCount; r++) {
+		if (pager->chunks[pager->resident[r]].pinned) stats.pinnedChunks++;
+	}
+	stats.residentMB = (float)pager->residentBytes / (1024.0f * 1024.0f);
+	stats.budgetMB = (float)pager->budgetBytes / (1024.0f * 1024.0f);
+	return stats;
+}
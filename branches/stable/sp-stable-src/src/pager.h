@@ -0,0 +1,92 @@
+#ifndef PAGER_H
+#define PAGER_H
+
+#include "game.h"
+#include "world.h"
+#include "level.h"
+#include <stdatomic.h>
+
+#define PAGER_DEFAULT_BUDGET_MB 512
+#define PAGER_RADIUS 2
+#define PAGER_MAX_PAGE_INS 32
+
+// Plays a level straight from an mmap'ed file. Opening only parses the
+// header and the chunk table, so it takes the same time for any map size;
+// chunks are decoded into the world as the camera or the player get near
+// them and evicted again, least recently needed first, once the memory the
+// world really holds passes the budget. A chunk whose blocks have been
+// edited is pinned until the pager is closed, since the file no longer
+// matches it.
+
+typedef struct {
+	void* base;
+	size_t size;
+	atomic_int refs;
+} LevelMapping;
+
+typedef struct {
+	bool resident;
+	bool pinned;
+	bool failed;
+	unsigned int revision;
+	unsigned int lastUsed;
+	int* ids;
+	int residentSlot;
+} PagedChunk;
+
+typedef struct {
+	bool active;
+	LevelMapping* mapping;
+	LevelIndex index;
+	PagedChunk* chunks;
+
+	int* table;
+	int tableCapacity;
+
+	int* resident;
+	int residentCount;
+
+	long long residentBlocks;
+	long long residentBytes;
+	long long idBytes;
+	long long budgetBytes;
+	unsigned int frame;
+	int radius;
+} LevelPager;
+
+// Keeps the file mapped while a background save copies chunks out of it.
+typedef struct {
+	LevelSource source;
+	LevelMapping* mapping;
+	LevelPaletteEntry* palette;
+	LevelChunkRef* chunks;
+} PagerSource;
+
+typedef struct {
+	int residentChunks;
+	int totalChunks;
+	int pinnedChunks;
+	float residentMB;
+	float budgetMB;
+} PagerStats;
+
+// Replaces world with the loose blocks of fileName and starts paging its
+// chunks. Returns false, leaving world alone, if the file cannot be mapped
+// or is not in the current level format.
+bool PagerOpen(LevelPager* pager, const char* fileName, World* world, LevelInfo* info, long long budgetBytes);
+void PagerClose(LevelPager* pager);
+
+// Pages chunks in around each focus point and evicts over budget. Call once
+// per frame before the simulation step.
+void PagerUpdate(LevelPager* pager, World* world, const Vector2* focus, int focusCount);
+
+// Everything a save of the streamed world needs besides the world itself:
+// the chunks that are not resident, still encoded. Edited chunks are paged
+// in first so none of them is missing from the world. Returns NULL when the
+// pager is not active.
+PagerSource* PagerSnapshot(LevelPager* pager, World* world);
+void PagerSourceFree(PagerSource* source);
+
+PagerStats GetPagerStats(const LevelPager* pager);
+
+#endif
@@ -0,0 +1,232 @@
+#include "profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PROFILER_STACK 8
+#define PROFILER_AVERAGE_FRAMES 60
+#define PROFILER_GRAPH_FRAMES 240
+#define PROFILER_GRAPH_MS 50.0f
+#define PROFILER_STATS_INTERVAL 15
+
+typedef struct {
+	ProfileZone zone;
+	long long start;
+	long long end;
+} ProfileEvent;
+
+typedef struct {
+	long long start;
+	long long end;
+	long long zoneNs[ZONE_COUNT];
+	int eventCount;
+	ProfileEvent events[PROFILER_FRAME_EVENTS];
+} ProfileFrame;
+
+typedef struct {
+	int event;
+	long long childNs;
+} OpenZone;
+
+static const char* zoneNames[ZONE_COUNT] = {
+	"input", "cheats", "streaming", "physics", "weather", "world draw", "hud draw", "music", "end drawing"
+};
+
+static const Color zoneColors[ZONE_COUNT] = {
+	{ 102, 191, 255, 255 }, { 255, 161, 0, 255 }, { 135, 60, 190, 255 }, { 0, 228, 48, 255 }, { 0, 121, 241, 255 },
+	{ 253, 249, 0, 255 }, { 255, 109, 194, 255 }, { 127, 106, 79, 255 }, { 130, 130, 130, 255 }
+};
+
+static ProfileFrame* frames = NULL;
+static long long frameCount = 0;
+static ProfileFrame* current = NULL;
+static OpenZone stack[PROFILER_STACK];
+static int depth = 0;
+
+static ProfilerStats cachedStats = { 0 };
+static long long statsFrame = -1;
+
+static long long NowNs(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static const ProfileFrame* FrameAt(long long index) {
+	return &frames[index % PROFILER_FRAMES];
+}
+
+void ProfilerBeginFrame(void) {
+	if (frames == NULL) frames = calloc(PROFILER_FRAMES, sizeof(ProfileFrame));
+
+	long long now = NowNs();
+	if (current != NULL) {
+		current->end = now;
+		frameCount++;
+	}
+	depth = 0;
+
+	current = &frames[frameCount % PROFILER_FRAMES];
+	memset(current, 0, sizeof(ProfileFrame));
+	current->start = now;
+}
+
+void ProfilerBegin(ProfileZone zone) {
+	if (current == NULL || depth == PROFILER_STACK) return;
+
+	int event = -1;
+	if (current->eventCount < PROFILER_FRAME_EVENTS) {
+		event = current->eventCount++;
+		current->events[event] = (ProfileEvent){ zone, NowNs(), 0 };
+	}
+	stack[depth++] = (OpenZone){ event, 0 };
+}
+
+void ProfilerEnd(ProfileZone zone) {
+	if (current == NULL || depth == 0) return;
+
+	OpenZone open = stack[--depth];
+	if (open.event < 0) return;
+
+	ProfileEvent* e = &current->events[open.event];
+	if (e->zone != zone) return;
+
+	e->end = NowNs();
+	long long total = e->end - e->start;
+	current->zoneNs[zone] += total - open.childNs;
+	if (depth > 0) stack[depth - 1].childNs += total;
+}
+
+const char* GetProfileZoneName(ProfileZone zone) {
+	return zoneNames[zone];
+}
+
+static int CompareDescending(const void* a, const void* b) {
+	float fa = *(const float*)a;
+	float fb = *(const float*)b;
+	return (fa < fb) - (fa > fb);
+}
+
+static float WorstAverage(const float* sorted, int count, int divisor) {
+	int n = count / divisor;
+	if (n < 1) n = 1;
+	double sum = 0.0;
+	for (int i = 0; i < n; i++) sum += sorted[i];
+	return (float)(sum / n);
+}
+
+ProfilerStats GetProfilerStats(void) {
+	if (frameCount == 0) return cachedStats;
+	if (statsFrame >= 0 && frameCount - statsFrame < PROFILER_STATS_INTERVAL) return cachedStats;
+
+	ProfilerStats stats = { 0 };
+	int recorded = (frameCount < PROFILER_FRAMES) ? (int)frameCount : PROFILER_FRAMES - 1;
+	stats.frames = recorded;
+	stats.frameMs = (float)(FrameAt(frameCount - 1)->end - FrameAt(frameCount - 1)->start) / 1e6f;
+
+	int averaged = (recorded < PROFILER_AVERAGE_FRAMES) ? recorded : PROFILER_AVERAGE_FRAMES;
+	for (int i = 1; i <= averaged; i++) {
+		const ProfileFrame* f = FrameAt(frameCount - i);
+		stats.avgFrameMs += (float)(f->end - f->start) / 1e6f;
+		for (int z = 0; z < ZONE_COUNT; z++) stats.zoneMs[z] += (float)f->zoneNs[z] / 1e6f;
+	}
+	stats.avgFrameMs /= (float)averaged;
+	for (int z = 0; z < ZONE_COUNT; z++) stats.zoneMs[z] /= (float)averaged;
+
+	float* times = malloc((size_t)recorded * sizeof(float));
+	for (int i = 1; i <= recorded; i++) {
+		const ProfileFrame* f = FrameAt(frameCount - i);
+		times[i - 1] = (float)(f->end - f->start) / 1e6f;
+	}
+	qsort(times, (size_t)recorded, sizeof(float), CompareDescending);
+	stats.low1Ms = WorstAverage(times, recorded, 100);
+	stats.low01Ms = WorstAverage(times, recorded, 1000);
+	free(times);
+
+	cachedStats = stats;
+	statsFrame = frameCount;
+	return stats;
+}
+
+void DrawProfiler(int x, int y) {
+	ProfilerStats stats = GetProfilerStats();
+	const int width = 300;
+	const int graphHeight = 60;
+	const int height = 70 + ZONE_COUNT * 12 + graphHeight;
+
+	DrawRectangle(x, y, width, height, Fade(BLACK, 0.75f));
+	DrawText(TextFormat("Frame %.2f ms (avg %.2f)", stats.frameMs, stats.avgFrameMs), x + 8, y + 6, 10, WHITE);
+	DrawText(TextFormat("1%% low %.0f fps  0.1%% low %.0f fps  (%i frames)",
+		stats.low1Ms > 0 ? 1000.0f / stats.low1Ms : 0.0f,
+		stats.low01Ms > 0 ? 1000.0f / stats.low01Ms : 0.0f, stats.frames), x + 8, y + 20, 10, LIGHTGRAY);
+
+	// One stacked bar of the average frame, then a line per zone.
+	int barY = y + 36;
+	int barWidth = width - 16;
+	float scale = (stats.avgFrameMs > 0) ? barWidth / stats.avgFrameMs : 0.0f;
+	float barX = (float)(x + 8);
+	DrawRectangle(x + 8, barY, barWidth, 10, DARKGRAY);
+	for (int z = 0; z < ZONE_COUNT; z++) {
+		float w = stats.zoneMs[z] * scale;
+		DrawRectangleRec((Rectangle){ barX, (float)barY, w, 10 }, zoneColors[z]);
+		barX += w;
+	}
+
+	int lineY = barY + 16;
+	for (int z = 0; z < ZONE_COUNT; z++) {
+		DrawRectangle(x + 8, lineY + 1, 8, 8, zoneColors[z]);
+		DrawText(TextFormat("%-12s %6.3f ms", zoneNames[z], stats.zoneMs[z]), x + 22, lineY, 10, WHITE);
+		lineY += 12;
+	}
+
+	// Frame-time graph, newest on the right, with 16.7 and 33.3 ms marks.
+	int graphY = lineY + 6;
+	int graphFrames = (frameCount < PROFILER_GRAPH_FRAMES) ? (int)frameCount : PROFILER_GRAPH_FRAMES;
+	float column = (float)barWidth / PROFILER_GRAPH_FRAMES;
+	for (int i = 1; i <= graphFrames; i++) {
+		const ProfileFrame* f = FrameAt(frameCount - i);
+		float ms = (float)(f->end - f->start) / 1e6f;
+		float h = ms / PROFILER_GRAPH_MS * graphHeight;
+		if (h > graphHeight) h = (float)graphHeight;
+		Color c = (ms > 33.4f) ? RED : (ms > 16.8f) ? ORANGE : GREEN;
+		DrawRectangleRec((Rectangle){ x + 8 + barWidth - i * column, graphY + graphHeight - h, column, h }, c);
+	}
+	for (int m = 1; m <= 2; m++) {
+		int markY = graphY + graphHeight - (int)(m * 16.667f / PROFILER_GRAPH_MS * graphHeight);
+		DrawLine(x + 8, markY, x + 8 + barWidth, markY, Fade(WHITE, 0.4f));
+	}
+}
+
+bool ProfilerDumpTrace(const char* fileName, double seconds) {
+	if (frameCount == 0) return false;
+
+	FILE* file = fopen(fileName, "w");
+	if (file == NULL) return false;
+
+	long long newestEnd = FrameAt(frameCount - 1)->end;
+	long long cutoff = newestEnd - (long long)(seconds * 1e9);
+	long long first = frameCount - 1;
+	long long oldest = (frameCount < PROFILER_FRAMES) ? 0 : frameCount - (PROFILER_FRAMES - 1);
+	while (first > oldest && FrameAt(first - 1)->start >= cutoff) first--;
+
+	long long origin = FrameAt(first)->start;
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}}");
+
+	for (long long i = first; i < frameCount; i++) {
+		const ProfileFrame* f = FrameAt(i);
+		fprintf(file, ",\n{\"name\":\"frame\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"index\":%lld}}",
+			(f->start - origin) / 1e3, (f->end - f->start) / 1e3, i);
+
+		for (int e = 0; e < f->eventCount; e++) {
+			const ProfileEvent* ev = &f->events[e];
+			if (ev->end == 0) continue;
+			fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"zone\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+				zoneNames[ev->zone], (ev->start - origin) / 1e3, (ev->end - ev->start) / 1e3);
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
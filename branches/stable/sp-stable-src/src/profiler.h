@@ -0,0 +1,55 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "raylib.h"
+#include <stdbool.h>
+
+#define PROFILER_FRAMES 4096
+#define PROFILER_FRAME_EVENTS 32
+#define PROFILER_TRACE_SECONDS 10.0
+
+// Frame profiler for the main loop. Each frame opens with
+// ProfilerBeginFrame and its phases are wrapped in ProfilerBegin/End
+// pairs, which may nest; a zone's share of the breakdown is its own time
+// with nested zones taken out. The last PROFILER_FRAMES frames are kept in
+// a ring, with every zone entry as an event, so the recent past can be
+// drawn as an overlay or written out as a Chrome trace (chrome://tracing,
+// Perfetto). Main thread only.
+
+typedef enum {
+	ZONE_INPUT,
+	ZONE_CHEATS,
+	ZONE_STREAMING,
+	ZONE_PHYSICS,
+	ZONE_WEATHER,
+	ZONE_WORLD_DRAW,
+	ZONE_HUD_DRAW,
+	ZONE_MUSIC,
+	ZONE_END_DRAWING,
+	ZONE_COUNT
+} ProfileZone;
+
+typedef struct {
+	float frameMs;
+	float avgFrameMs;
+	// Average frame time of the slowest 1% and 0.1% of the recorded frames.
+	float low1Ms;
+	float low01Ms;
+	float zoneMs[ZONE_COUNT];
+	int frames;
+} ProfilerStats;
+
+void ProfilerBeginFrame(void);
+void ProfilerBegin(ProfileZone zone);
+void ProfilerEnd(ProfileZone zone);
+
+ProfilerStats GetProfilerStats(void);
+const char* GetProfileZoneName(ProfileZone zone);
+
+// Breakdown and frame-time graph, drawn in screen space.
+void DrawProfiler(int x, int y);
+
+// Writes the last `seconds` of recorded frames as trace_event JSON.
+bool ProfilerDumpTrace(const char* fileName, double seconds);
+
+#endif
@@ -0,0 +1,418 @@
+#include "render.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define CIRCLE_SEGMENTS 36
+// Chunks synced around the view. Blocks are anchored in the chunk of their
+// top-left cell, so one reaching into the view from up or left can be
+// anchored a few chunks away; level files cap blocks at four chunks across.
+#define SYNC_MARGIN_CHUNKS 4
+// Meshes of chunks that scrolled out of range are kept for CACHE_MAX_AGE
+// frames so panning back and forth does not rebuild them, unless the cache
+// has grown past CACHE_LIMIT entries.
+#define CACHE_LIMIT 1024
+#define CACHE_MAX_AGE 600
+
+typedef struct {
+	int cx;
+	int cy;
+	unsigned int revision;
+	unsigned int lastUsed;
+
+	Mesh mesh;
+	Rectangle bounds;
+
+	int* customIds;
+	int customCount;
+	int customCapacity;
+} ChunkMesh;
+
+typedef struct {
+	float* vertices;
+	float* texcoords;
+	unsigned char* colors;
+	int count;
+} MeshBuilder;
+
+TextureAtlas spriteAtlas;
+int customBlockSprites[NUM_CUSTOM_BLOCKS];
+
+static Material blockMaterial;
+static bool materialLoaded = false;
+
+static ChunkMesh* cache = NULL;
+static int cacheCount = 0;
+static int cacheCapacity = 0;
+
+static int* cacheTable = NULL;
+static int cacheTableCapacity = 0;
+
+static RenderStats stats = { 0 };
+static unsigned int frame = 0;
+
+// Scratch for RebuildChunk, kept between rebuilds so its loose list is
+// only grown once.
+static MergedChunk merged;
+
+static unsigned int CacheHash(int cx, int cy) {
+	unsigned int h = (unsigned int)cx * 0x9E3779B1u ^ (unsigned int)cy * 0x85EBCA77u;
+	return h ^ (h >> 16);
+}
+
+static void RebuildCacheTable(void) {
+	int capacity = (cacheTableCapacity > 0) ? cacheTableCapacity : 64;
+	while (capacity < cacheCount * 2 + 2) capacity *= 2;
+
+	if (capacity != cacheTableCapacity) {
+		free(cacheTable);
+		cacheTable = malloc((size_t)capacity * sizeof(int));
+		cacheTableCapacity = capacity;
+	}
+	for (int i = 0; i < capacity; i++) cacheTable[i] = -1;
+
+	unsigned int mask = (unsigned int)capacity - 1;
+	for (int i = 0; i < cacheCount; i++) {
+		unsigned int slot = CacheHash(cache[i].cx, cache[i].cy) & mask;
+		while (cacheTable[slot] != -1) slot = (slot + 1) & mask;
+		cacheTable[slot] = i;
+	}
+}
+
+static ChunkMesh* GetChunkMesh(int cx, int cy) {
+	if (cacheTableCapacity > 0) {
+		unsigned int mask = (unsigned int)cacheTableCapacity - 1;
+		unsigned int slot = CacheHash(cx, cy) & mask;
+		while (cacheTable[slot] != -1) {
+			ChunkMesh* entry = &cache[cacheTable[slot]];
+			if (entry->cx == cx && entry->cy == cy) return entry;
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	if (cacheCount == cacheCapacity) {
+		cacheCapacity = (cacheCapacity > 0) ? cacheCapacity * 2 : 64;
+		cache = realloc(cache, (size_t)cacheCapacity * sizeof(ChunkMesh));
+	}
+
+	ChunkMesh* entry = &cache[cacheCount++];
+	memset(entry, 0, sizeof(ChunkMesh));
+	entry->cx = cx;
+	entry->cy = cy;
+
+	if ((cacheCount + 1) * 2 > cacheTableCapacity) {
+		RebuildCacheTable();
+	}
+	else {
+		unsigned int mask = (unsigned int)cacheTableCapacity - 1;
+		unsigned int slot = CacheHash(cx, cy) & mask;
+		while (cacheTable[slot] != -1) slot = (slot + 1) & mask;
+		cacheTable[slot] = cacheCount - 1;
+	}
+	return entry;
+}
+
+static void ReleaseMesh(ChunkMesh* entry) {
+	if (entry->mesh.vertexCount > 0) UnloadMesh(entry->mesh);
+	memset(&entry->mesh, 0, sizeof(Mesh));
+}
+
+static int ShapeTriangles(BlockShape shape) {
+	switch (shape) {
+	case SHAPE_SQUARE:
+	case SHAPE_RECT:
+	case SHAPE_RHOMBUS: return 2;
+	case SHAPE_TRIANGLE: return 1;
+	case SHAPE_CIRCLE: return CIRCLE_SEGMENTS;
+	default: return 0;
+	}
+}
+
+static void PushVertex(MeshBuilder* mb, float x, float y, Color color) {
+	int i = mb->count++;
+	mb->vertices[i * 3 + 0] = x;
+	mb->vertices[i * 3 + 1] = y;
+	mb->vertices[i * 3 + 2] = 0.0f;
+	mb->texcoords[i * 2 + 0] = 0.0f;
+	mb->texcoords[i * 2 + 1] = 0.0f;
+	mb->colors[i * 4 + 0] = color.r;
+	mb->colors[i * 4 + 1] = color.g;
+	mb->colors[i * 4 + 2] = color.b;
+	mb->colors[i * 4 + 3] = color.a;
+}
+
+static void PushTriangle(MeshBuilder* mb, Vector2 a, Vector2 b, Vector2 c, Color color) {
+	PushVertex(mb, a.x, a.y, color);
+	PushVertex(mb, b.x, b.y, color);
+	PushVertex(mb, c.x, c.y, color);
+}
+
+// Same geometry the immediate-mode DrawBlockShape path produces.
+static void PushBlock(MeshBuilder* mb, const Block* b) {
+	Rectangle r = b->rect;
+	Color color = b->color;
+
+	switch (b->shape) {
+	case SHAPE_SQUARE:
+	case SHAPE_RECT:
+		PushTriangle(mb, (Vector2){ r.x, r.y }, (Vector2){ r.x, r.y + r.height }, (Vector2){ r.x + r.width, r.y + r.height }, color);
+		PushTriangle(mb, (Vector2){ r.x, r.y }, (Vector2){ r.x + r.width, r.y + r.height }, (Vector2){ r.x + r.width, r.y }, color);
+		break;
+	case SHAPE_TRIANGLE:
+		PushTriangle(mb, (Vector2){ r.x + r.width / 2, r.y }, (Vector2){ r.x, r.y + r.height }, (Vector2){ r.x + r.width, r.y + r.height }, color);
+		break;
+	case SHAPE_RHOMBUS:
+		PushTriangle(mb, (Vector2){ r.x + r.width / 2, r.y }, (Vector2){ r.x, r.y + r.height / 2 }, (Vector2){ r.x + r.width, r.y + r.height / 2 }, color);
+		PushTriangle(mb, (Vector2){ r.x, r.y + r.height / 2 }, (Vector2){ r.x + r.width / 2, r.y + r.height }, (Vector2){ r.x + r.width, r.y + r.height / 2 }, color);
+		break;
+	case SHAPE_CIRCLE: {
+		Vector2 center = { (float)(int)(r.x + r.width / 2), (float)(int)(r.y + r.height / 2) };
+		float radius = r.width / 2;
+		float step = 2.0f * PI / CIRCLE_SEGMENTS;
+		for (int i = 0; i < CIRCLE_SEGMENTS; i++) {
+			float a0 = step * i;
+			float a1 = step * (i + 1);
+			PushTriangle(mb, center,
+				(Vector2){ center.x + cosf(a1) * radius, center.y + sinf(a1) * radius },
+				(Vector2){ center.x + cosf(a0) * radius, center.y + sinf(a0) * radius },
+				color);
+		}
+		break;
+	}
+	default: break;
+	}
+}
+
+static bool IsCustomShape(BlockShape shape) {
+	return shape >= SHAPE_CUST1 && shape <= SHAPE_CUST12;
+}
+
+static void AddCustom(ChunkMesh* entry, int id) {
+	if (entry->customCount == entry->customCapacity) {
+		entry->customCapacity = (entry->customCapacity > 0) ? entry->customCapacity * 2 : 16;
+		entry->customIds = realloc(entry->customIds, (size_t)entry->customCapacity * sizeof(int));
+	}
+	entry->customIds[entry->customCount++] = id;
+}
+
+static void GrowBounds(ChunkMesh* entry, Rectangle rect, bool* haveBounds) {
+	if (!*haveBounds) {
+		entry->bounds = rect;
+		*haveBounds = true;
+		return;
+	}
+
+	float x0 = fminf(entry->bounds.x, rect.x);
+	float y0 = fminf(entry->bounds.y, rect.y);
+	float x1 = fmaxf(entry->bounds.x + entry->bounds.width, rect.x + rect.width);
+	float y1 = fmaxf(entry->bounds.y + entry->bounds.height, rect.y + rect.height);
+	entry->bounds = (Rectangle){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+// Plain blocks of one colour are drawn as the merged rectangles from
+// MergeChunk; the loose blocks, each anchored here exactly once even if it
+// spans several chunks, are drawn as they are.
+static void RebuildChunk(ChunkMesh* entry, const World* world, const GridChunk* chunk) {
+	bool haveBounds = false;
+
+	entry->customCount = 0;
+	entry->bounds = (Rectangle){ 0 };
+	MergeChunk(&merged, world, chunk);
+
+	int triangles = merged.rectCount * 2;
+	for (int i = 0; i < merged.rectCount; i++) GrowBounds(entry, merged.rects[i].rect, &haveBounds);
+	for (int i = 0; i < merged.looseCount; i++) {
+		const Block* b = WorldGet(world, merged.loose[i]);
+		triangles += ShapeTriangles(b->shape);
+		if (IsCustomShape(b->shape)) AddCustom(entry, merged.loose[i]);
+		GrowBounds(entry, b->rect, &haveBounds);
+	}
+
+	ReleaseMesh(entry);
+	entry->revision = chunk->revision;
+	stats.chunksRebuilt++;
+	if (triangles == 0) return;
+
+	int vertexCount = triangles * 3;
+	MeshBuilder mb = {
+		MemAlloc((unsigned int)vertexCount * 3 * sizeof(float)),
+		MemAlloc((unsigned int)vertexCount * 2 * sizeof(float)),
+		MemAlloc((unsigned int)vertexCount * 4 * sizeof(unsigned char)),
+		0
+	};
+
+	for (int i = 0; i < merged.rectCount; i++) {
+		Block quad = { merged.rects[i].rect, 1, merged.rects[i].color, SHAPE_SQUARE };
+		PushBlock(&mb, &quad);
+	}
+	for (int i = 0; i < merged.looseCount; i++) PushBlock(&mb, WorldGet(world, merged.loose[i]));
+
+	Mesh mesh = { 0 };
+	mesh.vertexCount = vertexCount;
+	mesh.triangleCount = triangles;
+	mesh.vertices = mb.vertices;
+	mesh.texcoords = mb.texcoords;
+	mesh.colors = mb.colors;
+	UploadMesh(&mesh, false);
+
+	// OpenGL 1.1 draws straight from the CPU arrays; everything else only
+	// needs the buffers that were just uploaded.
+	if (rlGetVersion() != RL_OPENGL_11) {
+		MemFree(mesh.vertices);
+		MemFree(mesh.texcoords);
+		MemFree(mesh.colors);
+		mesh.vertices = NULL;
+		mesh.texcoords = NULL;
+		mesh.colors = NULL;
+	}
+	entry->mesh = mesh;
+}
+
+static void SyncChunk(const World* world, const GridChunk* chunk) {
+	ChunkMesh* entry = GetChunkMesh(chunk->cx, chunk->cy);
+	entry->lastUsed = frame;
+	if (entry->revision != chunk->revision) RebuildChunk(entry, world, chunk);
+}
+
+static bool Evict(const ChunkMesh* entry, int cx0, int cy0, int cx1, int cy1) {
+	if (entry->lastUsed == frame) return false;
+	// In range but not synced: its chunk is gone or anchors nothing now.
+	if (entry->cx >= cx0 && entry->cx <= cx1 && entry->cy >= cy0 && entry->cy <= cy1) return true;
+	if (frame - entry->lastUsed > CACHE_MAX_AGE) return true;
+	return cacheCount > CACHE_LIMIT;
+}
+
+// Brings the meshes of the chunks around view up to date. Only those are
+// looked at, so the cost follows the screen rather than the size of the
+// world.
+static void SyncCache(const World* world, Rectangle view) {
+	const SpatialGrid* grid = &world->grid;
+	const float chunkSize = (float)(GRID_CHUNK_CELLS * BLOCK_SIZE);
+	int cx0 = (int)floorf(view.x / chunkSize) - SYNC_MARGIN_CHUNKS;
+	int cy0 = (int)floorf(view.y / chunkSize) - SYNC_MARGIN_CHUNKS;
+	int cx1 = (int)floorf((view.x + view.width) / chunkSize) + 1;
+	int cy1 = (int)floorf((view.y + view.height) / chunkSize) + 1;
+	frame++;
+
+	// Zoomed far out the range can hold more chunks than exist; walking the
+	// grid's own table is cheaper then.
+	long long rangeChunks = (long long)(cx1 - cx0 + 1) * (cy1 - cy0 + 1);
+	if (rangeChunks > grid->chunkCount) {
+		for (int i = 0; i < grid->chunkCapacity; i++) {
+			const GridChunk* chunk = grid->chunks[i];
+			if (chunk == NULL || chunk->anchorCount == 0) continue;
+			if (chunk->cx < cx0 || chunk->cx > cx1 || chunk->cy < cy0 || chunk->cy > cy1) continue;
+			SyncChunk(world, chunk);
+		}
+	}
+	else {
+		for (int cy = cy0; cy <= cy1; cy++) {
+			for (int cx = cx0; cx <= cx1; cx++) {
+				const GridChunk* chunk = GridFindChunk(grid, cx, cy);
+				if (chunk != NULL && chunk->anchorCount > 0) SyncChunk(world, chunk);
+			}
+		}
+	}
+
+	int kept = 0;
+	for (int i = 0; i < cacheCount; i++) {
+		if (Evict(&cache[i], cx0, cy0, cx1, cy1)) {
+			ReleaseMesh(&cache[i]);
+			free(cache[i].customIds);
+			continue;
+		}
+		cache[kept++] = cache[i];
+	}
+	if (kept != cacheCount) {
+		cacheCount = kept;
+		RebuildCacheTable();
+	}
+}
+
+void RenderInit(void) {
+	blockMaterial = LoadMaterialDefault();
+	materialLoaded = true;
+}
+
+void RenderFree(void) {
+	for (int i = 0; i < cacheCount; i++) {
+		ReleaseMesh(&cache[i]);
+		free(cache[i].customIds);
+	}
+	free(cache);
+	free(cacheTable);
+	cache = NULL;
+	cacheTable = NULL;
+	cacheCount = 0;
+	cacheCapacity = 0;
+	cacheTableCapacity = 0;
+	MergedChunkFree(&merged);
+
+	if (materialLoaded) UnloadMaterial(blockMaterial);
+	materialLoaded = false;
+}
+
+void DrawWorld(const World* world, Rectangle view) {
+	stats.chunksRebuilt = 0;
+	stats.chunksDrawn = 0;
+	stats.trianglesDrawn = 0;
+	SyncCache(world, view);
+	stats.chunksCached = cacheCount;
+
+	// Meshes go straight to the GPU, so anything already batched has to be
+	// flushed first to keep the draw order.
+	rlDrawRenderBatchActive();
+	rlDisableBackfaceCulling();
+	for (int i = 0; i < cacheCount; i++) {
+		if (cache[i].lastUsed != frame || cache[i].mesh.vertexCount == 0 || !CheckCollisionRecs(cache[i].bounds, view)) continue;
+		DrawMesh(cache[i].mesh, blockMaterial, MatrixIdentity());
+		stats.chunksDrawn++;
+		stats.trianglesDrawn += cache[i].mesh.triangleCount;
+	}
+	rlEnableBackfaceCulling();
+
+	for (int i = 0; i < cacheCount; i++) {
+		if (cache[i].lastUsed != frame || cache[i].customCount == 0 || !CheckCollisionRecs(cache[i].bounds, view)) continue;
+		for (int c = 0; c < cache[i].customCount; c++) {
+			const Block* b = WorldGet(world, cache[i].customIds[c]);
+			if (CheckCollisionRecs(b->rect, view)) DrawBlockShape(b);
+		}
+	}
+}
+
+void DrawBlockShape(const Block* b) {
+	if (IsCustomShape(b->shape)) {
+		int sprite = customBlockSprites[b->shape - SHAPE_CUST1];
+		if (AtlasHas(&spriteAtlas, sprite)) {
+			Vector2 origin = { 0.0f, 0.0f };
+			DrawTexturePro(spriteAtlas.texture, AtlasSource(&spriteAtlas, sprite), b->rect, origin, 0.0f, WHITE);
+		}
+		else {
+			DrawRectangleRec(b->rect, MAGENTA);
+		}
+		return;
+	}
+
+	Rectangle r = b->rect;
+	switch (b->shape) {
+	case SHAPE_SQUARE: DrawRectangleRec(r, b->color); break;
+	case SHAPE_RECT: DrawRectangleRec(r, b->color); break;
+	case SHAPE_TRIANGLE:
+		DrawTriangle((Vector2){ r.x + r.width / 2, r.y }, (Vector2){ r.x, r.y + r.height }, (Vector2){ r.x + r.width, r.y + r.height }, b->color);
+		break;
+	case SHAPE_CIRCLE:
+		DrawCircle((int)(r.x + r.width / 2), (int)(r.y + r.height / 2), r.width / 2, b->color);
+		break;
+	case SHAPE_RHOMBUS:
+		DrawTriangle((Vector2){ r.x + r.width / 2, r.y }, (Vector2){ r.x, r.y + r.height / 2 }, (Vector2){ r.x + r.width, r.y + r.height / 2 }, b->color);
+		DrawTriangle((Vector2){ r.x, r.y + r.height / 2 }, (Vector2){ r.x + r.width / 2, r.y + r.height }, (Vector2){ r.x + r.width, r.y + r.height / 2 }, b->color);
+		break;
+	default: break;
+	}
+}
+
+RenderStats GetRenderStats(void) {
+	return stats;
+}
@@ -0,0 +1,37 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "game.h"
+#include "world.h"
+#include "atlas.h"
+
+#define NUM_CUSTOM_BLOCKS 12
+
+// World rendering. Solid shapes are baked into one mesh per grid chunk and
+// rebuilt only when a block anchored in that chunk changes, so a screenful
+// of blocks costs a handful of draw calls. Only chunks around the view are
+// meshed, and meshes that scroll away are dropped again. Plain blocks of one
+// colour are merged into larger quads first (see merge.h). Textured custom
+// blocks are still drawn one by one through the regular batch, sampling the
+// shared sprite atlas so they never break it up.
+
+extern TextureAtlas spriteAtlas;
+extern int customBlockSprites[NUM_CUSTOM_BLOCKS];
+
+typedef struct {
+	int chunksCached;
+	int chunksDrawn;
+	int chunksRebuilt;
+	int trianglesDrawn;
+} RenderStats;
+
+void RenderInit(void);
+void RenderFree(void);
+
+// Must be called inside BeginMode2D. view is the visible area in world space.
+void DrawWorld(const World* world, Rectangle view);
+void DrawBlockShape(const Block* b);
+
+RenderStats GetRenderStats(void);
+
+#endif
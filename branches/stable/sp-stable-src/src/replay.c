@@ -0,0 +1,696 @@
+#include "replay.h"
+#include "console.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+	REC_END,
+	REC_KEYFRAME,
+	REC_INPUT,
+	REC_REPEAT,
+	REC_STEP,
+	REC_CAMERA,
+	REC_ADD,
+	REC_REMOVE,
+	REC_CLEAR
+};
+
+enum { KEYFRAME_PERIODIC, KEYFRAME_RELOAD };
+
+#define FIELD_BUTTONS 0x01
+#define FIELD_MOUSE 0x02
+#define FIELD_COLOR 0x04
+#define FIELD_SHAPE 0x08
+#define FIELD_CHEAT 0x10
+
+#define BUTTON_LEFT 0x01
+#define BUTTON_RIGHT 0x02
+#define BUTTON_UP 0x04
+#define BUTTON_DOWN 0x08
+#define BUTTON_JUMP 0x10
+#define BUTTON_RESET 0x20
+#define BUTTON_PLACE 0x40
+#define BUTTON_REMOVE 0x80
+
+#define REPLAY_HEADER_BYTES 10
+
+// Writing -------------------------------------------------------------------
+
+static void Reserve(ReplayBuffer* b, size_t size) {
+	if (b->length + size <= b->capacity) return;
+	while (b->length + size > b->capacity) b->capacity = (b->capacity > 0) ? b->capacity * 2 : 4096;
+	b->data = realloc(b->data, b->capacity);
+}
+
+static void PutBytes(ReplayBuffer* b, const void* data, size_t size) {
+	Reserve(b, size);
+	memcpy(b->data + b->length, data, size);
+	b->length += size;
+}
+
+static void PutU8(ReplayBuffer* b, unsigned char v) {
+	PutBytes(b, &v, 1);
+}
+
+static void PutU16(ReplayBuffer* b, unsigned int v) {
+	unsigned char bytes[2] = { (unsigned char)v, (unsigned char)(v >> 8) };
+	PutBytes(b, bytes, 2);
+}
+
+static void PutF32(ReplayBuffer* b, float v) {
+	unsigned int bits;
+	memcpy(&bits, &v, sizeof(bits));
+	unsigned char bytes[4] = { (unsigned char)bits, (unsigned char)(bits >> 8), (unsigned char)(bits >> 16), (unsigned char)(bits >> 24) };
+	PutBytes(b, bytes, 4);
+}
+
+static void PutU64(ReplayBuffer* b, unsigned long long v) {
+	unsigned char bytes[8];
+	for (int i = 0; i < 8; i++) bytes[i] = (unsigned char)(v >> (i * 8));
+	PutBytes(b, bytes, 8);
+}
+
+static void PutVarint(ReplayBuffer* b, unsigned long long v) {
+	Reserve(b, 10);
+	while (v >= 0x80) {
+		b->data[b->length++] = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	b->data[b->length++] = (unsigned char)v;
+}
+
+static void PutRect(ReplayBuffer* b, Rectangle rect) {
+	PutF32(b, rect.x);
+	PutF32(b, rect.y);
+	PutF32(b, rect.width);
+	PutF32(b, rect.height);
+}
+
+static void PutColor(ReplayBuffer* b, Color color) {
+	unsigned char bytes[4] = { color.r, color.g, color.b, color.a };
+	PutBytes(b, bytes, 4);
+}
+
+// FNV-1a over the active blocks in id order. Rects are hashed by their bits,
+// the same exactness the player and camera are compared with.
+static unsigned long long HashBlocks(const World* world) {
+	unsigned long long hash = 0xcbf29ce484222325ull;
+	for (int id = 0; id < world->highWater; id++) {
+		const Block* block = WorldGet(world, id);
+		if (!block->active) continue;
+		unsigned char bytes[4 + sizeof(Rectangle) + 5];
+		memcpy(bytes, &id, 4);
+		memcpy(bytes + 4, &block->rect, sizeof(Rectangle));
+		bytes[4 + sizeof(Rectangle) + 0] = block->color.r;
+		bytes[4 + sizeof(Rectangle) + 1] = block->color.g;
+		bytes[4 + sizeof(Rectangle) + 2] = block->color.b;
+		bytes[4 + sizeof(Rectangle) + 3] = block->color.a;
+		bytes[4 + sizeof(Rectangle) + 4] = (unsigned char)block->shape;
+		for (size_t i = 0; i < sizeof(bytes); i++) {
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+	}
+	return hash;
+}
+
+static void EncodeKeyframe(ReplayBuffer* b, const WorldState* state, float step) {
+	const World* world = &state->world;
+	const Player* player = &state->player;
+
+	b->length = 0;
+	PutF32(b, step);
+	PutF32(b, player->position.x);
+	PutF32(b, player->position.y);
+	PutF32(b, player->velocity.x);
+	PutF32(b, player->velocity.y);
+	PutU8(b, (unsigned char)((player->grounded ? 1 : 0) | (player->facingRight ? 2 : 0)));
+	PutU8(b, (unsigned char)state->cameraMode);
+	PutF32(b, state->cameraTarget.x);
+	PutF32(b, state->cameraTarget.y);
+	PutU64(b, HashBlocks(world));
+
+	PutVarint(b, (unsigned long long)world->highWater);
+	for (int id = 0; id < world->highWater; id++) {
+		const Block* block = WorldGet(world, id);
+		PutU8(b, block->active ? 1 : 0);
+		if (!block->active) continue;
+		PutRect(b, block->rect);
+		PutColor(b, block->color);
+		PutU8(b, (unsigned char)block->shape);
+	}
+
+	PutVarint(b, (unsigned long long)world->freeCount);
+	for (int i = 0; i < world->freeCount; i++) PutVarint(b, (unsigned long long)world->freeIds[i]);
+}
+
+static void FlushRepeat(ReplayRecorder* rec) {
+	if (rec->pendingRepeat == 0) return;
+	PutU8(&rec->records, REC_REPEAT);
+	PutVarint(&rec->records, rec->pendingRepeat);
+	rec->pendingRepeat = 0;
+}
+
+static void WriteKeyframe(ReplayRecorder* rec, const WorldState* state, int kind) {
+	FlushRepeat(rec);
+	EncodeKeyframe(&rec->keyframe, state, rec->step);
+
+	PutU8(&rec->records, REC_KEYFRAME);
+	PutU8(&rec->records, (unsigned char)kind);
+	PutVarint(&rec->records, rec->tick);
+	PutVarint(&rec->records, rec->keyframe.length);
+	PutBytes(&rec->records, rec->keyframe.data, rec->keyframe.length);
+
+	memset(&rec->last, 0, sizeof(InputFrame));
+	rec->cameraMode = state->cameraMode;
+	rec->sinceKeyframe = 0.0f;
+	rec->keyframes++;
+}
+
+static void WriteJournal(ReplayRecorder* rec) {
+	WorldJournal* journal = &rec->journal;
+	if (journal->count == 0) return;
+
+	FlushRepeat(rec);
+	for (int i = 0; i < journal->count; i++) {
+		const WorldChange* change = &journal->changes[i];
+		if (change->type == WORLD_CHANGE_ADD) {
+			PutU8(&rec->records, REC_ADD);
+			PutRect(&rec->records, change->rect);
+			PutColor(&rec->records, change->color);
+			PutU8(&rec->records, (unsigned char)change->shape);
+		}
+		else if (change->type == WORLD_CHANGE_REMOVE) {
+			PutU8(&rec->records, REC_REMOVE);
+			PutVarint(&rec->records, (unsigned long long)change->id);
+		}
+		else {
+			PutU8(&rec->records, REC_CLEAR);
+		}
+	}
+	journal->count = 0;
+}
+
+static unsigned char Buttons(const InputFrame* input) {
+	return (unsigned char)((input->left ? BUTTON_LEFT : 0) | (input->right ? BUTTON_RIGHT : 0) |
+		(input->up ? BUTTON_UP : 0) | (input->down ? BUTTON_DOWN : 0) |
+		(input->jumpPressed ? BUTTON_JUMP : 0) | (input->resetPressed ? BUTTON_RESET : 0) |
+		(input->placeHeld ? BUTTON_PLACE : 0) | (input->removeHeld ? BUTTON_REMOVE : 0));
+}
+
+static bool SameColor(Color a, Color b) {
+	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static unsigned char ChangedFields(const InputFrame* input, const InputFrame* last) {
+	unsigned char fields = 0;
+	if (Buttons(input) != Buttons(last)) fields |= FIELD_BUTTONS;
+	if (memcmp(&input->mouseWorld, &last->mouseWorld, sizeof(Vector2)) != 0) fields |= FIELD_MOUSE;
+	if (!SameColor(input->blockColor, last->blockColor)) fields |= FIELD_COLOR;
+	if (input->blockShape != last->blockShape) fields |= FIELD_SHAPE;
+	if (strncmp(input->cheatCode, last->cheatCode, sizeof(input->cheatCode)) != 0) fields |= FIELD_CHEAT;
+	return fields;
+}
+
+static void WriteInput(ReplayRecorder* rec, const InputFrame* input) {
+	unsigned char fields = ChangedFields(input, &rec->last);
+	if (fields == 0 && rec->records.length == 0) {
+		rec->pendingRepeat++;
+		return;
+	}
+
+	FlushRepeat(rec);
+	ReplayBuffer* b = &rec->records;
+	PutU8(b, REC_INPUT);
+	PutU8(b, fields);
+	if (fields & FIELD_BUTTONS) PutU8(b, Buttons(input));
+	if (fields & FIELD_MOUSE) {
+		PutF32(b, input->mouseWorld.x);
+		PutF32(b, input->mouseWorld.y);
+	}
+	if (fields & FIELD_COLOR) PutColor(b, input->blockColor);
+	if (fields & FIELD_SHAPE) PutU8(b, (unsigned char)input->blockShape);
+	if (fields & FIELD_CHEAT) {
+		int length = (int)strnlen(input->cheatCode, sizeof(input->cheatCode) - 1);
+		PutU8(b, (unsigned char)length);
+		PutBytes(b, input->cheatCode, (size_t)length);
+	}
+
+	rec->last = *input;
+	rec->last.cheatCode[sizeof(rec->last.cheatCode) - 1] = '\0';
+}
+
+static void FlushRecords(ReplayRecorder* rec) {
+	if (rec->records.length == 0) return;
+	if (fwrite(rec->records.data, 1, rec->records.length, rec->file) != rec->records.length) rec->failed = true;
+	rec->records.length = 0;
+}
+
+bool ReplayStartRecording(ReplayRecorder* rec, const char* fileName, WorldState* state, int tickRate) {
+	FILE* file = fopen(fileName, "wb");
+	if (file == NULL) {
+		AddConsoleLogf(CONSOLE_ERROR, "Replay: cannot create %s", fileName);
+		return false;
+	}
+
+	memset(rec, 0, sizeof(ReplayRecorder));
+	rec->file = file;
+	rec->step = 1.0f / (float)tickRate;
+
+	PutBytes(&rec->records, REPLAY_MAGIC, 4);
+	PutU16(&rec->records, REPLAY_VERSION);
+	PutU16(&rec->records, 0);
+	PutU16(&rec->records, (unsigned int)tickRate);
+	WriteKeyframe(rec, state, KEYFRAME_PERIODIC);
+	FlushRecords(rec);
+
+	state->world.journal = &rec->journal;
+	AddConsoleLogf(CONSOLE_INFO, "Replay: recording to %s", fileName);
+	return true;
+}
+
+void ReplayRecordStep(ReplayRecorder* rec, WorldState* state, const InputFrame* input, float dt) {
+	// A world that lost the journal was replaced wholesale, by a load for
+	// instance, and the changes that made it are not worth replaying.
+	if (state->world.journal != &rec->journal) {
+		rec->journal.count = 0;
+		rec->step = dt;
+		WriteKeyframe(rec, state, KEYFRAME_RELOAD);
+	}
+	else if (rec->sinceKeyframe >= REPLAY_KEYFRAME_SECONDS) {
+		WriteJournal(rec);
+		rec->step = dt;
+		WriteKeyframe(rec, state, KEYFRAME_PERIODIC);
+	}
+	else {
+		WriteJournal(rec);
+	}
+
+	if (dt != rec->step) {
+		FlushRepeat(rec);
+		PutU8(&rec->records, REC_STEP);
+		PutF32(&rec->records, dt);
+		rec->step = dt;
+	}
+	if (state->cameraMode != rec->cameraMode) {
+		FlushRepeat(rec);
+		PutU8(&rec->records, REC_CAMERA);
+		PutU8(&rec->records, (unsigned char)state->cameraMode);
+		rec->cameraMode = state->cameraMode;
+	}
+	WriteInput(rec, input);
+	bool keyframe = rec->sinceKeyframe == 0.0f;
+	FlushRecords(rec);
+	// Keep what is on disk playable if the game dies mid-session.
+	if (keyframe) fflush(rec->file);
+
+	// Changes the simulation makes are replayed by re-running it.
+	state->world.journal = NULL;
+	SimStep(state, input, dt);
+	state->world.journal = &rec->journal;
+
+	rec->tick++;
+	rec->sinceKeyframe += dt;
+}
+
+bool ReplayStopRecording(ReplayRecorder* rec, WorldState* state) {
+	if (rec->file == NULL) return false;
+
+	if (state->world.journal == &rec->journal) state->world.journal = NULL;
+	FlushRepeat(rec);
+	PutU8(&rec->records, REC_END);
+	FlushRecords(rec);
+	if (fclose(rec->file) != 0) rec->failed = true;
+
+	bool ok = !rec->failed;
+	if (ok) AddConsoleLogf(CONSOLE_INFO, "Replay: %llu ticks recorded, %d keyframes", rec->tick, rec->keyframes);
+	else AddConsoleLogf(CONSOLE_ERROR, "Replay: the recording could not be written in full");
+
+	free(rec->records.data);
+	free(rec->keyframe.data);
+	free(rec->journal.changes);
+	memset(rec, 0, sizeof(ReplayRecorder));
+	return ok;
+}
+
+// Reading -------------------------------------------------------------------
+
+static bool Has(const Replay* replay, size_t size) {
+	return replay->position + size <= replay->end;
+}
+
+static unsigned char GetU8(Replay* replay) {
+	return replay->data[replay->position++];
+}
+
+static float GetF32(Replay* replay) {
+	const unsigned char* p = replay->data + replay->position;
+	unsigned int bits = (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+	replay->position += 4;
+	float v;
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+static unsigned long long GetU64(Replay* replay) {
+	unsigned long long v = 0;
+	for (int i = 0; i < 8; i++) v |= (unsigned long long)replay->data[replay->position + i] << (i * 8);
+	replay->position += 8;
+	return v;
+}
+
+static bool GetVarint(Replay* replay, unsigned long long* v) {
+	*v = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (!Has(replay, 1)) return false;
+		unsigned char byte = GetU8(replay);
+		*v |= (unsigned long long)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+static Rectangle GetRect(Replay* replay) {
+	Rectangle rect;
+	rect.x = GetF32(replay);
+	rect.y = GetF32(replay);
+	rect.width = GetF32(replay);
+	rect.height = GetF32(replay);
+	return rect;
+}
+
+static Color GetColor(Replay* replay) {
+	Color color;
+	color.r = GetU8(replay);
+	color.g = GetU8(replay);
+	color.b = GetU8(replay);
+	color.a = GetU8(replay);
+	return color;
+}
+
+// Fixed part of a keyframe, up to its high water.
+static size_t KeyframeFixedBytes(const Replay* replay) {
+	return 4 * 5 + 2 + 4 * 2 + ((replay->version >= 2) ? 8 : 0);
+}
+
+static bool DecodeKeyframe(Replay* replay, size_t end, WorldState* state) {
+	if (replay->position + KeyframeFixedBytes(replay) > end) return false;
+
+	float step = GetF32(replay);
+	Player player = { 0 };
+	player.position.x = GetF32(replay);
+	player.position.y = GetF32(replay);
+	player.velocity.x = GetF32(replay);
+	player.velocity.y = GetF32(replay);
+	unsigned char flags = GetU8(replay);
+	player.grounded = (flags & 1) != 0;
+	player.facingRight = (flags & 2) != 0;
+	unsigned char cameraMode = GetU8(replay);
+	Vector2 cameraTarget;
+	cameraTarget.x = GetF32(replay);
+	cameraTarget.y = GetF32(replay);
+	if (replay->version >= 2) replay->position += 8;
+	if (cameraMode > CAM_FREE || !(step > 0.0f)) return false;
+
+	unsigned long long highWater;
+	if (!GetVarint(replay, &highWater) || highWater > end - replay->position) return false;
+
+	// Ids are handed out again in order and the free list is put back as it
+	// was, so blocks placed after the keyframe get the ids they got when the
+	// session was recorded.
+	World* world = &state->world;
+	WorldClear(world);
+	int inactive = 0;
+	for (int id = 0; id < (int)highWater; id++) {
+		if (replay->position >= end) return false;
+		if (GetU8(replay) == 0) {
+			WorldReserveId(world);
+			inactive++;
+			continue;
+		}
+		if (replay->position + 21 > end) return false;
+		Rectangle rect = GetRect(replay);
+		Color color = GetColor(replay);
+		unsigned char shape = GetU8(replay);
+		WorldAdd(world, rect, color, (BlockShape)shape);
+	}
+
+	unsigned long long freeCount;
+	if (!GetVarint(replay, &freeCount) || freeCount != (unsigned long long)inactive) return false;
+	unsigned char* freed = calloc((size_t)(highWater > 0 ? highWater : 1), 1);
+	bool ok = true;
+	for (int i = 0; i < inactive && ok; i++) {
+		unsigned long long id;
+		ok = GetVarint(replay, &id) && id < highWater && !WorldGet(world, (int)id)->active && !freed[id];
+		if (ok) {
+			freed[id] = 1;
+			WorldFreeId(world, (int)id);
+		}
+	}
+	free(freed);
+	if (!ok) return false;
+
+	state->player = player;
+	state->cameraMode = (GameCameraMode)cameraMode;
+	state->cameraTarget = cameraTarget;
+	state->events = 0;
+	replay->step = step;
+	return true;
+}
+
+static bool SameKeyframe(Replay* replay, size_t end, const WorldState* state) {
+	if (replay->position + KeyframeFixedBytes(replay) > end) return false;
+
+	replay->position += 4;
+	Vector2 position, velocity, cameraTarget;
+	position.x = GetF32(replay);
+	position.y = GetF32(replay);
+	velocity.x = GetF32(replay);
+	velocity.y = GetF32(replay);
+	replay->position += 2;
+	cameraTarget.x = GetF32(replay);
+	cameraTarget.y = GetF32(replay);
+	bool sameBlocks = (replay->version < 2) || GetU64(replay) == HashBlocks(&state->world);
+
+	unsigned long long highWater;
+	if (!GetVarint(replay, &highWater)) return false;
+
+	return memcmp(&position, &state->player.position, sizeof(Vector2)) == 0 &&
+		memcmp(&velocity, &state->player.velocity, sizeof(Vector2)) == 0 &&
+		memcmp(&cameraTarget, &state->cameraTarget, sizeof(Vector2)) == 0 &&
+		highWater == (unsigned long long)state->world.highWater && sameBlocks;
+}
+
+static bool ReadInput(Replay* replay) {
+	if (!Has(replay, 1)) return false;
+	unsigned char fields = GetU8(replay);
+	InputFrame* input = &replay->input;
+
+	if (fields & FIELD_BUTTONS) {
+		if (!Has(replay, 1)) return false;
+		unsigned char buttons = GetU8(replay);
+		input->left = (buttons & BUTTON_LEFT) != 0;
+		input->right = (buttons & BUTTON_RIGHT) != 0;
+		input->up = (buttons & BUTTON_UP) != 0;
+		input->down = (buttons & BUTTON_DOWN) != 0;
+		input->jumpPressed = (buttons & BUTTON_JUMP) != 0;
+		input->resetPressed = (buttons & BUTTON_RESET) != 0;
+		input->placeHeld = (buttons & BUTTON_PLACE) != 0;
+		input->removeHeld = (buttons & BUTTON_REMOVE) != 0;
+	}
+	if (fields & FIELD_MOUSE) {
+		if (!Has(replay, 8)) return false;
+		input->mouseWorld.x = GetF32(replay);
+		input->mouseWorld.y = GetF32(replay);
+	}
+	if (fields & FIELD_COLOR) {
+		if (!Has(replay, 4)) return false;
+		input->blockColor = GetColor(replay);
+	}
+	if (fields & FIELD_SHAPE) {
+		if (!Has(replay, 1)) return false;
+		input->blockShape = (BlockShape)GetU8(replay);
+	}
+	if (fields & FIELD_CHEAT) {
+		if (!Has(replay, 1)) return false;
+		int length = GetU8(replay);
+		if (length >= (int)sizeof(input->cheatCode) || !Has(replay, (size_t)length)) return false;
+		memset(input->cheatCode, 0, sizeof(input->cheatCode));
+		memcpy(input->cheatCode, replay->data + replay->position, (size_t)length);
+		replay->position += (size_t)length;
+	}
+	return true;
+}
+
+// Reads one record. state is NULL while indexing, when only the framing is
+// checked. restore forces a periodic keyframe to be decoded rather than
+// skipped. Returns false at the end or at the first incomplete record.
+static bool ReadRecord(Replay* replay, WorldState* state, bool restore) {
+	if (!Has(replay, 1)) return false;
+	size_t start = replay->position;
+	unsigned char tag = GetU8(replay);
+
+	switch (tag) {
+	case REC_KEYFRAME: {
+		if (!Has(replay, 1)) return false;
+		unsigned char kind = GetU8(replay);
+		unsigned long long tick, bytes;
+		if (!GetVarint(replay, &tick) || !GetVarint(replay, &bytes) || bytes > replay->end - replay->position) return false;
+		size_t end = replay->position + (size_t)bytes;
+
+		if (state == NULL) {
+			if (replay->position + 4 > end) return false;
+			replay->step = GetF32(replay);
+			replay->keyframes = realloc(replay->keyframes, (size_t)(replay->keyframeCount + 1) * sizeof(ReplayKeyframe));
+			replay->keyframes[replay->keyframeCount++] = (ReplayKeyframe){ tick, start, kind == KEYFRAME_RELOAD };
+		}
+		else if (restore || kind == KEYFRAME_RELOAD) {
+			if (!DecodeKeyframe(replay, end, state)) return false;
+		}
+		else if (replay->verify) {
+			if (!SameKeyframe(replay, end, state)) replay->desyncs++;
+		}
+
+		replay->position = end;
+		memset(&replay->input, 0, sizeof(InputFrame));
+		return true;
+	}
+	case REC_INPUT:
+		if (!ReadInput(replay)) return false;
+		replay->repeat = 1;
+		return true;
+	case REC_REPEAT:
+		return GetVarint(replay, &replay->repeat);
+	case REC_STEP:
+		if (!Has(replay, 4)) return false;
+		replay->step = GetF32(replay);
+		return replay->step > 0.0f;
+	case REC_CAMERA: {
+		if (!Has(replay, 1)) return false;
+		unsigned char mode = GetU8(replay);
+		if (mode > CAM_FREE) return false;
+		if (state != NULL) state->cameraMode = (GameCameraMode)mode;
+		return true;
+	}
+	case REC_ADD: {
+		if (!Has(replay, 21)) return false;
+		Rectangle rect = GetRect(replay);
+		Color color = GetColor(replay);
+		unsigned char shape = GetU8(replay);
+		if (state != NULL) WorldAdd(&state->world, rect, color, (BlockShape)shape);
+		return true;
+	}
+	case REC_REMOVE: {
+		unsigned long long id;
+		if (!GetVarint(replay, &id)) return false;
+		if (state != NULL) {
+			if (id >= (unsigned long long)state->world.highWater) return false;
+			WorldRemove(&state->world, (int)id);
+		}
+		return true;
+	}
+	case REC_CLEAR:
+		if (state != NULL) WorldClear(&state->world);
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool ReplayOpen(Replay* replay, const char* fileName) {
+	memset(replay, 0, sizeof(Replay));
+
+	FILE* file = fopen(fileName, "rb");
+	if (file == NULL) return false;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size < REPLAY_HEADER_BYTES) {
+		fclose(file);
+		return false;
+	}
+
+	replay->data = malloc((size_t)size);
+	replay->size = (size_t)size;
+	replay->end = replay->size;
+	bool read = fread(replay->data, 1, replay->size, file) == replay->size;
+	fclose(file);
+
+	const unsigned char* h = replay->data;
+	if (read) replay->version = h[4] | (h[5] << 8);
+	if (!read || memcmp(h, REPLAY_MAGIC, 4) != 0 || replay->version < 1 || replay->version > REPLAY_VERSION) {
+		ReplayClose(replay);
+		return false;
+	}
+	replay->tickRate = h[8] | (h[9] << 8);
+
+	// One pass over the records finds the keyframes and the length. A file
+	// that ends early is cut back to its last complete record.
+	replay->position = REPLAY_HEADER_BYTES;
+	bool ended = false;
+	float step = 0.0f;
+	while (true) {
+		size_t start = replay->position;
+		if (Has(replay, 1) && replay->data[start] == REC_END) {
+			ended = true;
+			break;
+		}
+		if (!ReadRecord(replay, NULL, false)) {
+			replay->position = start;
+			break;
+		}
+		if (replay->data[start] == REC_KEYFRAME) {
+			replay->keyframes[replay->keyframeCount - 1].tick = replay->tickCount;
+			if (replay->keyframeCount == 1) step = replay->step;
+		}
+		replay->tickCount += replay->repeat;
+		replay->duration += replay->repeat * (double)replay->step;
+		replay->repeat = 0;
+	}
+	replay->end = replay->position;
+	replay->truncated = !ended;
+
+	if (replay->keyframeCount == 0 || replay->keyframes[0].offset != REPLAY_HEADER_BYTES) {
+		ReplayClose(replay);
+		return false;
+	}
+
+	replay->step = step;
+	replay->position = REPLAY_HEADER_BYTES;
+	replay->tick = 0;
+	return true;
+}
+
+void ReplayClose(Replay* replay) {
+	free(replay->data);
+	free(replay->keyframes);
+	memset(replay, 0, sizeof(Replay));
+}
+
+bool ReplaySeek(Replay* replay, WorldState* state, unsigned long long tick) {
+	if (tick > replay->tickCount) return false;
+
+	int k = 0;
+	for (int i = 1; i < replay->keyframeCount && replay->keyframes[i].tick <= tick; i++) k = i;
+
+	replay->position = replay->keyframes[k].offset;
+	replay->tick = replay->keyframes[k].tick;
+	replay->repeat = 0;
+	if (!ReadRecord(replay, state, true)) return false;
+
+	while (replay->tick < tick) {
+		if (!ReplayStep(replay, state)) return false;
+	}
+	return true;
+}
+
+bool ReplayStep(Replay* replay, WorldState* state) {
+	while (replay->repeat == 0) {
+		if (!ReadRecord(replay, state, false)) return false;
+	}
+
+	replay->repeat--;
+	SimStep(state, &replay->input, replay->step);
+	replay->tick++;
+	return true;
+}
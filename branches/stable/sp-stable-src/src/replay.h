@@ -0,0 +1,125 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game.h"
+#include "world.h"
+#include "sim.h"
+#include <stdio.h>
+
+// Session recordings that re-simulate tick for tick. The simulation has no
+// randomness, so a replay is the world as it was when recording started
+// plus everything SimStep was handed afterwards:
+//
+//   header    "SRPL", u16 version, u16 flags, u16 tick rate when recorded
+//   records   u8 tag, then
+//     keyframe  u8 kind, varint tick, varint bytes, then f32 step, f32
+//               player x/y and velocity x/y, u8 grounded | facing << 1,
+//               u8 camera mode, f32 camera x/y, u64 block hash (since
+//               version 2), varint high water, per id
+//               u8 active and for active ids f32 x,y,w,h, u8 r,g,b,a, shape,
+//               then varint free count and the free ids in order
+//     input     u8 changed fields, then those fields: u8 buttons, f32 mouse
+//               x/y, u8 r,g,b,a, u8 shape, u8 length and the cheat code;
+//               runs one tick
+//     repeat    varint n; runs n more ticks with the same input
+//     step      f32 seconds per tick from here on
+//     camera    u8 camera mode
+//     add       f32 x,y,w,h, u8 r,g,b,a, shape: a block added between ticks
+//     remove    varint id
+//     clear
+//     end
+//
+// Input fields are stored only when they differ from the previous tick, and
+// a keyframe resets that to an empty InputFrame. Keyframes are written every
+// REPLAY_KEYFRAME_SECONDS of simulated time, so playback can start near any
+// tick, and whenever the world was replaced outside the simulation (a load).
+// Block changes made outside the simulation, such as the pager bringing a
+// chunk in, are caught by a WorldJournal and stored before the tick they
+// precede. Weather and anything else that only affects drawing is not
+// recorded. A recording cut short by a crash is still playable up to its
+// last complete record. The block hash covers the id, rect, colour and
+// shape of every active block, so verifying a periodic keyframe catches a
+// world that drifted without decoding it; version 1 files have none and are
+// verified on the player and camera alone.
+
+#define REPLAY_MAGIC "SRPL"
+#define REPLAY_VERSION 2
+#define REPLAY_KEYFRAME_SECONDS 10.0f
+
+typedef struct {
+	unsigned char* data;
+	size_t length;
+	size_t capacity;
+} ReplayBuffer;
+
+typedef struct {
+	FILE* file;
+	ReplayBuffer records;
+	ReplayBuffer keyframe;
+
+	WorldJournal journal;
+	InputFrame last;
+	unsigned long long pendingRepeat;
+	unsigned long long tick;
+	float step;
+	GameCameraMode cameraMode;
+	float sinceKeyframe;
+	int keyframes;
+	bool failed;
+} ReplayRecorder;
+
+typedef struct {
+	unsigned long long tick;
+	size_t offset;
+	bool reload;
+} ReplayKeyframe;
+
+typedef struct {
+	unsigned char* data;
+	size_t size;
+	size_t position;
+	size_t end;
+
+	int version;
+	int tickRate;
+	float step;
+	unsigned long long tick;
+	unsigned long long tickCount;
+	double duration;
+
+	ReplayKeyframe* keyframes;
+	int keyframeCount;
+
+	InputFrame input;
+	unsigned long long repeat;
+	bool truncated;
+	// Periodic keyframes that did not match the re-simulated state. Only
+	// counted when verify is set.
+	bool verify;
+	int desyncs;
+} Replay;
+
+// Writes the first keyframe from state and starts catching block changes
+// made to state->world between ticks.
+bool ReplayStartRecording(ReplayRecorder* rec, const char* fileName, WorldState* state, int tickRate);
+// Records one tick and runs it. Use in place of SimStep while recording.
+void ReplayRecordStep(ReplayRecorder* rec, WorldState* state, const InputFrame* input, float dt);
+// Returns false if anything failed to write.
+bool ReplayStopRecording(ReplayRecorder* rec, WorldState* state);
+
+static inline bool ReplayIsRecording(const ReplayRecorder* rec) {
+	return rec->file != NULL;
+}
+
+// Reads the whole file and indexes its keyframes. The replay is positioned
+// before its first tick; call ReplaySeek to put a state there.
+bool ReplayOpen(Replay* replay, const char* fileName);
+void ReplayClose(Replay* replay);
+// Restores state from the nearest keyframe at or before tick and plays on
+// from there. state must have been set up with SimInit. Returns false if the
+// replay is shorter than tick.
+bool ReplaySeek(Replay* replay, WorldState* state, unsigned long long tick);
+// Runs the next recorded tick. Returns false at the end of the replay.
+bool ReplayStep(Replay* replay, WorldState* state);
+
+#endif
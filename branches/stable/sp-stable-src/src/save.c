@@ -0,0 +1,305 @@
+#include "save.h"
+#include "level.h"
+#include "pager.h"
+#include "console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+typedef enum { LEVEL_JOB_NONE, LEVEL_JOB_SAVE, LEVEL_JOB_LOAD } LevelJobType;
+
+// One save or load running on a worker thread. The worker only touches the
+// fields below; everything that talks to the game happens in UpdateLevelJobs
+// on the main thread.
+typedef struct {
+	LevelJobType type;
+	pthread_t thread;
+	char fileName[256];
+
+	World world;
+	LevelInfo info;
+	PagerSource* source;
+	bool legacy;
+	bool ok;
+
+	atomic_int progress;
+	atomic_bool finished;
+
+	double startTime;
+	int reportedQuarter;
+} LevelJob;
+
+static LevelJob job = { 0 };
+
+// Reads a level.dat written before the versioned format: a GameData header
+// followed by raw Block records.
+static bool LoadLegacyLevel(const char* fileName, LevelInfo* info, World* world) {
+	unsigned int bytesRead = 0;
+	unsigned char* fileData = LoadFileData(fileName, &bytesRead);
+	if (fileData == NULL) return false;
+
+	GameData data = { 0 };
+	if (bytesRead >= sizeof(GameData)) memcpy(&data, fileData, sizeof(GameData));
+
+	bool loaded = bytesRead >= sizeof(GameData) && data.activeBlocksCount >= 0 &&
+		(bytesRead - sizeof(GameData)) / sizeof(Block) >= (unsigned int)data.activeBlocksCount;
+
+	if (loaded) {
+		info->playerPos = data.playerPos;
+		info->isNight = data.isNightState;
+		info->weather = data.weatherType;
+		info->playerColor = data.playerColor;
+		info->blockColor = data.blockColor;
+		info->blockShape = data.blockShape;
+		if (!LevelInfoValid(info)) loaded = false;
+
+		const Block* savedBlocks = (const Block*)(fileData + sizeof(GameData));
+		for (int i = 0; i < data.activeBlocksCount && loaded; i++) {
+			Block b;
+			memcpy(&b, &savedBlocks[i], sizeof(Block));
+			if (!LevelRectValid(b.rect)) loaded = false;
+			else WorldAdd(world, b.rect, b.color, b.shape);
+		}
+	}
+
+	UnloadFileData(fileData);
+	return loaded;
+}
+
+// Writes next to the target and renames over it, so a crash or a full disk
+// never leaves a half-written level.dat behind.
+static bool WriteLevelFile(const char* fileName, const LevelInfo* info, const World* world, const PagerSource* source, atomic_int* progress) {
+	char tempName[300];
+	snprintf(tempName, sizeof(tempName), "%s.tmp", fileName);
+
+	FILE* file = fopen(tempName, "wb");
+	if (file == NULL) return false;
+
+	bool ok = LevelWrite(file, info, world, (source != NULL) ? &source->source : NULL, progress);
+	if (ok && (fflush(file) != 0 || fsync(fileno(file)) != 0)) ok = false;
+	if (fclose(file) != 0) ok = false;
+
+	if (ok && rename(tempName, fileName) != 0) ok = false;
+	if (!ok) remove(tempName);
+	return ok;
+}
+
+static bool ReadLevelFile(const char* fileName, LevelInfo* info, World* world, bool* legacy, atomic_int* progress) {
+	*legacy = false;
+	FILE* file = fopen(fileName, "rb");
+	if (file == NULL) return false;
+
+	*legacy = !LevelIsCurrentFormat(file);
+	if (*legacy) {
+		fclose(file);
+		return LoadLegacyLevel(fileName, info, world);
+	}
+
+	bool ok = LevelRead(file, info, world, progress);
+	fclose(file);
+	return ok;
+}
+
+static void ApplyInfo(const LevelInfo* info, Player* player, int* isNight, WeatherType* weather, int* playerColorIndex, int* selectedColorIndex, int* selectedShapeIndex) {
+	player->position = info->playerPos;
+	player->velocity = (Vector2){ 0, 0 };
+	player->grounded = false;
+
+	*isNight = info->isNight;
+	*weather = info->weather;
+	*playerColorIndex = info->playerColor;
+	*selectedColorIndex = info->blockColor;
+	*selectedShapeIndex = info->blockShape;
+}
+
+static void ApplyLevel(const LevelInfo* info, World* loaded, Player* player, World* world, int* isNight, WeatherType* weather, int* playerColorIndex, int* selectedColorIndex, int* selectedShapeIndex) {
+	WorldFree(world);
+	*world = *loaded;
+	ApplyInfo(info, player, isNight, weather, playerColorIndex, selectedColorIndex, selectedShapeIndex);
+}
+
+bool SaveGame(const char* fileName, const Player* player, const World* world, int isNight, WeatherType weather, int playerColorIndex, int selectedColorIndex, int selectedShapeIndex) {
+	LevelInfo info = { player->position, isNight, weather, playerColorIndex, selectedColorIndex, selectedShapeIndex };
+	bool saved = WriteLevelFile(fileName, &info, world, NULL, NULL);
+
+	if (saved) {
+		AddConsoleLogf(CONSOLE_INFO, "Game saved successfully: %d blocks", world->activeCount);
+	}
+	else {
+		AddConsoleLogf(CONSOLE_ERROR, "Error saving game data!");
+	}
+	return saved;
+}
+
+bool LoadGame(const char* fileName, Player* player, World* world, int* isNight, WeatherType* weather, int* playerColorIndex, int* selectedColorIndex, int* selectedShapeIndex) {
+	if (!FileExists(fileName)) {
+		AddConsoleLogf(CONSOLE_ERROR, "Load failed: %s not found", fileName);
+		return false;
+	}
+
+	// Decode into a separate world so a bad file leaves the current one alone.
+	LevelInfo info = { 0 };
+	World loaded;
+	WorldInit(&loaded);
+
+	bool legacy = false;
+	if (!ReadLevelFile(fileName, &info, &loaded, &legacy, NULL)) {
+		WorldFree(&loaded);
+		AddConsoleLogf(CONSOLE_ERROR, legacy ? "Load failed: Legacy level file is truncated or corrupt" : "Load failed: Corrupt or unsupported level file");
+		return false;
+	}
+
+	ApplyLevel(&info, &loaded, player, world, isNight, weather, playerColorIndex, selectedColorIndex, selectedShapeIndex);
+
+	if (legacy) AddConsoleLog("Legacy level format migrated, next save uses the new format");
+	AddConsoleLogf(CONSOLE_INFO, "Game loaded successfully: %d blocks", world->activeCount);
+	return true;
+}
+
+static void* LevelJobThread(void* arg) {
+	LevelJob* j = arg;
+	if (j->type == LEVEL_JOB_SAVE) {
+		j->ok = WriteLevelFile(j->fileName, &j->info, &j->world, j->source, &j->progress);
+	}
+	else {
+		j->ok = ReadLevelFile(j->fileName, &j->info, &j->world, &j->legacy, &j->progress);
+	}
+	atomic_store(&j->finished, true);
+	return NULL;
+}
+
+static bool StartLevelJob(LevelJobType type, const char* fileName) {
+	job.type = type;
+	snprintf(job.fileName, sizeof(job.fileName), "%s", fileName);
+	job.legacy = false;
+	job.ok = false;
+	atomic_store(&job.progress, 0);
+	atomic_store(&job.finished, false);
+	job.startTime = GetTime();
+	job.reportedQuarter = 0;
+
+	if (pthread_create(&job.thread, NULL, LevelJobThread, &job) != 0) {
+		WorldFree(&job.world);
+		PagerSourceFree(job.source);
+		job.source = NULL;
+		job.type = LEVEL_JOB_NONE;
+		AddConsoleLogf(CONSOLE_ERROR, "Error: could not start level worker thread");
+		return false;
+	}
+	return true;
+}
+
+bool LevelJobBusy(void) {
+	return job.type != LEVEL_JOB_NONE;
+}
+
+bool SaveGameAsync(const char* fileName, const Player* player, const World* world, PagerSource* source, int isNight, WeatherType weather, int playerColorIndex, int selectedColorIndex, int selectedShapeIndex) {
+	if (LevelJobBusy()) {
+		PagerSourceFree(source);
+		AddConsoleLogf(CONSOLE_WARNING, "Busy: wait for the current save/load to finish");
+		return false;
+	}
+
+	job.info = (LevelInfo){ player->position, isNight, weather, playerColorIndex, selectedColorIndex, selectedShapeIndex };
+	WorldCopy(&job.world, world);
+	job.source = source;
+
+	if (!StartLevelJob(LEVEL_JOB_SAVE, fileName)) return false;
+	AddConsoleLogf(CONSOLE_INFO, "Saving %s in the background (%d blocks)...", fileName, world->activeCount);
+	return true;
+}
+
+bool LoadGameAsync(const char* fileName) {
+	if (LevelJobBusy()) {
+		AddConsoleLogf(CONSOLE_WARNING, "Busy: wait for the current save/load to finish");
+		return false;
+	}
+	if (!FileExists(fileName)) {
+		AddConsoleLogf(CONSOLE_ERROR, "Load failed: %s not found", fileName);
+		return false;
+	}
+
+	memset(&job.info, 0, sizeof(job.info));
+	WorldInit(&job.world);
+	job.source = NULL;
+
+	if (!StartLevelJob(LEVEL_JOB_LOAD, fileName)) return false;
+	AddConsoleLogf(CONSOLE_INFO, "Loading %s in the background...", fileName);
+	return true;
+}
+
+bool UpdateLevelJobs(Player* player, World* world, int* isNight, WeatherType* weather, int* playerColorIndex, int* selectedColorIndex, int* selectedShapeIndex) {
+	if (!LevelJobBusy()) return false;
+
+	const char* verb = (job.type == LEVEL_JOB_SAVE) ? "Saving" : "Loading";
+	if (!atomic_load(&job.finished)) {
+		int quarter = atomic_load(&job.progress) / 250;
+		if (quarter > job.reportedQuarter && quarter < 4) {
+			job.reportedQuarter = quarter;
+			AddConsoleLogf(CONSOLE_INFO, "%s %s: %d%%", verb, job.fileName, quarter * 25);
+		}
+		return false;
+	}
+
+	pthread_join(job.thread, NULL);
+	double ms = (GetTime() - job.startTime) * 1000.0;
+	bool applied = false;
+
+	if (job.type == LEVEL_JOB_SAVE) {
+		if (job.ok) AddConsoleLogf(CONSOLE_INFO, "Game saved successfully: %d blocks (%.0f ms)", job.world.activeCount, ms);
+		else AddConsoleLogf(CONSOLE_ERROR, "Error saving game data!");
+		WorldFree(&job.world);
+		PagerSourceFree(job.source);
+		job.source = NULL;
+	}
+	else if (job.ok) {
+		ApplyLevel(&job.info, &job.world, player, world, isNight, weather, playerColorIndex, selectedColorIndex, selectedShapeIndex);
+		if (job.legacy) AddConsoleLog("Legacy level format migrated, next save uses the new format");
+		AddConsoleLogf(CONSOLE_INFO, "Game loaded successfully: %d blocks (%.0f ms)", world->activeCount, ms);
+		applied = true;
+	}
+	else {
+		WorldFree(&job.world);
+		AddConsoleLogf(CONSOLE_ERROR, job.legacy ? "Load failed: Legacy level file is truncated or corrupt" : "Load failed: Corrupt or unsupported level file");
+	}
+
+	job.type = LEVEL_JOB_NONE;
+	return applied;
+}
+
+void FinishLevelJobs(void) {
+	if (!LevelJobBusy()) return;
+
+	pthread_join(job.thread, NULL);
+	WorldFree(&job.world);
+	PagerSourceFree(job.source);
+	job.source = NULL;
+	job.type = LEVEL_JOB_NONE;
+}
+
+bool IsStreamableLevel(const char* fileName) {
+	FILE* file = fopen(fileName, "rb");
+	if (file == NULL) return false;
+	bool current = LevelIsCurrentFormat(file);
+	fclose(file);
+	return current;
+}
+
+bool StreamGame(const char* fileName, LevelPager* pager, int budgetMB, Player* player, World* world, int* isNight, WeatherType* weather, int* playerColorIndex, int* selectedColorIndex, int* selectedShapeIndex) {
+	if (LevelJobBusy()) {
+		AddConsoleLogf(CONSOLE_WARNING, "Busy: wait for the current save/load to finish");
+		return false;
+	}
+
+	LevelInfo info = { 0 };
+	if (!PagerOpen(pager, fileName, world, &info, (long long)budgetMB * 1024 * 1024)) {
+		AddConsoleLogf(CONSOLE_ERROR, "Load failed: Corrupt or unsupported level file");
+		return false;
+	}
+
+	ApplyInfo(&info, player, isNight, weather, playerColorIndex, selectedColorIndex, selectedShapeIndex);
+	return true;
+}
@@ -0,0 +1,47 @@
+#ifndef SAVE_H
+#define SAVE_H
+
+#include "game.h"
+#include "world.h"
+#include "pager.h"
+
+// level.dat is written in the versioned format from level.h. Older builds
+// wrote a GameData header followed by activeBlocksCount Block records (or a
+// full array of 2000 before the block cap was removed); LoadGame still reads
+// those and the next save upgrades them.
+
+typedef struct {
+	Vector2 playerPos;
+	bool isNightState;
+	WeatherType weatherType;
+	int playerColor;
+	int blockColor;
+	int blockShape;
+	int activeBlocksCount;
+} GameData;
+
+bool SaveGame(const char* fileName, const Player* player, const World* world, int isNight, WeatherType weather, int playerColorIndex, int selectedColorIndex, int selectedShapeIndex);
+bool LoadGame(const char* fileName, Player* player, World* world, int* isNight, WeatherType* weather, int* playerColorIndex, int* selectedColorIndex, int* selectedShapeIndex);
+
+// Background versions for the game loop. A save snapshots the world and
+// writes it on a worker thread; a load decodes on a worker and is swapped in
+// by UpdateLevelJobs, which the main loop calls once per frame and which
+// returns true on the frame a load lands. Only one job runs at a time.
+// source is the PagerSnapshot of a streamed world (or NULL); the job takes
+// ownership of it.
+bool SaveGameAsync(const char* fileName, const Player* player, const World* world, PagerSource* source, int isNight, WeatherType weather, int playerColorIndex, int selectedColorIndex, int selectedShapeIndex);
+bool LoadGameAsync(const char* fileName);
+bool UpdateLevelJobs(Player* player, World* world, int* isNight, WeatherType* weather, int* playerColorIndex, int* selectedColorIndex, int* selectedShapeIndex);
+bool LevelJobBusy(void);
+// Waits for a running job and drops its result. Used on shutdown.
+void FinishLevelJobs(void);
+
+// Levels in the current format can also be played without loading them
+// whole: StreamGame hands the file to the pager, which brings chunks in
+// around the camera. Opening is synchronous but only reads the chunk table.
+// budgetMB is the memory the streamed world may hold before chunks are
+// evicted, PAGER_DEFAULT_BUDGET_MB unless given on the command line.
+bool IsStreamableLevel(const char* fileName);
+bool StreamGame(const char* fileName, LevelPager* pager, int budgetMB, Player* player, World* world, int* isNight, WeatherType* weather, int* playerColorIndex, int* selectedColorIndex, int* selectedShapeIndex);
+
+#endif
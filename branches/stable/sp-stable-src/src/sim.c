@@ -0,0 +1,202 @@
+#include "sim.h"
+#include "console.h"
+#include <string.h>
+
+#define MAX_GRID_HITS 256
+
+static void UpdateCheatState(WorldState* state, const char* cheatCode) {
+	state->cheatFly = false;
+	state->cheatInfJump = false;
+	state->cheatNoClip = false;
+
+	if (strcmp(cheatCode, "29103") == 0) state->cheatFly = true;
+	if (strcmp(cheatCode, "84721") == 0) state->cheatInfJump = true;
+	if (strcmp(cheatCode, "112233") == 0) state->cheatNoClip = true;
+}
+
+void ResetPlayer(Player* player, Block startPlatform) {
+	player->position = (Vector2){ startPlatform.rect.x + 50, startPlatform.rect.y - 100 };
+	player->velocity = (Vector2){ 0, 0 };
+	player->facingRight = true;
+	AddConsoleLog("Player position reset");
+}
+
+void ResetGame(Player* player, World* world) {
+	Block base = *WorldGet(world, 0);
+	WorldClear(world);
+	if (base.active) WorldAdd(world, base.rect, base.color, base.shape);
+	ResetPlayer(player, base);
+	AddConsoleLog("Game map reset");
+}
+
+void SimClockInit(SimClock* clock, int tickRate) {
+	clock->tickRate = tickRate;
+	clock->step = 1.0f / (float)tickRate;
+	clock->accumulator = 0.0;
+	clock->ticks = 0;
+}
+
+void SimClockSetRate(SimClock* clock, int tickRate) {
+	float alpha = SimClockAlpha(clock);
+	clock->tickRate = tickRate;
+	clock->step = 1.0f / (float)tickRate;
+	clock->accumulator = alpha * clock->step;
+}
+
+int SimClockAdvance(SimClock* clock, float frameTime) {
+	if (frameTime > SIM_MAX_FRAME_TIME) frameTime = SIM_MAX_FRAME_TIME;
+	if (frameTime < 0.0f) frameTime = 0.0f;
+	clock->accumulator += frameTime;
+
+	int ticks = (int)(clock->accumulator / clock->step);
+	clock->accumulator -= ticks * (double)clock->step;
+	clock->ticks += (unsigned long long)ticks;
+	return ticks;
+}
+
+float SimClockAlpha(const SimClock* clock) {
+	float alpha = (float)(clock->accumulator / clock->step);
+	return (alpha > 1.0f) ? 1.0f : alpha;
+}
+
+void SimInit(WorldState* state) {
+	memset(state, 0, sizeof(WorldState));
+
+	WorldInit(&state->world);
+	WorldAdd(&state->world, (Rectangle){ -200, 300, 800, 40 }, GRAY, SHAPE_RECT);
+
+	ResetPlayer(&state->player, *WorldGet(&state->world, 0));
+	state->cameraTarget = state->player.position;
+	state->cameraMode = CAM_SMOOTH;
+}
+
+void SimFree(WorldState* state) {
+	WorldFree(&state->world);
+}
+
+void SimStep(WorldState* state, const InputFrame* input, float dt) {
+	Player* player = &state->player;
+	World* world = &state->world;
+	int gridHits[MAX_GRID_HITS];
+
+	state->events = 0;
+	UpdateCheatState(state, input->cheatCode);
+
+	if (input->resetPressed) {
+		ResetGame(player, world);
+		state->events |= SIM_EVENT_RESET;
+	}
+
+	if (state->cameraMode == CAM_FREE || state->cheatFly) {
+		float moveSpeed = (state->cheatFly) ? PLAYER_SPEED * 1.5f : FREE_CAM_SPEED;
+		float dtSpeed = moveSpeed * dt;
+
+		Vector2* targetPos = (state->cheatFly) ? &player->position : &state->cameraTarget;
+
+		if (input->right) targetPos->x += dtSpeed;
+		if (input->left) targetPos->x -= dtSpeed;
+		if (input->up) targetPos->y -= dtSpeed;
+		if (input->down) targetPos->y += dtSpeed;
+
+		player->velocity = (Vector2){ 0, 0 };
+		if (state->cheatFly) state->cameraTarget = player->position;
+	}
+	else {
+		float currentSpeed = PLAYER_SPEED;
+		if (input->down) currentSpeed = PLAYER_RUN_SPEED;
+
+		if (input->right) {
+			player->velocity.x = currentSpeed;
+			player->facingRight = true;
+		}
+		else if (input->left) {
+			player->velocity.x = -currentSpeed;
+			player->facingRight = false;
+		}
+		else {
+			player->velocity.x = 0;
+		}
+
+		if (input->jumpPressed) {
+			if (player->grounded || state->cheatInfJump) {
+				player->velocity.y = -JUMP_FORCE;
+				player->grounded = false;
+			}
+		}
+
+		player->velocity.y += GRAVITY * dt;
+	}
+
+	if (!state->cheatFly) {
+		if (player->velocity.y > MAX_FALL_SPEED) player->velocity.y = MAX_FALL_SPEED;
+		player->position.x += player->velocity.x * dt;
+	}
+
+	Rectangle playerRect = { player->position.x, player->position.y, 40, 40 };
+
+	if (!state->cheatNoClip) {
+		const Rectangle* hits;
+		int hitCount = WorldCollide(world, playerRect, &hits);
+		for (int h = 0; h < hitCount; h++) {
+			Rectangle hit = hits[h];
+			if (player->velocity.x > 0) player->position.x = hit.x - playerRect.width;
+			else if (player->velocity.x < 0) player->position.x = hit.x + hit.width;
+		}
+	}
+
+	if (!state->cheatFly) {
+		player->position.y += player->velocity.y * dt;
+	}
+
+	player->grounded = false;
+	playerRect.x = player->position.x;
+	playerRect.y = player->position.y;
+
+	if (!state->cheatNoClip) {
+		const Rectangle* hits;
+		int hitCount = WorldCollide(world, playerRect, &hits);
+		for (int h = 0; h < hitCount; h++) {
+			Rectangle hit = hits[h];
+			if (player->velocity.y > 0) {
+				player->position.y = hit.y - playerRect.height;
+				player->velocity.y = 0;
+				player->grounded = true;
+			}
+			else if (player->velocity.y < 0) {
+				player->position.y = hit.y + hit.height;
+				player->velocity.y = 0;
+			}
+		}
+	}
+
+	if (player->position.y > 2000 && !state->cheatFly) {
+		ResetPlayer(player, *WorldGet(world, 0));
+		AddConsoleLog("Player died in void");
+		state->events |= SIM_EVENT_DIED;
+	}
+
+	if (state->cameraMode == CAM_SMOOTH && !state->cheatFly) {
+		state->cameraTarget.x += (player->position.x - state->cameraTarget.x) * 5.0f * dt;
+		state->cameraTarget.y += (player->position.y - state->cameraTarget.y) * 5.0f * dt;
+	}
+
+	Vector2 mouseWorldPos = input->mouseWorld;
+	int gridX = (int)((mouseWorldPos.x < 0) ? (mouseWorldPos.x - BLOCK_SIZE) : mouseWorldPos.x) / BLOCK_SIZE * BLOCK_SIZE;
+	int gridY = (int)((mouseWorldPos.y < 0) ? (mouseWorldPos.y - BLOCK_SIZE) : mouseWorldPos.y) / BLOCK_SIZE * BLOCK_SIZE;
+	int currentWidth = (input->blockShape == SHAPE_RECT) ? BLOCK_SIZE * 2 : BLOCK_SIZE;
+	state->potentialBlock = (Rectangle){ (float)gridX, (float)gridY, (float)currentWidth, (float)BLOCK_SIZE };
+
+	if (input->placeHeld) {
+		bool freeSpace = !CheckCollisionRecs(state->potentialBlock, playerRect) && !GridOverlaps(&world->grid, state->potentialBlock);
+		if (freeSpace) {
+			WorldAdd(world, state->potentialBlock, input->blockColor, input->blockShape);
+		}
+	}
+
+	if (input->removeHeld) {
+		int hitCount = GridQueryPoint(&world->grid, mouseWorldPos, gridHits, MAX_GRID_HITS);
+		for (int h = 0; h < hitCount; h++) {
+			if (gridHits[h] != 0) WorldRemove(world, gridHits[h]);
+		}
+	}
+}
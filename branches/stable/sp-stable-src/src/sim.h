@@ -0,0 +1,74 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "game.h"
+#include "world.h"
+
+// Game simulation without any window, input or audio dependency. The game
+// loop fills an InputFrame from raylib each frame and hands it to SimStep;
+// tools and benchmarks can drive the same code with scripted input.
+
+#define SIM_EVENT_DIED 0x1
+#define SIM_EVENT_RESET 0x2
+
+#define SIM_TICK_RATE 120
+// Longest frame the clock catches up on; anything beyond is dropped so a
+// stall cannot snowball into ever longer catch-up frames.
+#define SIM_MAX_FRAME_TIME 0.25f
+
+typedef struct {
+	bool left;
+	bool right;
+	bool up;
+	bool down;
+	bool jumpPressed;
+	bool resetPressed;
+	bool placeHeld;
+	bool removeHeld;
+	Vector2 mouseWorld;
+	Color blockColor;
+	BlockShape blockShape;
+	char cheatCode[7];
+} InputFrame;
+
+typedef struct {
+	World world;
+	Player player;
+	Vector2 cameraTarget;
+	GameCameraMode cameraMode;
+
+	bool cheatFly;
+	bool cheatInfJump;
+	bool cheatNoClip;
+
+	Rectangle potentialBlock;
+	unsigned int events;
+} WorldState;
+
+// Accumulates real frame time and hands it out as whole ticks of 1/tickRate
+// seconds, so SimStep always sees the same dt whatever the frame rate. The
+// time left over is the fraction of a tick that rendering should
+// interpolate across.
+typedef struct {
+	int tickRate;
+	float step;
+	double accumulator;
+	unsigned long long ticks;
+} SimClock;
+
+void SimClockInit(SimClock* clock, int tickRate);
+// Keeps the fraction of the current tick that has already passed.
+void SimClockSetRate(SimClock* clock, int tickRate);
+// Returns how many ticks to run this frame.
+int SimClockAdvance(SimClock* clock, float frameTime);
+// 0..1 position between the previous tick and the latest one.
+float SimClockAlpha(const SimClock* clock);
+
+void SimInit(WorldState* state);
+void SimFree(WorldState* state);
+void SimStep(WorldState* state, const InputFrame* input, float dt);
+
+void ResetPlayer(Player* player, Block startPlatform);
+void ResetGame(Player* player, World* world);
+
+#endif
@@ -0,0 +1,193 @@
+#include "watch.h"
+#include "console.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+static double NowSeconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+bool WatcherInit(AssetWatcher* watcher) {
+	memset(watcher, 0, sizeof(*watcher));
+	watcher->wake[0] = watcher->wake[1] = -1;
+	pthread_mutex_init(&watcher->lock, NULL);
+
+	watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watcher->fd < 0) return false;
+	if (pipe(watcher->wake) != 0) {
+		close(watcher->fd);
+		watcher->fd = -1;
+		watcher->wake[0] = watcher->wake[1] = -1;
+		return false;
+	}
+	return true;
+}
+
+void WatcherAdd(AssetWatcher* watcher, const char* fileName, int* sprite) {
+	if (watcher->fd < 0 || watcher->running) return;
+
+	// Editors often save by writing a new file and renaming it over the old
+	// one, so the directory is watched rather than the file itself.
+	char dir[256];
+	snprintf(dir, sizeof(dir), "%s", fileName);
+	char* slash = strrchr(dir, '/');
+	const char* baseName = fileName;
+	if (slash != NULL) {
+		*slash = '\0';
+		baseName = fileName + (slash - dir) + 1;
+	}
+	else {
+		snprintf(dir, sizeof(dir), ".");
+	}
+
+	int wd = inotify_add_watch(watcher->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (wd < 0) {
+		AddConsoleLogf(CONSOLE_WARNING, "Watch: cannot watch %s for changes", dir);
+		return;
+	}
+
+	if (watcher->count == watcher->capacity) {
+		watcher->capacity = (watcher->capacity > 0) ? watcher->capacity * 2 : 32;
+		watcher->files = realloc(watcher->files, (size_t)watcher->capacity * sizeof(WatchedFile));
+	}
+	WatchedFile* file = &watcher->files[watcher->count++];
+	snprintf(file->fileName, sizeof(file->fileName), "%s", fileName);
+	snprintf(file->baseName, sizeof(file->baseName), "%s", baseName);
+	file->wd = wd;
+	file->sprite = sprite;
+	file->due = 0.0;
+}
+
+// Queues a decoded image for the main thread. A reload of the same file that
+// was not picked up yet is dropped for the newer one.
+static void PostReload(AssetWatcher* watcher, const SpriteReload* reload) {
+	pthread_mutex_lock(&watcher->lock);
+	for (int i = 0; i < watcher->readyCount; i++) {
+		if (watcher->ready[i].sprite == reload->sprite) {
+			UnloadImage(watcher->ready[i].image);
+			memmove(&watcher->ready[i], &watcher->ready[i + 1], (size_t)(watcher->readyCount - i - 1) * sizeof(SpriteReload));
+			watcher->readyCount--;
+			break;
+		}
+	}
+	if (watcher->readyCount == watcher->readyCapacity) {
+		watcher->readyCapacity = (watcher->readyCapacity > 0) ? watcher->readyCapacity * 2 : 8;
+		watcher->ready = realloc(watcher->ready, (size_t)watcher->readyCapacity * sizeof(SpriteReload));
+	}
+	watcher->ready[watcher->readyCount++] = *reload;
+	pthread_mutex_unlock(&watcher->lock);
+}
+
+static void DecodeFile(AssetWatcher* watcher, WatchedFile* file) {
+	SpriteReload reload = { 0 };
+	reload.sprite = file->sprite;
+	reload.changedAt = file->due - WATCH_SETTLE_MS / 1000.0;
+	snprintf(reload.fileName, sizeof(reload.fileName), "%s", file->fileName);
+
+	double t0 = NowSeconds();
+	reload.image = LoadImage(file->fileName);
+	if (reload.image.data == NULL) {
+		AddConsoleLogf(CONSOLE_WARNING, "Reload: %s could not be decoded", file->fileName);
+		return;
+	}
+	ImageFormat(&reload.image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+	reload.decodeSeconds = NowSeconds() - t0;
+	PostReload(watcher, &reload);
+}
+
+static void ReadEvents(AssetWatcher* watcher) {
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t n;
+	while ((n = read(watcher->fd, buffer, sizeof(buffer))) > 0) {
+		double due = NowSeconds() + WATCH_SETTLE_MS / 1000.0;
+		for (char* p = buffer; p < buffer + n; ) {
+			const struct inotify_event* event = (const struct inotify_event*)p;
+			p += sizeof(struct inotify_event) + event->len;
+			if (event->len == 0) continue;
+
+			for (int i = 0; i < watcher->count; i++) {
+				WatchedFile* file = &watcher->files[i];
+				if (file->wd == event->wd && strcmp(file->baseName, event->name) == 0) file->due = due;
+			}
+		}
+	}
+}
+
+static void* WatchThread(void* arg) {
+	AssetWatcher* watcher = arg;
+	for (;;) {
+		double now = NowSeconds();
+		int timeout = -1;
+		for (int i = 0; i < watcher->count; i++) {
+			if (watcher->files[i].due <= 0.0) continue;
+			int ms = (int)((watcher->files[i].due - now) * 1000.0) + 1;
+			if (ms < 0) ms = 0;
+			if (timeout < 0 || ms < timeout) timeout = ms;
+		}
+
+		struct pollfd fds[2] = { { watcher->fd, POLLIN, 0 }, { watcher->wake[0], POLLIN, 0 } };
+		if (poll(fds, 2, timeout) < 0 && errno != EINTR) break;
+		if (fds[1].revents != 0) break;
+		if (fds[0].revents & POLLIN) ReadEvents(watcher);
+
+		now = NowSeconds();
+		for (int i = 0; i < watcher->count; i++) {
+			WatchedFile* file = &watcher->files[i];
+			if (file->due > 0.0 && now >= file->due) {
+				DecodeFile(watcher, file);
+				file->due = 0.0;
+			}
+		}
+	}
+	return NULL;
+}
+
+bool WatcherStart(AssetWatcher* watcher) {
+	if (watcher->fd < 0 || watcher->running || watcher->count == 0) return false;
+	if (pthread_create(&watcher->thread, NULL, WatchThread, watcher) != 0) {
+		AddConsoleLogf(CONSOLE_WARNING, "Watch: could not start the watcher thread, hot reload is off");
+		return false;
+	}
+	watcher->running = true;
+	return true;
+}
+
+bool WatcherPoll(AssetWatcher* watcher, SpriteReload* reload) {
+	if (!watcher->running) return false;
+
+	bool found = false;
+	pthread_mutex_lock(&watcher->lock);
+	if (watcher->readyCount > 0) {
+		*reload = watcher->ready[0];
+		memmove(&watcher->ready[0], &watcher->ready[1], (size_t)(watcher->readyCount - 1) * sizeof(SpriteReload));
+		watcher->readyCount--;
+		found = true;
+	}
+	pthread_mutex_unlock(&watcher->lock);
+	return found;
+}
+
+void WatcherFree(AssetWatcher* watcher) {
+	if (watcher->running) {
+		ssize_t written = write(watcher->wake[1], "x", 1);
+		(void)written;
+		pthread_join(watcher->thread, NULL);
+	}
+	for (int i = 0; i < watcher->readyCount; i++) UnloadImage(watcher->ready[i].image);
+	if (watcher->fd >= 0) close(watcher->fd);
+	if (watcher->wake[0] >= 0) close(watcher->wake[0]);
+	if (watcher->wake[1] >= 0) close(watcher->wake[1]);
+	pthread_mutex_destroy(&watcher->lock);
+	free(watcher->files);
+	free(watcher->ready);
+	memset(watcher, 0, sizeof(*watcher));
+	watcher->fd = -1;
+}
@@ -0,0 +1,61 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "raylib.h"
+#include <stdbool.h>
+#include <pthread.h>
+
+// Reloads sprite images while the game runs. The directories of the watched
+// files get an inotify watch; a background thread waits on it, lets a file
+// settle for WATCH_SETTLE_MS after the last write (editors often save in
+// several steps) and decodes it. The main thread picks the decoded images up
+// with WatcherPoll between frames and swaps them into the atlas, so a sprite
+// never changes halfway through drawing.
+
+#define WATCH_SETTLE_MS 100
+
+typedef struct {
+	char fileName[256];
+	char baseName[128];
+	int wd;
+	int* sprite;
+	double due;
+} WatchedFile;
+
+typedef struct {
+	Image image;
+	int* sprite;
+	char fileName[256];
+	double changedAt;
+	double decodeSeconds;
+} SpriteReload;
+
+typedef struct {
+	int fd;
+	int wake[2];
+	pthread_t thread;
+	bool running;
+
+	WatchedFile* files;
+	int count;
+	int capacity;
+
+	pthread_mutex_t lock;
+	SpriteReload* ready;
+	int readyCount;
+	int readyCapacity;
+} AssetWatcher;
+
+// Returns false, leaving a watcher that never reports anything, if inotify
+// is not available.
+bool WatcherInit(AssetWatcher* watcher);
+// Watches fileName for the sprite whose index is kept in *sprite. Files are
+// added before WatcherStart; the file need not exist yet.
+void WatcherAdd(AssetWatcher* watcher, const char* fileName, int* sprite);
+bool WatcherStart(AssetWatcher* watcher);
+// Takes the oldest decoded reload. Returns false when there is none. The
+// caller owns reload->image.
+bool WatcherPoll(AssetWatcher* watcher, SpriteReload* reload);
+void WatcherFree(AssetWatcher* watcher);
+
+#endif
@@ -0,0 +1,337 @@
+#include "weather.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define RAIN_MIN_SPEED 400.0f
+#define RAIN_MAX_SPEED 800.0f
+#define SNOW_MIN_SPEED 50.0f
+#define SNOW_MAX_SPEED 150.0f
+#define SNOW_DRIFT 50.0f
+#define SPAWN_HEIGHT 200.0f
+#define RAIN_LENGTH 10.0f
+#define FLAKE_RADIUS 2.0f
+#define FLAKE_IMAGE_SIZE 8
+// Far below any screen but still finite, so a parked particle that reaches
+// the GPU before its first update is simply clipped.
+#define PARKED_Y 1e30f
+
+static inline unsigned int Xorshift(unsigned int s) {
+	s ^= s << 13;
+	s ^= s >> 17;
+	s ^= s << 5;
+	return s;
+}
+
+// Top 16 bits of a random word as [0, 1), and the bottom 8 as a second draw.
+static inline float HighUnit(unsigned int r) {
+	return (float)(int)(r >> 16) * (1.0f / 65536.0f);
+}
+
+static inline float LowUnit(unsigned int r) {
+	return (float)(int)(r & 0xFF) * (1.0f / 256.0f);
+}
+
+void ParticleSystemInit(ParticleSystem* ps, int count) {
+	ps->x = calloc((size_t)count, sizeof(float));
+	ps->y = calloc((size_t)count, sizeof(float));
+	ps->speed = calloc((size_t)count, sizeof(float));
+	ps->seed = malloc((size_t)count * sizeof(unsigned int));
+	ps->count = count;
+
+	// xorshift never leaves 0, so every lane needs a distinct non-zero seed.
+	for (int i = 0; i < count; i++) ps->seed[i] = (unsigned int)i * 0x9E3779B9u + 0x6D2B79F5u;
+	for (int i = 0; i < count; i++) if (ps->seed[i] == 0) ps->seed[i] = 1;
+
+	InitParticles(ps);
+}
+
+void ParticleSystemFree(ParticleSystem* ps) {
+	free(ps->x);
+	free(ps->y);
+	free(ps->speed);
+	free(ps->seed);
+	ps->x = NULL;
+	ps->y = NULL;
+	ps->speed = NULL;
+	ps->seed = NULL;
+	ps->count = 0;
+}
+
+// Parks every particle below any screen so the next update respawns it.
+void InitParticles(ParticleSystem* ps) {
+	for (int i = 0; i < ps->count; i++) {
+		ps->y[i] = PARKED_Y;
+		ps->speed[i] = 0.0f;
+	}
+}
+
+// Respawning is rare (a raindrop lives for more than a second), so it gets
+// its own pass with a branch and leaves the per-frame loops branch free.
+static void Respawn(ParticleSystem* ps, float left, float width, float top, float bottom, float minSpeed, float maxSpeed) {
+	float* restrict x = ps->x;
+	float* restrict y = ps->y;
+	float* restrict speed = ps->speed;
+	unsigned int* restrict seed = ps->seed;
+	const int count = ps->count;
+
+	for (int i = 0; i < count; i++) {
+		if (y[i] <= bottom) continue;
+
+		unsigned int r = Xorshift(seed[i]);
+		seed[i] = r;
+		x[i] = left + HighUnit(r) * width;
+		y[i] = top - LowUnit(r) * SPAWN_HEIGHT;
+		speed[i] = minSpeed + LowUnit(r >> 8) * (maxSpeed - minSpeed);
+	}
+}
+
+static void FallRain(ParticleSystem* ps, float dt) {
+	float* restrict y = ps->y;
+	const float* restrict speed = ps->speed;
+	const int count = ps->count;
+
+	for (int i = 0; i < count; i++) y[i] += speed[i] * dt;
+}
+
+static void FallSnow(ParticleSystem* ps, float dt) {
+	float* restrict x = ps->x;
+	float* restrict y = ps->y;
+	const float* restrict speed = ps->speed;
+	unsigned int* restrict seed = ps->seed;
+	const int count = ps->count;
+	const float drift = 2.0f * SNOW_DRIFT * dt;
+
+	// Flakes wander sideways every frame, so the state advances every frame.
+	for (int i = 0; i < count; i++) {
+		unsigned int r = Xorshift(seed[i]);
+		seed[i] = r;
+		x[i] += (HighUnit(r) - 0.5f) * drift;
+		y[i] += speed[i] * dt;
+	}
+}
+
+void UpdateWeather(ParticleSystem* ps, WeatherType weather, Camera2D cam, int screenW, int screenH, float dt) {
+	if (weather == WEATHER_NONE) return;
+
+	float left = cam.target.x - screenW;
+	float width = 2.0f * screenW;
+	float top = cam.target.y - screenH / 2.0f;
+	float bottom = cam.target.y + screenH;
+
+	if (weather == WEATHER_RAIN) {
+		Respawn(ps, left, width, top, bottom, RAIN_MIN_SPEED, RAIN_MAX_SPEED);
+		FallRain(ps, dt);
+	}
+	else {
+		Respawn(ps, left, width, top, bottom, SNOW_MIN_SPEED, SNOW_MAX_SPEED);
+		FallSnow(ps, dt);
+	}
+}
+
+Image GenSnowflakeImage(void) {
+	Image image = GenImageColor(FLAKE_IMAGE_SIZE, FLAKE_IMAGE_SIZE, BLANK);
+	Color* pixels = image.data;
+	float center = FLAKE_IMAGE_SIZE / 2.0f;
+
+	for (int py = 0; py < FLAKE_IMAGE_SIZE; py++) {
+		for (int px = 0; px < FLAKE_IMAGE_SIZE; px++) {
+			float dx = px + 0.5f - center;
+			float dy = py + 0.5f - center;
+			float a = Clamp(center - sqrtf(dx * dx + dy * dy), 0.0f, 1.0f);
+			pixels[py * FLAKE_IMAGE_SIZE + px] = (Color){ 255, 255, 255, (unsigned char)(a * 255.0f) };
+		}
+	}
+	return image;
+}
+
+// GL 3.3 path: every particle is one instance of a two-triangle quad. The
+// x and y arrays are uploaded as they are, one per-instance attribute each,
+// and the vertex shader places the corners.
+static const char* particleVS =
+	"#version 330\n"
+	"layout(location = 0) in vec2 corner;\n"
+	"layout(location = 1) in float particleX;\n"
+	"layout(location = 2) in float particleY;\n"
+	"uniform mat4 mvp;\n"
+	"uniform vec4 extent;\n"
+	"uniform vec4 uvRect;\n"
+	"out vec2 fragTexCoord;\n"
+	"void main() {\n"
+	"    fragTexCoord = mix(uvRect.xy, uvRect.zw, corner * 0.5 + 0.5);\n"
+	"    vec2 p = vec2(particleX, particleY) + extent.zw + corner * extent.xy;\n"
+	"    gl_Position = mvp * vec4(p, 0.0, 1.0);\n"
+	"}\n";
+
+static const char* particleFS =
+	"#version 330\n"
+	"in vec2 fragTexCoord;\n"
+	"uniform sampler2D texture0;\n"
+	"uniform vec4 colDiffuse;\n"
+	"out vec4 finalColor;\n"
+	"void main() {\n"
+	"    finalColor = texture(texture0, fragTexCoord) * colDiffuse;\n"
+	"}\n";
+
+static const float quadCorners[12] = { -1, -1, -1, 1, 1, 1, -1, -1, 1, 1, 1, -1 };
+
+static struct {
+	bool ready;
+	unsigned int shader;
+	int mvpLoc;
+	int extentLoc;
+	int uvLoc;
+	int colorLoc;
+	int textureLoc;
+	unsigned int vao;
+	unsigned int cornerVbo;
+	unsigned int xVbo;
+	unsigned int yVbo;
+	int capacity;
+} gpu = { 0 };
+
+void WeatherRenderInit(void) {
+	if (rlGetVersion() != RL_OPENGL_33 && rlGetVersion() != RL_OPENGL_43) return;
+
+	gpu.shader = rlLoadShaderCode(particleVS, particleFS);
+	if (gpu.shader == 0) return;
+
+	gpu.mvpLoc = rlGetLocationUniform(gpu.shader, "mvp");
+	gpu.extentLoc = rlGetLocationUniform(gpu.shader, "extent");
+	gpu.uvLoc = rlGetLocationUniform(gpu.shader, "uvRect");
+	gpu.colorLoc = rlGetLocationUniform(gpu.shader, "colDiffuse");
+	gpu.textureLoc = rlGetLocationUniform(gpu.shader, "texture0");
+
+	gpu.vao = rlLoadVertexArray();
+	rlEnableVertexArray(gpu.vao);
+	gpu.cornerVbo = rlLoadVertexBuffer(quadCorners, sizeof(quadCorners), false);
+	rlSetVertexAttribute(0, 2, RL_FLOAT, false, 0, 0);
+	rlEnableVertexAttribute(0);
+	rlDisableVertexArray();
+
+	gpu.ready = true;
+}
+
+void WeatherRenderFree(void) {
+	if (!gpu.ready) return;
+	if (gpu.capacity > 0) {
+		rlUnloadVertexBuffer(gpu.xVbo);
+		rlUnloadVertexBuffer(gpu.yVbo);
+	}
+	rlUnloadVertexBuffer(gpu.cornerVbo);
+	rlUnloadVertexArray(gpu.vao);
+	rlUnloadShaderProgram(gpu.shader);
+	memset(&gpu, 0, sizeof(gpu));
+}
+
+static void ReserveInstances(int count) {
+	if (count <= gpu.capacity) return;
+
+	rlEnableVertexArray(gpu.vao);
+	if (gpu.capacity > 0) {
+		rlUnloadVertexBuffer(gpu.xVbo);
+		rlUnloadVertexBuffer(gpu.yVbo);
+	}
+
+	gpu.xVbo = rlLoadVertexBuffer(NULL, count * (int)sizeof(float), true);
+	rlSetVertexAttribute(1, 1, RL_FLOAT, false, 0, 0);
+	rlEnableVertexAttribute(1);
+	rlSetVertexAttributeDivisor(1, 1);
+
+	gpu.yVbo = rlLoadVertexBuffer(NULL, count * (int)sizeof(float), true);
+	rlSetVertexAttribute(2, 1, RL_FLOAT, false, 0, 0);
+	rlEnableVertexAttribute(2);
+	rlSetVertexAttributeDivisor(2, 1);
+
+	rlDisableVertexArray();
+	gpu.capacity = count;
+}
+
+static void DrawInstanced(const ParticleSystem* ps, unsigned int texture, Vector4 extent, Vector4 uv, Color color) {
+	ReserveInstances(ps->count);
+
+	// Whatever is queued in the batch belongs under the weather.
+	rlDrawRenderBatchActive();
+
+	Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+	Vector4 tint = { color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f };
+	int slot = 0;
+
+	rlEnableShader(gpu.shader);
+	rlSetUniformMatrix(gpu.mvpLoc, mvp);
+	rlSetUniform(gpu.extentLoc, &extent, RL_SHADER_UNIFORM_VEC4, 1);
+	rlSetUniform(gpu.uvLoc, &uv, RL_SHADER_UNIFORM_VEC4, 1);
+	rlSetUniform(gpu.colorLoc, &tint, RL_SHADER_UNIFORM_VEC4, 1);
+	rlSetUniform(gpu.textureLoc, &slot, RL_SHADER_UNIFORM_INT, 1);
+	rlActiveTextureSlot(0);
+	rlEnableTexture(texture);
+
+	rlEnableVertexArray(gpu.vao);
+	rlUpdateVertexBuffer(gpu.xVbo, ps->x, ps->count * (int)sizeof(float), 0);
+	rlUpdateVertexBuffer(gpu.yVbo, ps->y, ps->count * (int)sizeof(float), 0);
+
+	rlDisableBackfaceCulling();
+	rlDrawVertexArrayInstanced(0, 6, ps->count);
+	rlEnableBackfaceCulling();
+
+	rlDisableVertexArray();
+	rlDisableTexture();
+	rlDisableShader();
+}
+
+// Everything else goes through the regular batch, still without a draw call
+// or a texture switch per particle.
+static void DrawBatched(const ParticleSystem* ps, unsigned int texture, Vector4 extent, Vector4 uv, Color color) {
+	const float* x = ps->x;
+	const float* y = ps->y;
+
+	rlSetTexture(texture);
+	rlBegin(RL_QUADS);
+	rlColor4ub(color.r, color.g, color.b, color.a);
+	rlNormal3f(0.0f, 0.0f, 1.0f);
+	for (int i = 0; i < ps->count; i++) {
+		if (y[i] >= PARKED_Y) continue;
+		float cx = x[i] + extent.z;
+		float cy = y[i] + extent.w;
+		rlTexCoord2f(uv.x, uv.y); rlVertex2f(cx - extent.x, cy - extent.y);
+		rlTexCoord2f(uv.x, uv.w); rlVertex2f(cx - extent.x, cy + extent.y);
+		rlTexCoord2f(uv.z, uv.w); rlVertex2f(cx + extent.x, cy + extent.y);
+		rlTexCoord2f(uv.z, uv.y); rlVertex2f(cx + extent.x, cy - extent.y);
+	}
+	rlEnd();
+	rlSetTexture(0);
+}
+
+void DrawWeather(const ParticleSystem* ps, WeatherType weather, Texture2D texture, Rectangle flakeSource) {
+	if (weather == WEATHER_NONE || ps->count == 0) return;
+
+	// extent is the half size of the quad and the offset of its centre from
+	// the particle position; rain hangs a 1 unit wide streak below it.
+	unsigned int textureId = rlGetTextureIdDefault();
+	Vector4 uv = { 0.0f, 0.0f, 1.0f, 1.0f };
+	Vector4 extent;
+	Color color;
+
+	if (weather == WEATHER_RAIN) {
+		extent = (Vector4){ 0.5f, RAIN_LENGTH / 2.0f, 0.0f, RAIN_LENGTH / 2.0f };
+		color = Fade(BLUE, 0.7f);
+	}
+	else {
+		extent = (Vector4){ FLAKE_RADIUS, FLAKE_RADIUS, 0.0f, 0.0f };
+		color = Fade(WHITE, 0.8f);
+		if (texture.id != 0) {
+			textureId = texture.id;
+			uv = (Vector4){
+				flakeSource.x / texture.width,
+				flakeSource.y / texture.height,
+				(flakeSource.x + flakeSource.width) / texture.width,
+				(flakeSource.y + flakeSource.height) / texture.height
+			};
+		}
+	}
+
+	if (gpu.ready) DrawInstanced(ps, textureId, extent, uv, color);
+	else DrawBatched(ps, textureId, extent, uv, color);
+}
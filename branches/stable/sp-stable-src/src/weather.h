@@ -0,0 +1,36 @@
+#ifndef WEATHER_H
+#define WEATHER_H
+
+#include "game.h"
+
+// Weather particles are kept as parallel arrays and updated by one plain loop
+// per weather type, so the compiler can vectorise them. Each particle carries
+// its own xorshift state instead of calling GetRandomValue. On GL 3.3 every
+// particle is drawn as an instance of one quad in a single draw call, with
+// the position arrays uploaded as they are; older GL versions fall back to a
+// single rlgl batch.
+
+typedef struct {
+	float* x;
+	float* y;
+	float* speed;
+	unsigned int* seed;
+	int count;
+} ParticleSystem;
+
+// GPU resources for the instanced path. Call after InitWindow.
+void WeatherRenderInit(void);
+void WeatherRenderFree(void);
+
+void ParticleSystemInit(ParticleSystem* ps, int count);
+void ParticleSystemFree(ParticleSystem* ps);
+
+void InitParticles(ParticleSystem* ps);
+void UpdateWeather(ParticleSystem* ps, WeatherType weather, Camera2D cam, int screenW, int screenH, float dt);
+
+// The snowflake sprite, meant to be packed into an atlas. DrawWeather draws
+// plain squares when texture.id is 0.
+Image GenSnowflakeImage(void);
+void DrawWeather(const ParticleSystem* ps, WeatherType weather, Texture2D texture, Rectangle flakeSource);
+
+#endif
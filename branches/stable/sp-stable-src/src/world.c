@@ -0,0 +1,192 @@
+#include "world.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void Journal(World* world, WorldChangeType type, int id, const Block* b) {
+	WorldJournal* journal = world->journal;
+	if (journal->count == journal->capacity) {
+		journal->capacity = (journal->capacity > 0) ? journal->capacity * 2 : 256;
+		journal->changes = realloc(journal->changes, (size_t)journal->capacity * sizeof(WorldChange));
+	}
+
+	WorldChange* change = &journal->changes[journal->count++];
+	change->type = type;
+	change->id = id;
+	change->rect = (b != NULL) ? b->rect : (Rectangle){ 0 };
+	change->color = (b != NULL) ? b->color : (Color){ 0 };
+	change->shape = (b != NULL) ? b->shape : SHAPE_SQUARE;
+}
+
+// Stands in for every page without an active block, so ids in it can still
+// be looked up. Only WorldAdd writes to a page, and it gives the page its
+// own memory first.
+static const Block emptyPage[WORLD_PAGE_BLOCKS];
+#define EMPTY_PAGE ((Block*)emptyPage)
+
+static void AddPage(World* world) {
+	world->pages = realloc(world->pages, (size_t)(world->pageCount + 1) * sizeof(Block*));
+	world->pageActive = realloc(world->pageActive, (size_t)(world->pageCount + 1) * sizeof(int));
+	world->pages[world->pageCount] = EMPTY_PAGE;
+	world->pageActive[world->pageCount] = 0;
+	world->pageCount++;
+}
+
+static void FreePage(World* world, int page) {
+	if (world->pages[page] != EMPTY_PAGE) free(world->pages[page]);
+	world->pages[page] = EMPTY_PAGE;
+	world->pageActive[page] = 0;
+}
+
+void WorldInit(World* world) {
+	world->pages = NULL;
+	world->pageActive = NULL;
+	world->pageCount = 0;
+	world->highWater = 0;
+	world->activeCount = 0;
+	world->freeIds = NULL;
+	world->freeCount = 0;
+	world->freeCapacity = 0;
+	world->queryIds = NULL;
+	world->queryCapacity = 0;
+	GridInit(&world->grid);
+	SolidSetInit(&world->solids);
+	world->journal = NULL;
+
+	AddPage(world);
+}
+
+void WorldFree(World* world) {
+	for (int i = 0; i < world->pageCount; i++) FreePage(world, i);
+	free(world->pages);
+	free(world->pageActive);
+	free(world->freeIds);
+	free(world->queryIds);
+	GridFree(&world->grid);
+	SolidSetFree(&world->solids);
+}
+
+void WorldClear(World* world) {
+	for (int i = 0; i < world->pageCount; i++) FreePage(world, i);
+	world->pageCount = 1;
+
+	world->highWater = 0;
+	world->activeCount = 0;
+	world->freeCount = 0;
+	GridClear(&world->grid);
+	SolidSetClear(&world->solids);
+	if (world->journal != NULL) Journal(world, WORLD_CHANGE_CLEAR, -1, NULL);
+}
+
+void WorldCopy(World* dst, const World* src) {
+	*dst = *src;
+	dst->queryIds = NULL;
+	dst->queryCapacity = 0;
+	dst->journal = NULL;
+
+	dst->pages = malloc((size_t)src->pageCount * sizeof(Block*));
+	dst->pageActive = malloc((size_t)src->pageCount * sizeof(int));
+	memcpy(dst->pageActive, src->pageActive, (size_t)src->pageCount * sizeof(int));
+	for (int i = 0; i < src->pageCount; i++) {
+		dst->pages[i] = EMPTY_PAGE;
+		if (src->pages[i] == EMPTY_PAGE) continue;
+		dst->pages[i] = malloc(WORLD_PAGE_BLOCKS * sizeof(Block));
+		memcpy(dst->pages[i], src->pages[i], WORLD_PAGE_BLOCKS * sizeof(Block));
+	}
+
+	dst->freeIds = NULL;
+	if (src->freeCapacity > 0) {
+		dst->freeIds = malloc((size_t)src->freeCapacity * sizeof(int));
+		memcpy(dst->freeIds, src->freeIds, (size_t)src->freeCount * sizeof(int));
+	}
+
+	GridCopy(&dst->grid, &src->grid);
+	SolidSetInit(&dst->solids);
+	SolidSetInvalidate(&dst->solids);
+}
+
+int WorldAdd(World* world, Rectangle rect, Color color, BlockShape shape) {
+	int id;
+	if (world->freeCount > 0) {
+		id = world->freeIds[--world->freeCount];
+	}
+	else {
+		id = world->highWater++;
+		if (id / WORLD_PAGE_BLOCKS >= world->pageCount) AddPage(world);
+	}
+
+	int page = id / WORLD_PAGE_BLOCKS;
+	if (world->pages[page] == EMPTY_PAGE) world->pages[page] = calloc(WORLD_PAGE_BLOCKS, sizeof(Block));
+	world->pageActive[page]++;
+
+	Block* b = WorldGet(world, id);
+	b->active = 1;
+	b->rect = rect;
+	b->color = color;
+	b->shape = shape;
+
+	GridChunk* anchor = GridInsert(&world->grid, id, rect);
+	if (anchor != NULL) SolidSetTouch(&world->solids, anchor->cx, anchor->cy);
+	world->activeCount++;
+	if (world->journal != NULL) Journal(world, WORLD_CHANGE_ADD, id, b);
+	return id;
+}
+
+int WorldReserveId(World* world) {
+	int id = world->highWater++;
+	if (id / WORLD_PAGE_BLOCKS >= world->pageCount) AddPage(world);
+	return id;
+}
+
+void WorldFreeId(World* world, int id) {
+	if (world->freeCount == world->freeCapacity) {
+		world->freeCapacity = (world->freeCapacity > 0) ? world->freeCapacity * 2 : 256;
+		world->freeIds = realloc(world->freeIds, (size_t)world->freeCapacity * sizeof(int));
+	}
+	world->freeIds[world->freeCount++] = id;
+}
+
+void WorldRemove(World* world, int id) {
+	Block* b = WorldGet(world, id);
+	if (!b->active) return;
+
+	b->active = 0;
+	int cx, cy;
+	if (GridRemove(&world->grid, id, b->rect, &cx, &cy)) SolidSetTouch(&world->solids, cx, cy);
+	world->activeCount--;
+	if (--world->pageActive[id / WORLD_PAGE_BLOCKS] == 0) FreePage(world, id / WORLD_PAGE_BLOCKS);
+	WorldFreeId(world, id);
+	if (world->journal != NULL) Journal(world, WORLD_CHANGE_REMOVE, id, NULL);
+}
+
+int WorldQuery(World* world, Rectangle area, const int** ids) {
+	if (world->queryCapacity == 0) {
+		world->queryCapacity = 256;
+		world->queryIds = malloc((size_t)world->queryCapacity * sizeof(int));
+	}
+
+	int count = GridQuery(&world->grid, area, world->queryIds, world->queryCapacity);
+	while (count == world->queryCapacity) {
+		world->queryCapacity *= 2;
+		world->queryIds = realloc(world->queryIds, (size_t)world->queryCapacity * sizeof(int));
+		count = GridQuery(&world->grid, area, world->queryIds, world->queryCapacity);
+	}
+
+	*ids = world->queryIds;
+	return count;
+}
+
+int WorldCollide(World* world, Rectangle area, const Rectangle** rects) {
+	return SolidSetQuery(&world->solids, world, area, rects);
+}
+
+size_t WorldBytes(const World* world) {
+	size_t bytes = (size_t)world->pageCount * (sizeof(Block*) + sizeof(int));
+	for (int i = 0; i < world->pageCount; i++) {
+		if (world->pages[i] != EMPTY_PAGE) bytes += WORLD_PAGE_BLOCKS * sizeof(Block);
+	}
+	bytes += (size_t)world->freeCapacity * sizeof(int);
+	bytes += (size_t)world->queryCapacity * sizeof(int);
+	bytes += GridBytes(&world->grid);
+	bytes += SolidSetBytes(&world->solids);
+	return bytes;
+}
@@ -0,0 +1,83 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "game.h"
+#include "grid.h"
+#include "merge.h"
+
+#define WORLD_PAGE_BLOCKS 1024
+
+typedef enum { WORLD_CHANGE_ADD, WORLD_CHANGE_REMOVE, WORLD_CHANGE_CLEAR } WorldChangeType;
+
+typedef struct {
+	WorldChangeType type;
+	int id;
+	Rectangle rect;
+	Color color;
+	BlockShape shape;
+} WorldChange;
+
+// Adds and removes made while a journal is attached, in order. The replay
+// recorder attaches one between ticks to catch changes made outside the
+// simulation, such as chunks being paged in.
+typedef struct {
+	WorldChange* changes;
+	int count;
+	int capacity;
+} WorldJournal;
+
+// Block storage without a fixed cap. Blocks live in pages allocated on
+// demand and freed again once none of their blocks is active; they keep
+// their id for as long as they exist, and removed ids go on a free list so
+// placing a block never scans for a slot. Collision runs
+// against solids, the merged view of the blocks from merge.h.
+
+typedef struct World {
+	Block** pages;
+	int* pageActive;
+	int pageCount;
+	int highWater;
+	int activeCount;
+
+	int* freeIds;
+	int freeCount;
+	int freeCapacity;
+
+	int* queryIds;
+	int queryCapacity;
+
+	SpatialGrid grid;
+	SolidSet solids;
+	WorldJournal* journal;
+} World;
+
+void WorldInit(World* world);
+void WorldFree(World* world);
+void WorldClear(World* world);
+// Deep copy made of flat memcpys, cheap enough to snapshot a world for a
+// background save. dst must not be initialised and gets no journal.
+void WorldCopy(World* dst, const World* src);
+
+int WorldAdd(World* world, Rectangle rect, Color color, BlockShape shape);
+void WorldRemove(World* world, int id);
+// For rebuilding a world whose ids must come back as they were: takes the
+// next id without placing a block in it, and later hands such an id to the
+// free list, in the order it is to be reused.
+int WorldReserveId(World* world);
+void WorldFreeId(World* world, int id);
+
+// Ids of the blocks overlapping area in ascending order. The returned array
+// belongs to the world and is overwritten by the next query.
+int WorldQuery(World* world, Rectangle area, const int** ids);
+// Rectangles to collide with inside area, merged where blocks allow it.
+// The returned array belongs to the world and is overwritten by the next
+// call.
+int WorldCollide(World* world, Rectangle area, const Rectangle** rects);
+// Heap memory the world holds, blocks, grid and solids together.
+size_t WorldBytes(const World* world);
+
+static inline Block* WorldGet(const World* world, int id) {
+	return &world->pages[id / WORLD_PAGE_BLOCKS][id % WORLD_PAGE_BLOCKS];
+}
+
+#endif
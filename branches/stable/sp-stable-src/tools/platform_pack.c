@@ -0,0 +1,101 @@
+#include "pack.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Builds the asset pack the game maps at startup. Run it from the game's
+// directory so the stored names match the paths the game asks for; with no
+// paths it packs images/, custom/ and sounds/.
+
+typedef struct {
+	char** paths;
+	int count;
+	int capacity;
+	long long bytes;
+} FileList;
+
+static void AddPath(FileList* list, const char* path, long long size) {
+	if (list->count == list->capacity) {
+		list->capacity = (list->capacity > 0) ? list->capacity * 2 : 64;
+		list->paths = realloc(list->paths, (size_t)list->capacity * sizeof(char*));
+	}
+	list->paths[list->count++] = strdup(path);
+	list->bytes += size;
+}
+
+static bool CollectPath(FileList* list, const char* path) {
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		fprintf(stderr, "platform_pack: %s not found\n", path);
+		return false;
+	}
+	if (S_ISREG(st.st_mode)) {
+		AddPath(list, path, (long long)st.st_size);
+		return true;
+	}
+	if (!S_ISDIR(st.st_mode)) return true;
+
+	DIR* dir = opendir(path);
+	if (dir == NULL) return false;
+
+	bool ok = true;
+	struct dirent* entry;
+	while (ok && (entry = readdir(dir)) != NULL) {
+		if (entry->d_name[0] == '.') continue;
+		char child[4096];
+		snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+		ok = CollectPath(list, child);
+	}
+	closedir(dir);
+	return ok;
+}
+
+static void PrintUsage(void) {
+	fprintf(stderr, "usage: platform_pack [-o assets.pak] [file or directory ...]\n");
+}
+
+int main(int argc, char** argv) {
+	const char* outName = PACK_DEFAULT_FILE;
+	FileList list = { 0 };
+	bool ok = true;
+	int inputs = 0;
+
+	for (int i = 1; i < argc && ok; i++) {
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) outName = argv[++i];
+		else if (argv[i][0] == '-') {
+			PrintUsage();
+			return 2;
+		}
+		else {
+			// Trailing slashes would end up in the stored names.
+			size_t length = strlen(argv[i]);
+			while (length > 1 && argv[i][length - 1] == '/') argv[i][--length] = '\0';
+			ok = CollectPath(&list, argv[i]);
+			inputs++;
+		}
+	}
+
+	if (inputs == 0) {
+		const char* defaults[] = { "images", "custom", "sounds" };
+		for (int i = 0; i < 3; i++) {
+			struct stat st;
+			if (stat(defaults[i], &st) == 0) CollectPath(&list, defaults[i]);
+		}
+	}
+
+	if (ok && list.count == 0) {
+		fprintf(stderr, "platform_pack: nothing to pack\n");
+		ok = false;
+	}
+	if (ok && !PackWrite(outName, (const char* const*)list.paths, list.count)) {
+		fprintf(stderr, "platform_pack: could not write %s (unreadable file, duplicate or name over %d bytes)\n", outName, PACK_NAME_SIZE - 1);
+		ok = false;
+	}
+	if (ok) printf("%s: %d files, %.1f KB\n", outName, list.count, list.bytes / 1024.0);
+
+	for (int i = 0; i < list.count; i++) free(list.paths[i]);
+	free(list.paths);
+	return ok ? 0 : 1;
+}
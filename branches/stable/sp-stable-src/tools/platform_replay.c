@@ -0,0 +1,129 @@
+#include "sim.h"
+#include "replay.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Re-simulates a recorded session with no window as fast as it will go and
+// reports how long each tick took, so a slowdown a player ran into can be
+// reproduced and profiled tick for tick.
+
+typedef struct {
+	double ns;
+	unsigned long long tick;
+} TickSample;
+
+static double NowNs(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int CompareSamples(const void* a, const void* b) {
+	double x = ((const TickSample*)a)->ns;
+	double y = ((const TickSample*)b)->ns;
+	return (x < y) - (x > y);
+}
+
+static void PrintUsage(void) {
+	fprintf(stderr, "usage: platform_replay file.rpl [--from seconds] [--ticks count] [--slowest count] [--verify]\n");
+}
+
+int main(int argc, char** argv) {
+	const char* fileName = NULL;
+	double from = 0.0;
+	long long maxTicks = -1;
+	int slowest = 10;
+	bool verify = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) from = atof(argv[++i]);
+		else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) maxTicks = atoll(argv[++i]);
+		else if (strcmp(argv[i], "--slowest") == 0 && i + 1 < argc) slowest = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--verify") == 0) verify = true;
+		else if (argv[i][0] != '-' && fileName == NULL) fileName = argv[i];
+		else {
+			PrintUsage();
+			return 2;
+		}
+	}
+	if (fileName == NULL) {
+		PrintUsage();
+		return 2;
+	}
+
+	Replay replay;
+	if (!ReplayOpen(&replay, fileName)) {
+		fprintf(stderr, "platform_replay: %s is not a replay\n", fileName);
+		return 2;
+	}
+	replay.verify = verify;
+
+	printf("%s: %llu ticks, %.1f s recorded at %d Hz, %d keyframes%s\n", fileName, replay.tickCount, replay.duration,
+		replay.tickRate, replay.keyframeCount, replay.truncated ? " (cut short)" : "");
+
+	WorldState state;
+	SimInit(&state);
+
+	// Seconds are turned into ticks at the recorded rate; a session that
+	// changed rate midway is only approximately positioned.
+	unsigned long long start = (unsigned long long)(from * replay.tickRate + 0.5);
+	if (start > replay.tickCount) start = replay.tickCount;
+
+	double t0 = NowNs();
+	if (!ReplaySeek(&replay, &state, start)) {
+		fprintf(stderr, "platform_replay: cannot seek to tick %llu\n", start);
+		SimFree(&state);
+		ReplayClose(&replay);
+		return 1;
+	}
+	if (start > 0) printf("seek to tick %llu: %.2f ms\n", start, (NowNs() - t0) / 1e6);
+
+	unsigned long long remaining = replay.tickCount - start;
+	if (maxTicks >= 0 && (unsigned long long)maxTicks < remaining) remaining = (unsigned long long)maxTicks;
+	TickSample* samples = malloc((size_t)(remaining > 0 ? remaining : 1) * sizeof(TickSample));
+
+	int count = 0;
+	double simSeconds = 0.0;
+	double total = 0.0;
+	while ((unsigned long long)count < remaining) {
+		unsigned long long tick = replay.tick;
+		float step = replay.step;
+		t0 = NowNs();
+		if (!ReplayStep(&replay, &state)) break;
+		double elapsed = NowNs() - t0;
+
+		samples[count].ns = elapsed;
+		samples[count].tick = tick;
+		count++;
+		total += elapsed;
+		simSeconds += step;
+	}
+
+	if (count > 0) {
+		printf("played %d ticks in %.1f ms: %.0f ticks/s, %.0fx real time\n", count, total / 1e6,
+			count / (total / 1e9), simSeconds / (total / 1e9));
+
+		qsort(samples, (size_t)count, sizeof(TickSample), CompareSamples);
+		printf("tick time: p50 %.2f us, p99 %.2f us, max %.2f us\n", samples[count / 2].ns / 1e3,
+			samples[count / 100].ns / 1e3, samples[0].ns / 1e3);
+
+		if (slowest > count) slowest = count;
+		if (slowest > 0) printf("slowest ticks:\n");
+		for (int i = 0; i < slowest; i++) {
+			printf("  tick %llu (%.2f s): %.2f us\n", samples[i].tick, (double)samples[i].tick / replay.tickRate, samples[i].ns / 1e3);
+		}
+	}
+
+	int status = 0;
+	if (verify) {
+		printf("verify: %d keyframes did not match\n", replay.desyncs);
+		if (replay.desyncs > 0) status = 1;
+	}
+
+	free(samples);
+	SimFree(&state);
+	ReplayClose(&replay);
+	return status;
+}